@@ -643,6 +643,7 @@
 #include "clutter-main.h"
 #include "clutter-marshal.h"
 #include "clutter-mutter.h"
+#include "clutter-offscreen-effect-private.h"
 #include "clutter-paint-context-private.h"
 #include "clutter-paint-nodes.h"
 #include "clutter-paint-node-private.h"
@@ -678,8 +679,25 @@ typedef enum
 } MapStateChange;
 
 /* 3 entries should be a good compromise, few layout managers
- * will ask for 3 different preferred size in each allocation cycle */
+ * will ask for 3 different preferred size in each allocation cycle;
+ * the cache of an actor whose layout asks for more than that grows,
+ * up to MAX_CACHED_SIZE_REQUESTS entries */
 #define N_CACHED_SIZE_REQUESTS 3
+#define MAX_CACHED_SIZE_REQUESTS 48
+
+typedef struct _SizeRequestCache
+{
+  /* points to inline_requests until the cache needs to grow */
+  SizeRequest *requests;
+  guint n_requests;
+
+  SizeRequest inline_requests[N_CACHED_SIZE_REQUESTS];
+
+#ifdef CLUTTER_ENABLE_DEBUG
+  guint n_hits;
+  guint n_misses;
+#endif
+} SizeRequestCache;
 
 struct _ClutterActorPrivate
 {
@@ -687,8 +705,8 @@ struct _ClutterActorPrivate
   ClutterRequestMode request_mode;
 
   /* our cached size requests for different width / height */
-  SizeRequest width_requests[N_CACHED_SIZE_REQUESTS];
-  SizeRequest height_requests[N_CACHED_SIZE_REQUESTS];
+  SizeRequestCache width_requests;
+  SizeRequestCache height_requests;
 
   /* An age of 0 means the entry is not set */
   guint cached_height_age;
@@ -700,6 +718,15 @@ struct _ClutterActorPrivate
   ClutterActorBox allocation;
   ClutterAllocationFlags allocation_flags;
 
+  /* the box last passed to clutter_actor_allocate() by the parent,
+   * before constraints and margins were applied, and the layout
+   * state it was computed from; used to allocate layout boundaries
+   * without going through the parent
+   */
+  ClutterActorBox allocation_request;
+  ClutterAllocationFlags allocation_request_flags;
+  ClutterLayoutInfo allocation_request_info;
+
   /* clip, in actor coordinates */
   graphene_rect_t clip;
 
@@ -805,6 +832,12 @@ struct _ClutterActorPrivate
    */
   gulong in_cloned_branch;
 
+  /* the number of offscreen effects applied to the actor and to its
+   * ancestors; this value is propagated to all the actor's children
+   */
+  gulong in_offscreen_effect_branch;
+  guint n_offscreen_effects;
+
   GListModel *child_model;
   ClutterActorCreateChildFunc create_child_func;
   gpointer create_child_data;
@@ -813,6 +846,14 @@ struct _ClutterActorPrivate
   gulong resolution_changed_id;
   gulong font_changed_id;
 
+  /* the paint nodes built by the last paint, and the state they were
+   * built for; see clutter_actor_set_retain_paint_nodes() */
+  GPtrArray *retained_paint_nodes;
+  float retained_width;
+  float retained_height;
+  float retained_resource_scale;
+  guint8 retained_paint_opacity;
+
   /* bitfields: KEEP AT THE END */
 
   /* fixed position and sizes */
@@ -854,6 +895,10 @@ struct _ClutterActorPrivate
   guint needs_paint_volume_update   : 1;
   guint had_effects_on_last_paint_volume_update : 1;
   guint needs_compute_resource_scale : 1;
+  guint retain_paint_nodes          : 1;
+  guint allocation_request_valid    : 1;
+  guint allocation_request_fixed_size : 1;
+  guint allocation_request_position_set : 1;
 };
 
 enum
@@ -1111,6 +1156,10 @@ static void clutter_actor_push_in_cloned_branch (ClutterActor *self,
                                                  gulong        count);
 static void clutter_actor_pop_in_cloned_branch (ClutterActor *self,
                                                 gulong        count);
+static void clutter_actor_push_in_offscreen_effect_branch (ClutterActor *self,
+                                                           gulong        count);
+static void clutter_actor_pop_in_offscreen_effect_branch (ClutterActor *self,
+                                                          gulong        count);
 
 /* Helper macro which translates by the anchor coord, applies the
    given transformation and then translates back */
@@ -1734,6 +1783,9 @@ clutter_actor_real_unmap (ClutterActor *self)
   _clutter_paint_volume_init_static (&priv->last_paint_volume, NULL);
   priv->last_paint_volume_valid = TRUE;
 
+  /* don't keep resources alive for an actor that is not painted */
+  g_clear_pointer (&priv->retained_paint_nodes, g_ptr_array_unref);
+
   /* notify on parent mapped after potentially unmapping
    * children, so apps see a bottom-up notification.
    */
@@ -1979,6 +2031,9 @@ clutter_actor_real_hide (ClutterActor *self)
    */
   clutter_actor_update_map_state (self, MAP_STATE_CHECK);
 
+  /* the parent did not allocate us while we were hidden */
+  priv->allocation_request_valid = FALSE;
+
   /* we queue a relayout unless the actor is inside a
    * container that explicitly told us not to
    */
@@ -2759,11 +2814,93 @@ clutter_actor_real_allocate (ClutterActor           *self,
   g_object_thaw_notify (G_OBJECT (self));
 }
 
+static gboolean
+paint_volume_transform_to_actor (ClutterPaintVolume *pv,
+                                 ClutterActor       *self)
+{
+  if (pv->actor == NULL)
+    {
+      CoglMatrix matrix, inverse;
+
+      /* The volume is in eye coordinates, like the last paint volume
+       * of an actor, so it has to be brought back into @self's space */
+      cogl_matrix_init_identity (&matrix);
+      _clutter_actor_apply_relative_transformation_matrix (self, NULL, &matrix);
+      if (!cogl_matrix_get_inverse (&matrix, &inverse))
+        return FALSE;
+
+      _clutter_paint_volume_set_reference_actor (pv, self);
+      _clutter_paint_volume_transform (pv, &inverse);
+    }
+  else if (pv->actor != self)
+    {
+      _clutter_paint_volume_transform_relative (pv, self);
+    }
+
+  return TRUE;
+}
+
+/* Lets the effects of @self know that the area described by @pv needs to
+ * be redrawn. Offscreen effects record it as damage to the image they
+ * keep of the actor, and effects that draw outside of the area covered by
+ * the actor (like a blur) may enlarge it; in that case @damage_pv is set
+ * to the enlarged area, in the coordinate space of @self, and TRUE is
+ * returned. @pv and @damage_pv may point to the same volume.
+ */
+static gboolean
+_clutter_actor_queue_effects_damage (ClutterActor       *self,
+                                     ClutterPaintVolume *pv,
+                                     ClutterPaintVolume *damage_pv)
+{
+  ClutterActorPrivate *priv = self->priv;
+  gboolean has_damage_pv = FALSE;
+  const GList *l;
+
+  /* The first effect in the list redirects the output of the ones after
+   * it, so the area a change spreads over grows from the last effect to
+   * the first one.
+   */
+  for (l = g_list_last ((GList *) _clutter_meta_group_peek_metas (priv->effects));
+       l != NULL;
+       l = l->prev)
+    {
+      ClutterEffect *effect = l->data;
+
+      if (!clutter_actor_meta_get_enabled (CLUTTER_ACTOR_META (effect)))
+        continue;
+
+      if (CLUTTER_IS_OFFSCREEN_EFFECT (effect))
+        {
+          _clutter_offscreen_effect_queue_damage (CLUTTER_OFFSCREEN_EFFECT (effect),
+                                                  has_damage_pv ? damage_pv : pv);
+        }
+
+      if (pv == NULL || !_clutter_effect_has_custom_paint_volume (effect))
+        continue;
+
+      if (!has_damage_pv)
+        {
+          if (pv != damage_pv)
+            _clutter_paint_volume_copy_static (pv, damage_pv);
+
+          if (!paint_volume_transform_to_actor (damage_pv, self))
+            return FALSE;
+
+          has_damage_pv = TRUE;
+        }
+
+      _clutter_effect_modify_paint_volume (effect, damage_pv);
+    }
+
+  return has_damage_pv;
+}
+
 static void
 _clutter_actor_propagate_queue_redraw (ClutterActor       *self,
                                        ClutterActor       *origin,
                                        ClutterPaintVolume *pv)
 {
+  ClutterPaintVolume damage_pv;
   gboolean stop = FALSE;
 
   /* no point in queuing a redraw on a destroyed actor */
@@ -2776,21 +2913,38 @@ _clutter_actor_propagate_queue_redraw (ClutterActor       *self,
    */
   while (self)
     {
-      _clutter_actor_queue_redraw_on_clones (self);
+      /* Past the point where the redraw stops, only the offscreen
+       * effects of the remaining ancestors still need the damage
+       */
+      if (stop && self->priv->in_offscreen_effect_branch == 0)
+        break;
 
-      /* calls klass->queue_redraw in default handler */
-      if (g_signal_has_handler_pending (self, actor_signals[QUEUE_REDRAW],
-                                    0, TRUE))
+      if (!stop)
         {
-          g_signal_emit (self, actor_signals[QUEUE_REDRAW], 0, origin, pv, &stop);
-        }
-      else
-        {
-          stop = CLUTTER_ACTOR_GET_CLASS (self)->queue_redraw (self, origin, pv);
+          _clutter_actor_queue_redraw_on_clones (self);
+
+          /* calls klass->queue_redraw in default handler */
+          if (g_signal_has_handler_pending (self, actor_signals[QUEUE_REDRAW],
+                                            0, TRUE))
+            {
+              g_signal_emit (self, actor_signals[QUEUE_REDRAW], 0,
+                             origin, pv, &stop);
+            }
+          else
+            {
+              stop = CLUTTER_ACTOR_GET_CLASS (self)->queue_redraw (self,
+                                                                   origin,
+                                                                   pv);
+            }
         }
 
-      if (stop)
-        break;
+      /* Effects caching an image of their actor must see every change
+       * below them, even when the redraw itself doesn't need to be
+       * propagated any further up.
+       */
+      if (self->priv->effects != NULL &&
+          _clutter_actor_queue_effects_damage (self, pv, &damage_pv))
+        pv = &damage_pv;
 
       self = clutter_actor_get_parent (self);
     }
@@ -2817,6 +2971,13 @@ clutter_actor_real_queue_redraw (ClutterActor       *self,
       self->priv->is_dirty = TRUE;
       self->priv->effect_to_redraw = NULL;
     }
+  else
+    {
+      /* A redraw queued on the actor itself means that its content may
+       * have changed; one queued by a child doesn't affect the nodes the
+       * actor built for itself */
+      g_clear_pointer (&self->priv->retained_paint_nodes, g_ptr_array_unref);
+    }
 
   /* If the actor isn't visible, we still had to emit the signal
    * to allow for a ClutterClone, but the appearance of the parent
@@ -2858,6 +3019,116 @@ clutter_actor_needs_relayout (ClutterActor *self)
           priv->needs_allocation);
 }
 
+static void
+size_request_cache_init (SizeRequestCache *cache)
+{
+  cache->requests = cache->inline_requests;
+  cache->n_requests = N_CACHED_SIZE_REQUESTS;
+}
+
+static void
+size_request_cache_reset (SizeRequestCache *cache)
+{
+  /* keep the size the cache grew to; the layout of an actor rarely
+   * changes the number of sizes it asks for between cycles */
+  memset (cache->requests, 0, cache->n_requests * sizeof (SizeRequest));
+}
+
+static void
+size_request_cache_clear (SizeRequestCache *cache)
+{
+  if (cache->requests != cache->inline_requests)
+    g_free (cache->requests);
+
+  size_request_cache_init (cache);
+}
+
+static inline gboolean
+clutter_actor_has_fixed_size (ClutterActor *self)
+{
+  ClutterActorPrivate *priv = self->priv;
+
+  return priv->min_width_set && priv->natural_width_set &&
+         priv->min_height_set && priv->natural_height_set;
+}
+
+static gboolean
+layout_info_equal (const ClutterLayoutInfo *a,
+                   const ClutterLayoutInfo *b)
+{
+  return graphene_point_equal (&a->fixed_pos, &b->fixed_pos) &&
+         a->margin.left == b->margin.left &&
+         a->margin.right == b->margin.right &&
+         a->margin.top == b->margin.top &&
+         a->margin.bottom == b->margin.bottom &&
+         a->x_align == b->x_align &&
+         a->y_align == b->y_align &&
+         a->x_expand == b->x_expand &&
+         a->y_expand == b->y_expand &&
+         graphene_size_equal (&a->minimum, &b->minimum) &&
+         graphene_size_equal (&a->natural, &b->natural);
+}
+
+static void
+clutter_actor_store_allocation_request (ClutterActor           *self,
+                                        const ClutterActorBox  *box,
+                                        ClutterAllocationFlags  flags)
+{
+  ClutterActorPrivate *priv = self->priv;
+
+  priv->allocation_request = *box;
+  priv->allocation_request_flags = flags & ~CLUTTER_ABSOLUTE_ORIGIN_CHANGED;
+  priv->allocation_request_info =
+    *_clutter_actor_get_layout_info_or_defaults (self);
+  priv->allocation_request_fixed_size = clutter_actor_has_fixed_size (self);
+  priv->allocation_request_position_set = priv->position_set;
+  priv->allocation_request_valid = TRUE;
+}
+
+/*< private >
+ * clutter_actor_is_layout_boundary:
+ * @self: a #ClutterActor
+ *
+ * Checks whether a relayout of @self can be satisfied without asking
+ * the parent to allocate its children again.
+ *
+ * This is the case if @self has a fixed size, no constraints, and none
+ * of the state the parent uses to lay it out changed since the last
+ * time it was allocated; the box the parent passed to
+ * clutter_actor_allocate() is then still valid, and only the subtree
+ * rooted at @self needs to be allocated again.
+ *
+ * Return value: %TRUE if @self is a layout boundary
+ */
+static gboolean
+clutter_actor_is_layout_boundary (ClutterActor *self)
+{
+  ClutterActorPrivate *priv = self->priv;
+
+  if (priv->parent == NULL ||
+      (priv->parent->flags & CLUTTER_ACTOR_NO_LAYOUT))
+    return FALSE;
+
+  if (!priv->allocation_request_valid ||
+      !priv->allocation_request_fixed_size ||
+      !clutter_actor_has_fixed_size (self))
+    return FALSE;
+
+  /* the parent may need to reconsider the expand flags of its children */
+  if (priv->needs_compute_expand)
+    return FALSE;
+
+  /* constraints can depend on other actors */
+  if (clutter_actor_has_constraints (self))
+    return FALSE;
+
+  if (priv->position_set != priv->allocation_request_position_set)
+    return FALSE;
+
+  return layout_info_equal (_clutter_actor_get_layout_info_or_defaults (self),
+                            &priv->allocation_request_info);
+}
+
 static void
 clutter_actor_real_queue_relayout (ClutterActor *self)
 {
@@ -2873,10 +3144,8 @@ clutter_actor_real_queue_relayout (ClutterActor *self)
   priv->needs_paint_volume_update = TRUE;
 
   /* reset the cached size requests */
-  memset (priv->width_requests, 0,
-          N_CACHED_SIZE_REQUESTS * sizeof (SizeRequest));
-  memset (priv->height_requests, 0,
-          N_CACHED_SIZE_REQUESTS * sizeof (SizeRequest));
+  size_request_cache_reset (&priv->width_requests);
+  size_request_cache_reset (&priv->height_requests);
 
   /* We may need to go all the way up the hierarchy */
   if (priv->parent != NULL)
@@ -2890,6 +3159,22 @@ clutter_actor_real_queue_relayout (ClutterActor *self)
            */
           priv->parent->priv->needs_paint_volume_update = TRUE;
         }
+      else if (clutter_actor_is_layout_boundary (self))
+        {
+          ClutterActor *iter;
+
+          CLUTTER_NOTE (LAYOUT, "Actor '%s' is a layout boundary, "
+                        "not propagating the relayout to its parent",
+                        _clutter_actor_get_debug_name (self));
+
+          /* our size and position did not change, but our paint volume
+           * may have, and the ancestors' paint volumes depend on it
+           */
+          for (iter = priv->parent; iter != NULL; iter = iter->priv->parent)
+            iter->priv->needs_paint_volume_update = TRUE;
+
+          clutter_actor_queue_shallow_relayout (self);
+        }
       else
         {
           _clutter_actor_queue_only_relayout (priv->parent);
@@ -3610,6 +3895,36 @@ _clutter_actor_update_last_paint_volume (ClutterActor *self)
   priv->last_paint_volume_valid = TRUE;
 }
 
+static void
+clutter_actor_update_offscreen_effects (ClutterActor *self)
+{
+  ClutterActorPrivate *priv = self->priv;
+  guint n_offscreen_effects = 0;
+  const GList *l;
+
+  if (priv->effects != NULL)
+    {
+      for (l = _clutter_meta_group_peek_metas (priv->effects);
+           l != NULL;
+           l = l->next)
+        {
+          if (CLUTTER_IS_OFFSCREEN_EFFECT (l->data))
+            n_offscreen_effects++;
+        }
+    }
+
+  if (n_offscreen_effects > priv->n_offscreen_effects)
+    clutter_actor_push_in_offscreen_effect_branch (self,
+                                                   n_offscreen_effects -
+                                                   priv->n_offscreen_effects);
+  else if (n_offscreen_effects < priv->n_offscreen_effects)
+    clutter_actor_pop_in_offscreen_effect_branch (self,
+                                                  priv->n_offscreen_effects -
+                                                  n_offscreen_effects);
+
+  priv->n_offscreen_effects = n_offscreen_effects;
+}
+
 /* This is the same as clutter_actor_add_effect except that it doesn't
    queue a redraw and it doesn't notify on the effect property */
 static void
@@ -3625,6 +3940,8 @@ _clutter_actor_add_effect_internal (ClutterActor  *self,
     }
 
   _clutter_meta_group_add_meta (priv->effects, CLUTTER_ACTOR_META (effect));
+
+  clutter_actor_update_offscreen_effects (self);
 }
 
 /* This is the same as clutter_actor_remove_effect except that it doesn't
@@ -3642,6 +3959,8 @@ _clutter_actor_remove_effect_internal (ClutterActor  *self,
 
   if (_clutter_meta_group_peek_metas (priv->effects) == NULL)
     g_clear_object (&priv->effects);
+
+  clutter_actor_update_offscreen_effects (self);
 }
 
 static gboolean
@@ -3736,10 +4055,83 @@ clutter_actor_real_paint (ClutterActor        *actor,
     }
 }
 
+static void
+retain_paint_nodes (ClutterActor     *actor,
+                    ClutterPaintNode *root)
+{
+  ClutterActorPrivate *priv = actor->priv;
+  ClutterPaintNode *iter;
+  float resource_scale;
+
+  g_clear_pointer (&priv->retained_paint_nodes, g_ptr_array_unref);
+
+  /* The stage clear node is bound to the framebuffer being painted */
+  if (CLUTTER_ACTOR_IS_TOPLEVEL (actor))
+    return;
+
+  if (!_clutter_actor_get_real_resource_scale (actor, &resource_scale))
+    return;
+
+  priv->retained_paint_nodes =
+    g_ptr_array_new_full (clutter_paint_node_get_n_children (root),
+                          (GDestroyNotify) clutter_paint_node_unref);
+
+  for (iter = clutter_paint_node_get_first_child (root);
+       iter != NULL;
+       iter = clutter_paint_node_get_next_sibling (iter))
+    g_ptr_array_add (priv->retained_paint_nodes, clutter_paint_node_ref (iter));
+
+  priv->retained_width = clutter_actor_box_get_width (&priv->allocation);
+  priv->retained_height = clutter_actor_box_get_height (&priv->allocation);
+  priv->retained_resource_scale = resource_scale;
+  priv->retained_paint_opacity =
+    clutter_actor_get_paint_opacity_internal (actor);
+}
+
 static gboolean
-clutter_actor_paint_node (ClutterActor        *actor,
-                          ClutterPaintNode    *root,
-                          ClutterPaintContext *paint_context)
+replay_retained_paint_nodes (ClutterActor     *actor,
+                             ClutterPaintNode *root)
+{
+  ClutterActorPrivate *priv = actor->priv;
+  float resource_scale;
+  guint i;
+
+  if (priv->retained_paint_nodes == NULL)
+    return FALSE;
+
+  /* Most of what the nodes depend on queues a redraw on the actor when
+   * it changes, which drops them; what is inherited from the ancestors
+   * has to be checked here.
+   */
+  if (priv->retained_width != clutter_actor_box_get_width (&priv->allocation) ||
+      priv->retained_height != clutter_actor_box_get_height (&priv->allocation) ||
+      priv->retained_paint_opacity !=
+        clutter_actor_get_paint_opacity_internal (actor) ||
+      !_clutter_actor_get_real_resource_scale (actor, &resource_scale) ||
+      priv->retained_resource_scale != resource_scale)
+    {
+      g_clear_pointer (&priv->retained_paint_nodes, g_ptr_array_unref);
+      return FALSE;
+    }
+
+  for (i = 0; i < priv->retained_paint_nodes->len; i++)
+    {
+      ClutterPaintNode *node = g_ptr_array_index (priv->retained_paint_nodes, i);
+
+      clutter_paint_node_add_child (root, node);
+    }
+
+  CLUTTER_NOTE (PAINT, "Replaying %u retained paint nodes of '%s'",
+                priv->retained_paint_nodes->len,
+                _clutter_actor_get_debug_name (actor));
+
+  return TRUE;
+}
+
+static void
+clutter_actor_add_paint_nodes (ClutterActor        *actor,
+                               ClutterPaintNode    *root,
+                               ClutterPaintContext *paint_context)
 {
   ClutterActorPrivate *priv = actor->priv;
   ClutterActorBox box;
@@ -3797,6 +4189,23 @@ clutter_actor_paint_node (ClutterActor        *actor,
 
   if (CLUTTER_ACTOR_GET_CLASS (actor)->paint_node != NULL)
     CLUTTER_ACTOR_GET_CLASS (actor)->paint_node (actor, root);
+}
+
+static gboolean
+clutter_actor_paint_node (ClutterActor        *actor,
+                          ClutterPaintNode    *root,
+                          ClutterPaintContext *paint_context)
+{
+  ClutterActorPrivate *priv = actor->priv;
+
+  if (!priv->retain_paint_nodes ||
+      !replay_retained_paint_nodes (actor, root))
+    {
+      clutter_actor_add_paint_nodes (actor, root, paint_context);
+
+      if (priv->retain_paint_nodes)
+        retain_paint_nodes (actor, root);
+    }
 
   if (clutter_paint_node_get_n_children (root) == 0)
     return FALSE;
@@ -4459,6 +4868,10 @@ clutter_actor_remove_child_internal (ClutterActor                 *self,
   if (self->priv->in_cloned_branch)
     clutter_actor_pop_in_cloned_branch (child, self->priv->in_cloned_branch);
 
+  if (self->priv->in_offscreen_effect_branch)
+    clutter_actor_pop_in_offscreen_effect_branch (child,
+                                                  self->priv->in_offscreen_effect_branch);
+
   /* if the child that got removed was visible and set to
    * expand then we want to reset the parent's state in
    * case the child was the only thing that was making it
@@ -6112,6 +6525,7 @@ clutter_actor_dispose (GObject *object)
   g_clear_object (&priv->constraints);
   g_clear_object (&priv->effects);
   g_clear_object (&priv->flatten_effect);
+  g_clear_pointer (&priv->retained_paint_nodes, g_ptr_array_unref);
 
   if (priv->child_model != NULL)
     {
@@ -6157,6 +6571,9 @@ clutter_actor_finalize (GObject *object)
 
   g_free (priv->name);
 
+  size_request_cache_clear (&priv->width_requests);
+  size_request_cache_clear (&priv->height_requests);
+
 #ifdef CLUTTER_ENABLE_DEBUG
   g_free (priv->debug_name);
 #endif
@@ -8727,6 +9144,8 @@ clutter_actor_init (ClutterActor *self)
   priv->needs_paint_volume_update = TRUE;
   priv->needs_compute_resource_scale = TRUE;
 
+  size_request_cache_init (&priv->width_requests);
+  size_request_cache_init (&priv->height_requests);
   priv->cached_width_age = 1;
   priv->cached_height_age = 1;
 
@@ -8854,10 +9273,24 @@ _clutter_actor_finish_queue_redraw (ClutterActor *self,
       if (pv)
         {
           ClutterActor *stage = _clutter_actor_get_stage_internal (self);
+          ClutterPaintVolume *old_pv = &priv->last_paint_volume;
+          ClutterPaintVolume damage_pv;
+          ClutterActor *iter;
+
+          /* The old position goes straight to the stage, so the effects
+           * of our ancestors have to be told about it separately */
+          for (iter = priv->parent;
+               iter != NULL && iter != stage;
+               iter = iter->priv->parent)
+            {
+              if (iter->priv->effects != NULL &&
+                  _clutter_actor_queue_effects_damage (iter, old_pv,
+                                                       &damage_pv))
+                old_pv = &damage_pv;
+            }
 
           /* make sure we redraw the actors old position... */
-          _clutter_actor_propagate_queue_redraw (stage, stage,
-                                                 &priv->last_paint_volume);
+          _clutter_actor_propagate_queue_redraw (stage, stage, old_pv);
         }
     }
 
@@ -9199,6 +9632,46 @@ _clutter_actor_queue_only_relayout (ClutterActor *self)
   g_signal_emit (self, actor_signals[QUEUE_RELAYOUT], 0);
 }
 
+/*< private >
+ * _clutter_actor_relayout:
+ * @self: a #ClutterActor
+ *
+ * Allocates an actor that was queued for relayout on the stage.
+ *
+ * Layout boundaries are allocated again using the box their parent
+ * gave them the last time around; every other actor is allocated at
+ * its preferred size.
+ */
+void
+_clutter_actor_relayout (ClutterActor *self)
+{
+  ClutterActorPrivate *priv = self->priv;
+
+  if (priv->parent == NULL ||
+      (priv->parent->flags & CLUTTER_ACTOR_NO_LAYOUT))
+    {
+      clutter_actor_allocate_preferred_size (self, CLUTTER_ALLOCATION_NONE);
+      return;
+    }
+
+  /* something the parent depends on might have changed after we were
+   * queued; since we already have all the needs_* flags set, the
+   * change did not get propagated, so we need to do it now
+   */
+  if (!clutter_actor_is_layout_boundary (self))
+    {
+      CLUTTER_NOTE (LAYOUT, "Actor '%s' is not a layout boundary anymore",
+                    _clutter_actor_get_debug_name (self));
+
+      _clutter_actor_queue_only_relayout (priv->parent);
+      return;
+    }
+
+  clutter_actor_allocate (self,
+                          &priv->allocation_request,
+                          priv->allocation_request_flags);
+}
+
 /**
  * clutter_actor_queue_redraw_with_clip:
  * @self: a #ClutterActor
@@ -9558,27 +10031,58 @@ clutter_actor_adjust_height (ClutterActor *self,
 
 }
 
+/* grows the cache, returning the first of the new, unused, entries */
+static SizeRequest *
+size_request_cache_grow (SizeRequestCache *cache)
+{
+  SizeRequest *requests;
+  guint old_n_requests = cache->n_requests;
+  guint n_requests;
+
+  n_requests = MIN (old_n_requests * 2, MAX_CACHED_SIZE_REQUESTS);
+
+  requests = g_new0 (SizeRequest, n_requests);
+  memcpy (requests, cache->requests, old_n_requests * sizeof (SizeRequest));
+
+  if (cache->requests != cache->inline_requests)
+    g_free (cache->requests);
+
+  cache->requests = requests;
+  cache->n_requests = n_requests;
+
+  CLUTTER_NOTE (LAYOUT, "Size cache grown to %u entries", n_requests);
+
+  return &cache->requests[old_n_requests];
+}
+
 /* looks for a cached size request for this for_size. If not
- * found, returns the oldest entry so it can be overwritten */
+ * found, returns an unused entry or the oldest one so it can be
+ * overwritten */
 static gboolean
-_clutter_actor_get_cached_size_request (gfloat         for_size,
-                                        SizeRequest   *cached_size_requests,
-                                        SizeRequest  **result)
+_clutter_actor_get_cached_size_request (gfloat             for_size,
+                                        SizeRequestCache  *cache,
+                                        SizeRequest      **result)
 {
   guint i;
 
-  *result = &cached_size_requests[0];
+  *result = &cache->requests[0];
 
-  for (i = 0; i < N_CACHED_SIZE_REQUESTS; i++)
+  for (i = 0; i < cache->n_requests; i++)
     {
       SizeRequest *sr;
 
-      sr = &cached_size_requests[i];
+      sr = &cache->requests[i];
 
       if (sr->age > 0 &&
           sr->for_size == for_size)
         {
-          CLUTTER_NOTE (LAYOUT, "Size cache hit for size: %.2f", for_size);
+#ifdef CLUTTER_ENABLE_DEBUG
+          cache->n_hits += 1;
+#endif
+          CLUTTER_NOTE (LAYOUT, "Size cache hit for size: %.2f "
+                        "(hits: %u, misses: %u, entries: %u)",
+                        for_size,
+                        cache->n_hits, cache->n_misses, cache->n_requests);
           *result = sr;
           return TRUE;
         }
@@ -9588,7 +10092,19 @@ _clutter_actor_get_cached_size_request (gfloat         for_size,
         }
     }
 
-  CLUTTER_NOTE (LAYOUT, "Size cache miss for size: %.2f", for_size);
+  /* Entries are only valid until the next relayout, so if even the
+   * oldest one is in use the layout is asking for more sizes than we
+   * keep, and replacing entries would only make it thrash */
+  if ((*result)->age > 0 && cache->n_requests < MAX_CACHED_SIZE_REQUESTS)
+    *result = size_request_cache_grow (cache);
+
+#ifdef CLUTTER_ENABLE_DEBUG
+  cache->n_misses += 1;
+#endif
+  CLUTTER_NOTE (LAYOUT, "Size cache miss for size: %.2f "
+                "(hits: %u, misses: %u, entries: %u)",
+                for_size,
+                cache->n_hits, cache->n_misses, cache->n_requests);
 
   return FALSE;
 }
@@ -9718,14 +10234,14 @@ clutter_actor_get_preferred_width (ClutterActor *self,
     {
       found_in_cache =
         _clutter_actor_get_cached_size_request (for_height,
-                                                priv->width_requests,
+                                                &priv->width_requests,
                                                 &cached_size_request);
     }
   else
     {
       /* if the actor needs a width request we use the first slot */
       found_in_cache = FALSE;
-      cached_size_request = &priv->width_requests[0];
+      cached_size_request = &priv->width_requests.requests[0];
     }
 
   if (!found_in_cache)
@@ -9883,13 +10399,13 @@ clutter_actor_get_preferred_height (ClutterActor *self,
     {
       found_in_cache =
         _clutter_actor_get_cached_size_request (for_width,
-                                                priv->height_requests,
+                                                &priv->height_requests,
                                                 &cached_size_request);
     }
   else
     {
       found_in_cache = FALSE;
-      cached_size_request = &priv->height_requests[0];
+      cached_size_request = &priv->height_requests.requests[0];
     }
 
   if (!found_in_cache)
@@ -10247,6 +10763,8 @@ clutter_actor_allocate (ClutterActor           *self,
 
   priv = self->priv;
 
+  clutter_actor_store_allocation_request (self, box, flags);
+
   old_allocation = priv->allocation;
   real_allocation = *box;
 
@@ -13054,6 +13572,7 @@ clutter_actor_add_child_internal (ClutterActor              *self,
 
   g_object_ref_sink (child);
   child->priv->parent = NULL;
+  child->priv->allocation_request_valid = FALSE;
   child->priv->next_sibling = NULL;
   child->priv->prev_sibling = NULL;
 
@@ -13069,6 +13588,10 @@ clutter_actor_add_child_internal (ClutterActor              *self,
   if (self->priv->in_cloned_branch)
     clutter_actor_push_in_cloned_branch (child, self->priv->in_cloned_branch);
 
+  if (self->priv->in_offscreen_effect_branch)
+    clutter_actor_push_in_offscreen_effect_branch (child,
+                                                   self->priv->in_offscreen_effect_branch);
+
   /* children may cause their parent to expand, if they are set
    * to expand; if a child is not expanded then it cannot change
    * its parent's state. any further change later on will queue
@@ -15892,6 +16415,63 @@ clutter_actor_get_opacity_override (ClutterActor *self)
   return self->priv->opacity_override;
 }
 
+/**
+ * clutter_actor_set_retain_paint_nodes:
+ * @self: a #ClutterActor
+ * @retain: whether the paint nodes of @self should be retained
+ *
+ * Sets whether @self keeps the #ClutterPaintNode tree it builds for its
+ * background color, its #ClutterContent and #ClutterActorClass.paint_node()
+ * across frames.
+ *
+ * Retained nodes are painted again, instead of being rebuilt, for as long
+ * as no redraw is queued on @self itself and its allocation size, paint
+ * opacity and resource scale stay the same. Redraws queued by children of
+ * @self don't affect its retained nodes, and children are still painted
+ * as usual.
+ *
+ * This is only correct for actors whose paint nodes depend solely on such
+ * state, so it is off by default; implementations of
+ * #ClutterActorClass.paint_node() and #ClutterContent that build different
+ * nodes depending on anything else must not enable it.
+ */
+void
+clutter_actor_set_retain_paint_nodes (ClutterActor *self,
+                                      gboolean      retain)
+{
+  ClutterActorPrivate *priv;
+
+  g_return_if_fail (CLUTTER_IS_ACTOR (self));
+
+  priv = self->priv;
+
+  retain = !!retain;
+  if (priv->retain_paint_nodes == retain)
+    return;
+
+  priv->retain_paint_nodes = retain;
+
+  if (!retain)
+    g_clear_pointer (&priv->retained_paint_nodes, g_ptr_array_unref);
+}
+
+/**
+ * clutter_actor_get_retain_paint_nodes:
+ * @self: a #ClutterActor
+ *
+ * Retrieves whether @self retains its paint nodes across frames, as
+ * set with clutter_actor_set_retain_paint_nodes().
+ *
+ * Returns: %TRUE if the paint nodes of @self are retained
+ */
+gboolean
+clutter_actor_get_retain_paint_nodes (ClutterActor *self)
+{
+  g_return_val_if_fail (CLUTTER_IS_ACTOR (self), FALSE);
+
+  return self->priv->retain_paint_nodes;
+}
+
 /**
  * clutter_actor_inhibit_culling:
  * @actor: a #ClutterActor
@@ -17260,6 +17840,7 @@ clutter_actor_clear_effects (ClutterActor *self)
     return;
 
   _clutter_meta_group_clear_metas_no_internal (self->priv->effects);
+  clutter_actor_update_offscreen_effects (self);
 
   clutter_actor_queue_redraw (self);
 }
@@ -20866,6 +21447,34 @@ clutter_actor_pop_in_cloned_branch (ClutterActor *self,
     clutter_actor_pop_in_cloned_branch (iter, count);
 }
 
+static void
+clutter_actor_push_in_offscreen_effect_branch (ClutterActor *self,
+                                               gulong        count)
+{
+  ClutterActor *iter;
+
+  for (iter = self->priv->first_child;
+       iter != NULL;
+       iter = iter->priv->next_sibling)
+    clutter_actor_push_in_offscreen_effect_branch (iter, count);
+
+  self->priv->in_offscreen_effect_branch += count;
+}
+
+static void
+clutter_actor_pop_in_offscreen_effect_branch (ClutterActor *self,
+                                              gulong        count)
+{
+  ClutterActor *iter;
+
+  self->priv->in_offscreen_effect_branch -= count;
+
+  for (iter = self->priv->first_child;
+       iter != NULL;
+       iter = iter->priv->next_sibling)
+    clutter_actor_pop_in_offscreen_effect_branch (iter, count);
+}
+
 void
 _clutter_actor_attach_clone (ClutterActor *actor,
                              ClutterActor *clone)
@@ -880,6 +880,12 @@ void                            clutter_actor_set_opacity_override
 CLUTTER_EXPORT
 gint                            clutter_actor_get_opacity_override              (ClutterActor               *self);
 
+CLUTTER_EXPORT
+void                            clutter_actor_set_retain_paint_nodes            (ClutterActor               *self,
+                                                                                 gboolean                    retain);
+CLUTTER_EXPORT
+gboolean                        clutter_actor_get_retain_paint_nodes            (ClutterActor               *self);
+
 CLUTTER_EXPORT
 void                            clutter_actor_inhibit_culling                   (ClutterActor               *actor);
 CLUTTER_EXPORT
@@ -1707,6 +1707,26 @@ typedef enum
   CLUTTER_INPUT_PANEL_STATE_TOGGLE,
 } ClutterInputPanelState;
 
+/**
+ * ClutterFrameInfoFlag:
+ * @CLUTTER_FRAME_INFO_FLAG_NONE: No flags set.
+ * @CLUTTER_FRAME_INFO_FLAG_HW_CLOCK: The presentation time was provided
+ *   by the display hardware.
+ * @CLUTTER_FRAME_INFO_FLAG_VSYNC: The frame was presented synchronized
+ *   to the vertical retrace of the display.
+ * @CLUTTER_FRAME_INFO_FLAG_DISCARDED: The frame was never shown on the
+ *   display.
+ *
+ * Flags describing how a frame was presented.
+ */
+typedef enum
+{
+  CLUTTER_FRAME_INFO_FLAG_NONE      = 0,
+  CLUTTER_FRAME_INFO_FLAG_HW_CLOCK  = 1 << 0,
+  CLUTTER_FRAME_INFO_FLAG_VSYNC     = 1 << 1,
+  CLUTTER_FRAME_INFO_FLAG_DISCARDED = 1 << 2,
+} ClutterFrameInfoFlag;
+
 G_END_DECLS
 
 #endif /* __CLUTTER_ENUMS_H__ */
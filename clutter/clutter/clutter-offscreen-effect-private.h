@@ -5,6 +5,9 @@
 
 G_BEGIN_DECLS
 
+void _clutter_offscreen_effect_queue_damage (ClutterOffscreenEffect   *effect,
+                                             const ClutterPaintVolume *volume);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_OFFSCREEN_EFFECT_PRIVATE_H__ */
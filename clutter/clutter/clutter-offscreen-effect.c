@@ -64,7 +64,7 @@
 
 #include "clutter-build-config.h"
 
-#include "clutter-offscreen-effect.h"
+#include "clutter-offscreen-effect-private.h"
 
 #include <math.h>
 
@@ -99,7 +99,33 @@ struct _ClutterOffscreenEffectPrivate
   int target_width;
   int target_height;
 
+  /* The resource scale the current contents of the fbo were rendered
+   * with; a cached image is only reused at the same scale */
+  float capture_resource_scale;
+
+  /* The stage size and the inverse of the actor's eye transform at the
+   * time the fbo was last rendered */
+  float capture_stage_width;
+  float capture_stage_height;
+  CoglMatrix capture_eye_to_actor;
+
+  /* The part of the actor, in actor coordinates, that changed since the
+   * fbo was last rendered */
+  ClutterActorBox damage;
+
   gint old_opacity_override;
+
+  /* Set by clutter_offscreen_effect_invalidate() when the contents of
+   * the fbo must be recaptured even though the actor is not dirty */
+  guint needs_capture : 1;
+
+  guint capture_eye_to_actor_valid : 1;
+  guint has_damage : 1;
+  guint damage_is_full : 1;
+
+  /* Set between pre_paint and post_paint if only the damaged part of
+   * the fbo is being redrawn */
+  guint partial_update : 1;
 };
 
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (ClutterOffscreenEffect,
@@ -119,6 +145,7 @@ clutter_offscreen_effect_set_actor (ClutterActorMeta *meta,
 
   /* clear out the previous state */
   g_clear_pointer (&priv->offscreen, cogl_object_unref);
+  priv->needs_capture = FALSE;
 
   /* we keep a back pointer here, to avoid going through the ActorMeta */
   priv->actor = clutter_actor_meta_get_actor (meta);
@@ -224,6 +251,81 @@ update_fbo (ClutterEffect *effect,
   return TRUE;
 }
 
+static gboolean
+can_update_partially (ClutterOffscreenEffect *self,
+                      int                     target_width,
+                      int                     target_height,
+                      int                     fbo_offset_x,
+                      int                     fbo_offset_y,
+                      float                   resource_scale,
+                      float                   stage_width,
+                      float                   stage_height)
+{
+  ClutterOffscreenEffectPrivate *priv = self->priv;
+
+  if (priv->offscreen == NULL || priv->needs_capture)
+    return FALSE;
+
+  /* Without any recorded damage we can't tell what changed */
+  if (!priv->has_damage || priv->damage_is_full)
+    return FALSE;
+
+  /* The rest of the previous contents are only valid if they would be
+   * rendered in the same place, at the same size.
+   */
+  return priv->target_width == target_width &&
+         priv->target_height == target_height &&
+         priv->fbo_offset_x == fbo_offset_x &&
+         priv->fbo_offset_y == fbo_offset_y &&
+         priv->capture_resource_scale == resource_scale &&
+         priv->capture_stage_width == stage_width &&
+         priv->capture_stage_height == stage_height;
+}
+
+static void
+get_damage_scissor (ClutterOffscreenEffect *self,
+                    const CoglMatrix       *modelview,
+                    const CoglMatrix       *projection,
+                    const float            *viewport,
+                    cairo_rectangle_int_t  *scissor)
+{
+  ClutterOffscreenEffectPrivate *priv = self->priv;
+  graphene_point3d_t vertices[4];
+  float x_min, y_min, x_max, y_max;
+  int x1, y1, x2, y2;
+  int i;
+
+  vertices[0] = GRAPHENE_POINT3D_INIT (priv->damage.x1, priv->damage.y1, 0.f);
+  vertices[1] = GRAPHENE_POINT3D_INIT (priv->damage.x2, priv->damage.y1, 0.f);
+  vertices[2] = GRAPHENE_POINT3D_INIT (priv->damage.x1, priv->damage.y2, 0.f);
+  vertices[3] = GRAPHENE_POINT3D_INIT (priv->damage.x2, priv->damage.y2, 0.f);
+
+  _clutter_util_fully_transform_vertices (modelview, projection, viewport,
+                                          vertices, vertices, 4);
+
+  x_min = x_max = vertices[0].x;
+  y_min = y_max = vertices[0].y;
+
+  for (i = 1; i < 4; i++)
+    {
+      x_min = MIN (x_min, vertices[i].x);
+      y_min = MIN (y_min, vertices[i].y);
+      x_max = MAX (x_max, vertices[i].x);
+      y_max = MAX (y_max, vertices[i].y);
+    }
+
+  /* Round outwards, and stay within the texture */
+  x1 = CLAMP (floorf (x_min), 0, cogl_texture_get_width (priv->texture));
+  y1 = CLAMP (floorf (y_min), 0, cogl_texture_get_height (priv->texture));
+  x2 = CLAMP (ceilf (x_max), x1, cogl_texture_get_width (priv->texture));
+  y2 = CLAMP (ceilf (y_max), y1, cogl_texture_get_height (priv->texture));
+
+  scissor->x = x1;
+  scissor->y = y1;
+  scissor->width = x2 - x1;
+  scissor->height = y2 - y1;
+}
+
 static gboolean
 clutter_offscreen_effect_pre_paint (ClutterEffect       *effect,
                                     ClutterPaintContext *paint_context)
@@ -242,6 +344,10 @@ clutter_offscreen_effect_pre_paint (ClutterEffect       *effect,
   gfloat ceiled_resource_scale;
   graphene_point3d_t local_offset;
   gfloat old_viewport[4];
+  gfloat viewport[4];
+  CoglMatrix eye_transform;
+  int fbo_offset_x, fbo_offset_y;
+  gboolean partial_update;
 
   local_offset = GRAPHENE_POINT3D_INIT (0.0f, 0.0f, 0.0f);
 
@@ -289,8 +395,8 @@ clutter_offscreen_effect_pre_paint (ClutterEffect       *effect,
   box = raw_box;
   _clutter_actor_box_enlarge_for_effects (&box);
 
-  priv->fbo_offset_x = box.x1 - raw_box.x1;
-  priv->fbo_offset_y = box.y1 - raw_box.y1;
+  fbo_offset_x = box.x1 - raw_box.x1;
+  fbo_offset_y = box.y1 - raw_box.y1;
 
   clutter_actor_box_scale (&box, ceiled_resource_scale);
   clutter_actor_box_get_size (&box, &target_width, &target_height);
@@ -298,10 +404,31 @@ clutter_offscreen_effect_pre_paint (ClutterEffect       *effect,
   target_width = ceilf (target_width);
   target_height = ceilf (target_height);
 
+  partial_update = can_update_partially (self,
+                                         target_width, target_height,
+                                         fbo_offset_x, fbo_offset_y,
+                                         resource_scale,
+                                         stage_width, stage_height);
+
+  priv->fbo_offset_x = fbo_offset_x;
+  priv->fbo_offset_y = fbo_offset_y;
+
   /* First assert that the framebuffer is the right size... */
   if (!update_fbo (effect, target_width, target_height, resource_scale))
     return FALSE;
 
+  priv->capture_resource_scale = resource_scale;
+  priv->capture_stage_width = stage_width;
+  priv->capture_stage_height = stage_height;
+
+  /* Remember how to map eye coordinates back into the fbo, for the damage
+   * reported by descendants that moved away from where they were drawn */
+  cogl_matrix_init_identity (&eye_transform);
+  _clutter_actor_apply_relative_transformation_matrix (priv->actor, NULL,
+                                                       &eye_transform);
+  priv->capture_eye_to_actor_valid =
+    cogl_matrix_get_inverse (&eye_transform, &priv->capture_eye_to_actor);
+
   framebuffer = clutter_paint_context_get_framebuffer (paint_context);
   cogl_framebuffer_get_modelview_matrix (framebuffer, &old_modelview);
 
@@ -327,11 +454,15 @@ clutter_offscreen_effect_pre_paint (ClutterEffect       *effect,
   /* Set up the viewport so that it has the same size as the stage (avoid
    * distortion), but translated to account for the FBO offset...
    */
+  viewport[0] = -priv->fbo_offset_x;
+  viewport[1] = -priv->fbo_offset_y;
+  viewport[2] = stage_width;
+  viewport[3] = stage_height;
   cogl_framebuffer_set_viewport (priv->offscreen,
-                                 -priv->fbo_offset_x,
-                                 -priv->fbo_offset_y,
-                                 stage_width,
-                                 stage_height);
+                                 viewport[0],
+                                 viewport[1],
+                                 viewport[2],
+                                 viewport[3]);
 
   /* Copy the stage's projection matrix across to the framebuffer */
   _clutter_stage_get_projection_matrix (CLUTTER_STAGE (priv->stage),
@@ -350,6 +481,25 @@ clutter_offscreen_effect_pre_paint (ClutterEffect       *effect,
 
   cogl_framebuffer_set_projection_matrix (priv->offscreen, &projection);
 
+  /* Keep the previous contents of the fbo outside of the damaged area;
+   * the scissor also clips the clear below.
+   */
+  if (partial_update)
+    {
+      cairo_rectangle_int_t scissor;
+
+      get_damage_scissor (self, &modelview, &projection, viewport, &scissor);
+
+      CLUTTER_NOTE (PAINT, "Updating %dx%d+%d+%d of the offscreen image of '%s'",
+                    scissor.width, scissor.height, scissor.x, scissor.y,
+                    _clutter_actor_get_debug_name (priv->actor));
+
+      cogl_framebuffer_push_scissor_clip (priv->offscreen,
+                                          scissor.x, scissor.y,
+                                          scissor.width, scissor.height);
+    }
+  priv->partial_update = partial_update;
+
   cogl_color_init_from_4ub (&transparent, 0, 0, 0, 0);
   cogl_framebuffer_clear (priv->offscreen,
                           COGL_BUFFER_BIT_COLOR |
@@ -459,11 +609,42 @@ clutter_offscreen_effect_post_paint (ClutterEffect       *effect,
 
   framebuffer = clutter_paint_context_get_framebuffer (paint_context);
   cogl_framebuffer_pop_matrix (framebuffer);
+
+  if (priv->partial_update)
+    {
+      cogl_framebuffer_pop_clip (framebuffer);
+      priv->partial_update = FALSE;
+    }
+
   clutter_paint_context_pop_framebuffer (paint_context);
 
+  /* The fbo now holds an up to date image of the actor */
+  priv->needs_capture = FALSE;
+  priv->has_damage = FALSE;
+  priv->damage_is_full = FALSE;
+
   clutter_offscreen_effect_paint_texture (self, paint_context);
 }
 
+static gboolean
+clutter_offscreen_effect_has_cached_image (ClutterOffscreenEffect *self)
+{
+  ClutterOffscreenEffectPrivate *priv = self->priv;
+  float resource_scale;
+
+  if (priv->offscreen == NULL || priv->needs_capture)
+    return FALSE;
+
+  /* The same actor can be painted on stage views with different scales,
+   * in which case the fbo has to be re-rendered at the new size.
+   */
+  if (!_clutter_actor_get_real_resource_scale (priv->actor, &resource_scale) ||
+      resource_scale != priv->capture_resource_scale)
+    return FALSE;
+
+  return TRUE;
+}
+
 static void
 clutter_offscreen_effect_paint (ClutterEffect           *effect,
                                 ClutterPaintContext     *paint_context,
@@ -482,7 +663,8 @@ clutter_offscreen_effect_paint (ClutterEffect           *effect,
   /* If we've already got a cached image and the actor hasn't been redrawn
    * then we can just use the cached image in the FBO.
    */
-  if (priv->offscreen == NULL || (flags & CLUTTER_EFFECT_PAINT_ACTOR_DIRTY))
+  if ((flags & CLUTTER_EFFECT_PAINT_ACTOR_DIRTY) ||
+      !clutter_offscreen_effect_has_cached_image (self))
     {
       ClutterEffectClass *effect_class = CLUTTER_EFFECT_GET_CLASS (effect);
       gboolean pre_paint_succeeded;
@@ -497,7 +679,12 @@ clutter_offscreen_effect_paint (ClutterEffect           *effect,
         g_clear_pointer (&priv->offscreen, cogl_object_unref);
     }
   else
-    clutter_offscreen_effect_paint_texture (self, paint_context);
+    {
+      CLUTTER_NOTE (PAINT, "Reusing the cached offscreen image of '%s'",
+                    _clutter_actor_get_debug_name (priv->actor));
+
+      clutter_offscreen_effect_paint_texture (self, paint_context);
+    }
 }
 
 static void
@@ -735,3 +922,95 @@ clutter_offscreen_effect_get_target_rect (ClutterOffscreenEffect *effect,
 
   return TRUE;
 }
+
+/*
+ * _clutter_offscreen_effect_queue_damage:
+ * @effect: a #ClutterOffscreenEffect
+ * @volume: (nullable): the volume that needs to be redrawn, or %NULL
+ *
+ * Records that the part of the actor covered by @volume changed since
+ * the offscreen buffer was last rendered. @volume may be relative to the
+ * actor, to any of its descendants, or be in eye coordinates; a %NULL
+ * volume means the whole actor changed.
+ *
+ * The next time the actor is redirected only the damaged part of the
+ * offscreen buffer is redrawn, as long as the rest of it is still valid.
+ */
+void
+_clutter_offscreen_effect_queue_damage (ClutterOffscreenEffect   *effect,
+                                        const ClutterPaintVolume *volume)
+{
+  ClutterOffscreenEffectPrivate *priv = effect->priv;
+  ClutterPaintVolume damage_volume;
+  ClutterActorBox box;
+
+  if (priv->damage_is_full)
+    return;
+
+  if (volume == NULL || priv->actor == NULL)
+    {
+      priv->has_damage = TRUE;
+      priv->damage_is_full = TRUE;
+      return;
+    }
+
+  _clutter_paint_volume_copy_static (volume, &damage_volume);
+
+  if (damage_volume.actor == NULL)
+    {
+      /* Eye coordinates, the only transformation that matters is the one
+       * the actor had when it was drawn into the fbo */
+      if (!priv->capture_eye_to_actor_valid)
+        {
+          priv->has_damage = TRUE;
+          priv->damage_is_full = TRUE;
+          clutter_paint_volume_free (&damage_volume);
+          return;
+        }
+
+      _clutter_paint_volume_set_reference_actor (&damage_volume, priv->actor);
+      _clutter_paint_volume_transform (&damage_volume,
+                                       &priv->capture_eye_to_actor);
+    }
+  else if (damage_volume.actor != priv->actor)
+    {
+      _clutter_paint_volume_transform_relative (&damage_volume, priv->actor);
+    }
+
+  _clutter_paint_volume_get_bounding_box (&damage_volume, &box);
+  clutter_paint_volume_free (&damage_volume);
+
+  if (priv->has_damage)
+    clutter_actor_box_union (&priv->damage, &box, &priv->damage);
+  else
+    priv->damage = box;
+
+  priv->has_damage = TRUE;
+}
+
+/**
+ * clutter_offscreen_effect_invalidate:
+ * @effect: a #ClutterOffscreenEffect
+ *
+ * Discards the image of the actor cached in the offscreen buffer of
+ * @effect and queues a repaint, so that the actor is redirected and
+ * painted again on the next frame.
+ *
+ * #ClutterOffscreenEffect reuses the contents of its offscreen buffer
+ * for as long as neither the actor nor any of its children have queued
+ * a redraw. Sub-classes that only change the way the cached texture is
+ * drawn inside #ClutterOffscreenEffectClass.paint_target() should keep
+ * using clutter_effect_queue_repaint(); this function is meant for
+ * effects that alter what gets rendered into the offscreen buffer
+ * itself, for instance from their #ClutterEffectClass.pre_paint()
+ * implementation.
+ */
+void
+clutter_offscreen_effect_invalidate (ClutterOffscreenEffect *effect)
+{
+  g_return_if_fail (CLUTTER_IS_OFFSCREEN_EFFECT (effect));
+
+  effect->priv->needs_capture = TRUE;
+
+  clutter_effect_queue_repaint (CLUTTER_EFFECT (effect));
+}
@@ -118,6 +118,9 @@ CLUTTER_EXPORT
 gboolean        clutter_offscreen_effect_get_target_rect        (ClutterOffscreenEffect *effect,
                                                                  graphene_rect_t        *rect);
 
+CLUTTER_EXPORT
+void            clutter_offscreen_effect_invalidate             (ClutterOffscreenEffect *effect);
+
 G_END_DECLS
 
 #endif /* __CLUTTER_OFFSCREEN_EFFECT_H__ */
@@ -139,6 +139,11 @@ void            _clutter_stage_presented                (ClutterStage      *stag
                                                          CoglFrameEvent     frame_event,
                                                          ClutterFrameInfo  *frame_info);
 
+CLUTTER_EXPORT
+void            _clutter_stage_view_presented           (ClutterStage      *stage,
+                                                         ClutterStageView  *view,
+                                                         ClutterFrameInfo  *frame_info);
+
 void            clutter_stage_queue_actor_relayout      (ClutterStage *stage,
                                                          ClutterActor *actor);
 
@@ -170,6 +170,7 @@ enum
   AFTER_PAINT,
   PAINT_VIEW,
   PRESENTED,
+  VIEW_PRESENTED,
 
   LAST_SIGNAL
 };
@@ -1359,8 +1360,7 @@ _clutter_stage_maybe_relayout (ClutterActor *actor)
       CLUTTER_SET_PRIVATE_FLAGS (queued_actor, CLUTTER_IN_RELAYOUT);
 
       old_version = priv->pending_relayouts_version;
-      clutter_actor_allocate_preferred_size (queued_actor,
-                                             CLUTTER_ALLOCATION_NONE);
+      _clutter_actor_relayout (queued_actor);
 
       CLUTTER_UNSET_PRIVATE_FLAGS (queued_actor, CLUTTER_IN_RELAYOUT);
 
@@ -2173,6 +2173,25 @@ clutter_stage_class_init (ClutterStageClass *klass)
                   G_TYPE_NONE, 2,
                   G_TYPE_INT, G_TYPE_POINTER);
 
+  /**
+   * ClutterStage::view-presented: (skip)
+   * @stage: the stage that received the event
+   * @view: the #ClutterStageView that was presented
+   * @frame_info: a #ClutterFrameInfo
+   *
+   * Signals that a frame of @view was presented on the screen to the user,
+   * for stage windows where each view is presented on its own. Unlike
+   * #ClutterStage::presented, this is emitted for every view.
+   */
+  stage_signals[VIEW_PRESENTED] =
+    g_signal_new (I_("view-presented"),
+                  G_TYPE_FROM_CLASS (gobject_class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 2,
+                  CLUTTER_TYPE_STAGE_VIEW,
+                  G_TYPE_POINTER);
+
   klass->activate = clutter_stage_real_activate;
   klass->deactivate = clutter_stage_real_deactivate;
   klass->delete_event = clutter_stage_real_delete_event;
@@ -4017,6 +4036,15 @@ _clutter_stage_presented (ClutterStage     *stage,
                  (int) frame_event, frame_info);
 }
 
+void
+_clutter_stage_view_presented (ClutterStage     *stage,
+                               ClutterStageView *view,
+                               ClutterFrameInfo *frame_info)
+{
+  g_signal_emit (stage, stage_signals[VIEW_PRESENTED], 0,
+                 view, frame_info);
+}
+
 static void
 capture_view (ClutterStage          *stage,
               gboolean               paint,
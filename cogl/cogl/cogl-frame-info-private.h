@@ -34,6 +34,17 @@
 #include "cogl-frame-info.h"
 #include "cogl-object-private.h"
 
+typedef enum _CoglFrameInfoFlag
+{
+  COGL_FRAME_INFO_FLAG_NONE = 0,
+  /* presentation_time timestamp was provided by the hardware */
+  COGL_FRAME_INFO_FLAG_HW_CLOCK = 1 << 0,
+  /* The frame was presented synchronized to the vertical retrace */
+  COGL_FRAME_INFO_FLAG_VSYNC = 1 << 1,
+  /* The frame was never shown, e.g. because its page flip failed */
+  COGL_FRAME_INFO_FLAG_DISCARDED = 1 << 2,
+} CoglFrameInfoFlag;
+
 struct _CoglFrameInfo
 {
   CoglObject _parent;
@@ -42,6 +53,9 @@ struct _CoglFrameInfo
   int64_t presentation_time;
   float refresh_rate;
 
+  CoglFrameInfoFlag flags;
+  unsigned int sequence;
+
   int64_t global_frame_counter;
 
   CoglOutput *output;
@@ -146,6 +146,46 @@ cogl_frame_info_get_output (CoglFrameInfo *info);
 COGL_EXPORT
 int64_t cogl_frame_info_get_global_frame_counter (CoglFrameInfo *info);
 
+/**
+ * cogl_frame_info_is_hw_clock: (skip)
+ * @info: a #CoglFrameInfo object
+ *
+ * Return value: %TRUE if the presentation time was provided by the
+ *   display hardware, e.g. a KMS page flip event.
+ */
+COGL_EXPORT
+gboolean cogl_frame_info_is_hw_clock (CoglFrameInfo *info);
+
+/**
+ * cogl_frame_info_is_vsync: (skip)
+ * @info: a #CoglFrameInfo object
+ *
+ * Return value: %TRUE if the frame was presented synchronized to the
+ *   vertical retrace of the display.
+ */
+COGL_EXPORT
+gboolean cogl_frame_info_is_vsync (CoglFrameInfo *info);
+
+/**
+ * cogl_frame_info_is_discarded: (skip)
+ * @info: a #CoglFrameInfo object
+ *
+ * Return value: %TRUE if the frame was never shown on the display, for
+ *   example because its page flip failed.
+ */
+COGL_EXPORT
+gboolean cogl_frame_info_is_discarded (CoglFrameInfo *info);
+
+/**
+ * cogl_frame_info_get_sequence: (skip)
+ * @info: a #CoglFrameInfo object
+ *
+ * Return value: the vertical retrace counter of the display the frame
+ *   was presented on, or 0 if not known.
+ */
+COGL_EXPORT
+unsigned int cogl_frame_info_get_sequence (CoglFrameInfo *info);
+
 G_END_DECLS
 
 #endif /* __COGL_FRAME_INFO_H */
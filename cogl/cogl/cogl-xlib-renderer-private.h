@@ -52,6 +52,9 @@ typedef struct _CoglXlibRenderer
   unsigned long outputs_update_serial;
 
   XVisualInfo *xvisinfo;
+
+  /* Whether the X server can export the buffers of pixmaps (DRI3 1.2) */
+  gboolean dri3_buffers_from_pixmap;
 } CoglXlibRenderer;
 
 gboolean
@@ -81,6 +81,20 @@ COGL_WINSYS_FEATURE_BEGIN (image_pixmap,
                            "image_pixmap\0",
                            COGL_EGL_WINSYS_FEATURE_EGL_IMAGE_FROM_X11_PIXMAP)
 COGL_WINSYS_FEATURE_END ()
+#ifdef EGL_EXT_image_dma_buf_import
+COGL_WINSYS_FEATURE_BEGIN (image_dma_buf_import,
+                           "EXT\0",
+                           "image_dma_buf_import\0",
+                           COGL_EGL_WINSYS_FEATURE_EGL_IMAGE_FROM_DMA_BUF)
+COGL_WINSYS_FEATURE_END ()
+#endif
+#ifdef EGL_EXT_image_dma_buf_import_modifiers
+COGL_WINSYS_FEATURE_BEGIN (image_dma_buf_import_modifiers,
+                           "EXT\0",
+                           "image_dma_buf_import_modifiers\0",
+                           COGL_EGL_WINSYS_FEATURE_DMA_BUF_MODIFIERS)
+COGL_WINSYS_FEATURE_END ()
+#endif
 #ifdef EGL_WL_bind_wayland_display
 COGL_WINSYS_FEATURE_BEGIN (bind_wayland_display,
                            "WL\0",
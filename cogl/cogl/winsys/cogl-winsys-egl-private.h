@@ -107,6 +107,8 @@ typedef enum _CoglEGLWinsysFeature
   COGL_EGL_WINSYS_FEATURE_FENCE_SYNC                    =1L<<5,
   COGL_EGL_WINSYS_FEATURE_SURFACELESS_CONTEXT           =1L<<6,
   COGL_EGL_WINSYS_FEATURE_CONTEXT_PRIORITY              =1L<<7,
+  COGL_EGL_WINSYS_FEATURE_EGL_IMAGE_FROM_DMA_BUF        =1L<<8,
+  COGL_EGL_WINSYS_FEATURE_DMA_BUF_MODIFIERS             =1L<<9,
 } CoglEGLWinsysFeature;
 
 typedef struct _CoglRendererEGL
@@ -35,6 +35,14 @@
 
 #include <X11/Xlib.h>
 
+#ifdef HAVE_COGL_XCB_DRI3
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <X11/Xlib-xcb.h>
+#include <xcb/dri3.h>
+#endif
+
 #include "cogl-xlib-renderer-private.h"
 #include "cogl-xlib-renderer.h"
 #include "cogl-framebuffer-private.h"
@@ -290,6 +298,34 @@ _cogl_winsys_egl_get_display (void *native)
   return eglGetDisplay ((EGLNativeDisplayType) native);
 }
 
+#ifdef HAVE_COGL_XCB_DRI3
+static gboolean
+check_dri3_buffers_from_pixmap (Display *xdpy)
+{
+  xcb_connection_t *xcb_conn = XGetXCBConnection (xdpy);
+  const xcb_query_extension_reply_t *extension;
+  xcb_dri3_query_version_cookie_t cookie;
+  xcb_dri3_query_version_reply_t *reply;
+  gboolean ret;
+
+  extension = xcb_get_extension_data (xcb_conn, &xcb_dri3_id);
+  if (!extension || !extension->present)
+    return FALSE;
+
+  /* BuffersFromPixmap was added in DRI3 1.2 */
+  cookie = xcb_dri3_query_version (xcb_conn, 1, 2);
+  reply = xcb_dri3_query_version_reply (xcb_conn, cookie, NULL);
+  if (!reply)
+    return FALSE;
+
+  ret = (reply->major_version > 1 ||
+         (reply->major_version == 1 && reply->minor_version >= 2));
+  free (reply);
+
+  return ret;
+}
+#endif
+
 static gboolean
 _cogl_winsys_renderer_connect (CoglRenderer *renderer,
                                GError **error)
@@ -311,6 +347,11 @@ _cogl_winsys_renderer_connect (CoglRenderer *renderer,
   if (!_cogl_winsys_egl_renderer_connect_common (renderer, error))
     goto error;
 
+#ifdef HAVE_COGL_XCB_DRI3
+  xlib_renderer->dri3_buffers_from_pixmap =
+    check_dri3_buffers_from_pixmap (xlib_renderer->xdpy);
+#endif
+
   return TRUE;
 
 error:
@@ -711,6 +752,163 @@ _cogl_winsys_egl_cleanup_context (CoglDisplay *display)
 
 #ifdef EGL_KHR_image_pixmap
 
+#if defined(HAVE_COGL_XCB_DRI3) && defined(EGL_EXT_image_dma_buf_import)
+
+/* Avoid depending on libdrm just for these */
+#define COGL_DRM_FOURCC(a, b, c, d) \
+  ((uint32_t) (a) | ((uint32_t) (b) << 8) | \
+   ((uint32_t) (c) << 16) | ((uint32_t) (d) << 24))
+#define COGL_DRM_FORMAT_ARGB8888 COGL_DRM_FOURCC ('A', 'R', '2', '4')
+#define COGL_DRM_FORMAT_XRGB8888 COGL_DRM_FOURCC ('X', 'R', '2', '4')
+#define COGL_DRM_FORMAT_MOD_INVALID ((UINT64_C (1) << 56) - 1)
+
+#define COGL_DRI3_MAX_PLANES 4
+
+static EGLImageKHR
+create_image_from_dri3_buffers (CoglContext          *ctx,
+                                CoglTexturePixmapX11 *tex_pixmap)
+{
+  static const EGLint plane_attribs[COGL_DRI3_MAX_PLANES][3] = {
+    {
+      EGL_DMA_BUF_PLANE0_FD_EXT,
+      EGL_DMA_BUF_PLANE0_OFFSET_EXT,
+      EGL_DMA_BUF_PLANE0_PITCH_EXT,
+    },
+    {
+      EGL_DMA_BUF_PLANE1_FD_EXT,
+      EGL_DMA_BUF_PLANE1_OFFSET_EXT,
+      EGL_DMA_BUF_PLANE1_PITCH_EXT,
+    },
+    {
+      EGL_DMA_BUF_PLANE2_FD_EXT,
+      EGL_DMA_BUF_PLANE2_OFFSET_EXT,
+      EGL_DMA_BUF_PLANE2_PITCH_EXT,
+    },
+    {
+      EGL_DMA_BUF_PLANE3_FD_EXT,
+      EGL_DMA_BUF_PLANE3_OFFSET_EXT,
+      EGL_DMA_BUF_PLANE3_PITCH_EXT,
+    },
+  };
+#ifdef EGL_EXT_image_dma_buf_import_modifiers
+  static const EGLint modifier_attribs[COGL_DRI3_MAX_PLANES][2] = {
+    {
+      EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT,
+      EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT,
+    },
+    {
+      EGL_DMA_BUF_PLANE1_MODIFIER_LO_EXT,
+      EGL_DMA_BUF_PLANE1_MODIFIER_HI_EXT,
+    },
+    {
+      EGL_DMA_BUF_PLANE2_MODIFIER_LO_EXT,
+      EGL_DMA_BUF_PLANE2_MODIFIER_HI_EXT,
+    },
+    {
+      EGL_DMA_BUF_PLANE3_MODIFIER_LO_EXT,
+      EGL_DMA_BUF_PLANE3_MODIFIER_HI_EXT,
+    },
+  };
+#endif
+  CoglTexture *tex = COGL_TEXTURE (tex_pixmap);
+  CoglRenderer *renderer = ctx->display->renderer;
+  CoglRendererEGL *egl_renderer = renderer->winsys;
+  CoglXlibRenderer *xlib_renderer = _cogl_xlib_renderer_get_data (renderer);
+  xcb_connection_t *xcb_conn = XGetXCBConnection (xlib_renderer->xdpy);
+  xcb_dri3_buffers_from_pixmap_cookie_t cookie;
+  xcb_dri3_buffers_from_pixmap_reply_t *reply;
+  EGLImageKHR image = EGL_NO_IMAGE_KHR;
+  /* Size, format and NONE, plus fd, offset, pitch and modifier per plane */
+  EGLint attribs[7 + COGL_DRI3_MAX_PLANES * 10];
+  uint32_t *strides, *offsets;
+  uint32_t fourcc;
+  int *fds;
+  int i, n_attribs = 0;
+
+  if (!xlib_renderer->dri3_buffers_from_pixmap)
+    return EGL_NO_IMAGE_KHR;
+
+  switch (tex_pixmap->depth)
+    {
+    case 32:
+      fourcc = COGL_DRM_FORMAT_ARGB8888;
+      break;
+    case 24:
+      fourcc = COGL_DRM_FORMAT_XRGB8888;
+      break;
+    default:
+      return EGL_NO_IMAGE_KHR;
+    }
+
+  cookie = xcb_dri3_buffers_from_pixmap (xcb_conn, tex_pixmap->pixmap);
+  reply = xcb_dri3_buffers_from_pixmap_reply (xcb_conn, cookie, NULL);
+  if (!reply)
+    return EGL_NO_IMAGE_KHR;
+
+  fds = xcb_dri3_buffers_from_pixmap_reply_fds (xcb_conn, reply);
+  strides = xcb_dri3_buffers_from_pixmap_strides (reply);
+  offsets = xcb_dri3_buffers_from_pixmap_offsets (reply);
+
+  if (reply->nfd < 1 || reply->nfd > COGL_DRI3_MAX_PLANES ||
+      reply->width != tex->width || reply->height != tex->height ||
+      reply->bpp != 32)
+    goto out;
+
+#ifdef EGL_EXT_image_dma_buf_import_modifiers
+  if (reply->modifier != COGL_DRM_FORMAT_MOD_INVALID &&
+      !(egl_renderer->private_features &
+        COGL_EGL_WINSYS_FEATURE_DMA_BUF_MODIFIERS))
+    goto out;
+#else
+  if (reply->modifier != COGL_DRM_FORMAT_MOD_INVALID)
+    goto out;
+#endif
+
+  attribs[n_attribs++] = EGL_WIDTH;
+  attribs[n_attribs++] = reply->width;
+  attribs[n_attribs++] = EGL_HEIGHT;
+  attribs[n_attribs++] = reply->height;
+  attribs[n_attribs++] = EGL_LINUX_DRM_FOURCC_EXT;
+  attribs[n_attribs++] = fourcc;
+
+  for (i = 0; i < reply->nfd; i++)
+    {
+      attribs[n_attribs++] = plane_attribs[i][0];
+      attribs[n_attribs++] = fds[i];
+      attribs[n_attribs++] = plane_attribs[i][1];
+      attribs[n_attribs++] = offsets[i];
+      attribs[n_attribs++] = plane_attribs[i][2];
+      attribs[n_attribs++] = strides[i];
+
+#ifdef EGL_EXT_image_dma_buf_import_modifiers
+      if (reply->modifier != COGL_DRM_FORMAT_MOD_INVALID)
+        {
+          attribs[n_attribs++] = modifier_attribs[i][0];
+          attribs[n_attribs++] = reply->modifier & 0xffffffff;
+          attribs[n_attribs++] = modifier_attribs[i][1];
+          attribs[n_attribs++] = reply->modifier >> 32;
+        }
+#endif
+    }
+
+  attribs[n_attribs++] = EGL_NONE;
+
+  image = _cogl_egl_create_image (ctx,
+                                  EGL_LINUX_DMA_BUF_EXT,
+                                  NULL,
+                                  attribs);
+
+out:
+  /* The EGL image holds its own references to the buffers */
+  for (i = 0; i < reply->nfd; i++)
+    close (fds[i]);
+  free (reply);
+
+  return image;
+}
+
+#endif /* HAVE_COGL_XCB_DRI3 && EGL_EXT_image_dma_buf_import */
+
 static gboolean
 _cogl_winsys_texture_pixmap_x11_create (CoglTexturePixmapX11 *tex_pixmap)
 {
@@ -724,7 +922,8 @@ _cogl_winsys_texture_pixmap_x11_create (CoglTexturePixmapX11 *tex_pixmap)
   egl_renderer = ctx->display->renderer->winsys;
 
   if (!(egl_renderer->private_features &
-        COGL_EGL_WINSYS_FEATURE_EGL_IMAGE_FROM_X11_PIXMAP) ||
+        (COGL_EGL_WINSYS_FEATURE_EGL_IMAGE_FROM_X11_PIXMAP |
+         COGL_EGL_WINSYS_FEATURE_EGL_IMAGE_FROM_DMA_BUF)) ||
       !_cogl_has_private_feature
       (ctx, COGL_PRIVATE_FEATURE_TEXTURE_2D_FROM_EGL_IMAGE))
     {
@@ -733,12 +932,29 @@ _cogl_winsys_texture_pixmap_x11_create (CoglTexturePixmapX11 *tex_pixmap)
     }
 
   egl_tex_pixmap = g_new0 (CoglTexturePixmapEGL, 1);
+  egl_tex_pixmap->image = EGL_NO_IMAGE_KHR;
+
+  if (egl_renderer->private_features &
+      COGL_EGL_WINSYS_FEATURE_EGL_IMAGE_FROM_X11_PIXMAP)
+    {
+      egl_tex_pixmap->image =
+        _cogl_egl_create_image (ctx,
+                                EGL_NATIVE_PIXMAP_KHR,
+                                (EGLClientBuffer)tex_pixmap->pixmap,
+                                attribs);
+    }
+
+#if defined(HAVE_COGL_XCB_DRI3) && defined(EGL_EXT_image_dma_buf_import)
+  /* Without EGL_KHR_image_pixmap, or when it can't handle the pixmap, get
+   * the buffers backing the pixmap from the X server and import those
+   * rather than falling back to copying the pixmap contents around.
+   */
+  if (egl_tex_pixmap->image == EGL_NO_IMAGE_KHR &&
+      egl_renderer->private_features &
+      COGL_EGL_WINSYS_FEATURE_EGL_IMAGE_FROM_DMA_BUF)
+    egl_tex_pixmap->image = create_image_from_dri3_buffers (ctx, tex_pixmap);
+#endif
 
-  egl_tex_pixmap->image =
-    _cogl_egl_create_image (ctx,
-                            EGL_NATIVE_PIXMAP_KHR,
-                            (EGLClientBuffer)tex_pixmap->pixmap,
-                            attribs);
   if (egl_tex_pixmap->image == EGL_NO_IMAGE_KHR)
     {
       g_free (egl_tex_pixmap);
@@ -911,6 +911,12 @@ _cogl_egl_create_image (CoglContext *ctx,
   if (target == EGL_NATIVE_PIXMAP_KHR)
     egl_ctx = EGL_NO_CONTEXT;
   else
+#endif
+  /* Likewise for EGL_EXT_image_dma_buf_import and EGL_LINUX_DMA_BUF_EXT */
+#ifdef EGL_EXT_image_dma_buf_import
+  if (target == EGL_LINUX_DMA_BUF_EXT)
+    egl_ctx = EGL_NO_CONTEXT;
+  else
 #endif
 #ifdef COGL_HAS_WAYLAND_EGL_SERVER_SUPPORT
   /* The WL_bind_wayland_display spec states that EGL_NO_CONTEXT is to be used
@@ -71,6 +71,12 @@ struct _MetaEgl
 
   PFNEGLQUERYDMABUFFORMATSEXTPROC eglQueryDmaBufFormatsEXT;
   PFNEGLQUERYDMABUFMODIFIERSEXTPROC eglQueryDmaBufModifiersEXT;
+
+  PFNEGLCREATESYNCKHRPROC eglCreateSyncKHR;
+  PFNEGLDESTROYSYNCKHRPROC eglDestroySyncKHR;
+  PFNEGLCLIENTWAITSYNCKHRPROC eglClientWaitSyncKHR;
+  PFNEGLWAITSYNCKHRPROC eglWaitSyncKHR;
+  PFNEGLDUPNATIVEFENCEFDANDROIDPROC eglDupNativeFenceFDANDROID;
 };
 
 G_DEFINE_TYPE (MetaEgl, meta_egl, G_TYPE_OBJECT)
@@ -1064,6 +1070,105 @@ meta_egl_query_dma_buf_modifiers (MetaEgl      *egl,
     return TRUE;
 }
 
+EGLSyncKHR
+meta_egl_create_sync (MetaEgl       *egl,
+                      EGLDisplay     display,
+                      EGLenum        type,
+                      const EGLint  *attrib_list,
+                      GError       **error)
+{
+  EGLSyncKHR sync;
+
+  if (!is_egl_proc_valid (egl->eglCreateSyncKHR, error))
+    return EGL_NO_SYNC_KHR;
+
+  sync = egl->eglCreateSyncKHR (display, type, attrib_list);
+  if (sync == EGL_NO_SYNC_KHR)
+    {
+      set_egl_error (error);
+      return EGL_NO_SYNC_KHR;
+    }
+
+  return sync;
+}
+
+gboolean
+meta_egl_destroy_sync (MetaEgl    *egl,
+                       EGLDisplay  display,
+                       EGLSyncKHR  sync,
+                       GError    **error)
+{
+  if (!is_egl_proc_valid (egl->eglDestroySyncKHR, error))
+    return FALSE;
+
+  if (!egl->eglDestroySyncKHR (display, sync))
+    {
+      set_egl_error (error);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+gboolean
+meta_egl_client_wait_sync (MetaEgl    *egl,
+                           EGLDisplay  display,
+                           EGLSyncKHR  sync,
+                           EGLint      flags,
+                           EGLTimeKHR  timeout,
+                           GError    **error)
+{
+  if (!is_egl_proc_valid (egl->eglClientWaitSyncKHR, error))
+    return FALSE;
+
+  if (egl->eglClientWaitSyncKHR (display, sync, flags, timeout) == EGL_FALSE)
+    {
+      set_egl_error (error);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+gboolean
+meta_egl_wait_sync (MetaEgl    *egl,
+                    EGLDisplay  display,
+                    EGLSyncKHR  sync,
+                    GError    **error)
+{
+  if (!is_egl_proc_valid (egl->eglWaitSyncKHR, error))
+    return FALSE;
+
+  if (egl->eglWaitSyncKHR (display, sync, 0) == EGL_FALSE)
+    {
+      set_egl_error (error);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+int
+meta_egl_dup_native_fence_fd (MetaEgl    *egl,
+                              EGLDisplay  display,
+                              EGLSyncKHR  sync,
+                              GError    **error)
+{
+  int fd;
+
+  if (!is_egl_proc_valid (egl->eglDupNativeFenceFDANDROID, error))
+    return EGL_NO_NATIVE_FENCE_FD_ANDROID;
+
+  fd = egl->eglDupNativeFenceFDANDROID (display, sync);
+  if (fd == EGL_NO_NATIVE_FENCE_FD_ANDROID)
+    {
+      set_egl_error (error);
+      return EGL_NO_NATIVE_FENCE_FD_ANDROID;
+    }
+
+  return fd;
+}
+
 #define GET_EGL_PROC_ADDR(proc) \
   egl->proc = (void *) eglGetProcAddress (#proc);
 
@@ -1102,6 +1207,12 @@ meta_egl_constructed (GObject *object)
 
   GET_EGL_PROC_ADDR (eglQueryDmaBufFormatsEXT);
   GET_EGL_PROC_ADDR (eglQueryDmaBufModifiersEXT);
+
+  GET_EGL_PROC_ADDR (eglCreateSyncKHR);
+  GET_EGL_PROC_ADDR (eglDestroySyncKHR);
+  GET_EGL_PROC_ADDR (eglClientWaitSyncKHR);
+  GET_EGL_PROC_ADDR (eglWaitSyncKHR);
+  GET_EGL_PROC_ADDR (eglDupNativeFenceFDANDROID);
 }
 
 #undef GET_EGL_PROC_ADDR
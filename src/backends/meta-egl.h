@@ -260,4 +260,32 @@ gboolean meta_egl_query_dma_buf_modifiers (MetaEgl      *egl,
                                            EGLint       *num_formats,
                                            GError      **error);
 
+EGLSyncKHR meta_egl_create_sync (MetaEgl       *egl,
+                                 EGLDisplay     display,
+                                 EGLenum        type,
+                                 const EGLint  *attrib_list,
+                                 GError       **error);
+
+gboolean meta_egl_destroy_sync (MetaEgl    *egl,
+                                EGLDisplay  display,
+                                EGLSyncKHR  sync,
+                                GError    **error);
+
+gboolean meta_egl_client_wait_sync (MetaEgl    *egl,
+                                    EGLDisplay  display,
+                                    EGLSyncKHR  sync,
+                                    EGLint      flags,
+                                    EGLTimeKHR  timeout,
+                                    GError    **error);
+
+gboolean meta_egl_wait_sync (MetaEgl    *egl,
+                             EGLDisplay  display,
+                             EGLSyncKHR  sync,
+                             GError    **error);
+
+int meta_egl_dup_native_fence_fd (MetaEgl    *egl,
+                                  EGLDisplay  display,
+                                  EGLSyncKHR  sync,
+                                  GError    **error);
+
 #endif /* META_EGL_H */
@@ -51,6 +51,7 @@
 #ifdef HAVE_WAYLAND
 #include "wayland/meta-cursor-sprite-wayland.h"
 #include "wayland/meta-wayland-buffer.h"
+#include "wayland/meta-wayland-shm.h"
 #endif
 
 #ifndef DRM_CAP_CURSOR_WIDTH
@@ -1407,7 +1408,7 @@ realize_cursor_sprite_from_wl_buffer_for_gpu (MetaCursorRenderer      *renderer,
   uint width, height;
   MetaWaylandBuffer *buffer;
   struct wl_resource *buffer_resource;
-  struct wl_shm_buffer *shm_buffer;
+  MetaWaylandShmBuffer *shm_buffer;
 
   cursor_renderer_gpu_data =
     meta_cursor_renderer_native_gpu_data_from_gpu (gpu_kms);
@@ -1428,10 +1429,10 @@ realize_cursor_sprite_from_wl_buffer_for_gpu (MetaCursorRenderer      *renderer,
 
   ensure_cursor_priv (cursor_sprite);
 
-  shm_buffer = wl_shm_buffer_get (buffer_resource);
+  shm_buffer = meta_wayland_shm_buffer_from_resource (buffer_resource);
   if (shm_buffer)
     {
-      int rowstride = wl_shm_buffer_get_stride (shm_buffer);
+      int rowstride = meta_wayland_shm_buffer_get_stride (shm_buffer);
       uint8_t *buffer_data;
       float relative_scale;
       MetaMonitorTransform relative_transform;
@@ -1457,13 +1458,13 @@ realize_cursor_sprite_from_wl_buffer_for_gpu (MetaCursorRenderer      *renderer,
                           relative_scale,
                           relative_transform);
 
-      wl_shm_buffer_begin_access (shm_buffer);
-      buffer_data = wl_shm_buffer_get_data (shm_buffer);
+      meta_wayland_shm_buffer_begin_access (shm_buffer);
+      buffer_data = meta_wayland_shm_buffer_get_data (shm_buffer);
 
-      width = wl_shm_buffer_get_width (shm_buffer);
-      height = wl_shm_buffer_get_height (shm_buffer);
+      width = meta_wayland_shm_buffer_get_width (shm_buffer);
+      height = meta_wayland_shm_buffer_get_height (shm_buffer);
 
-      switch (wl_shm_buffer_get_format (shm_buffer))
+      switch (meta_wayland_shm_buffer_get_format (shm_buffer))
         {
         case WL_SHM_FORMAT_ARGB8888:
           gbm_format = GBM_FORMAT_ARGB8888;
@@ -1487,7 +1488,7 @@ realize_cursor_sprite_from_wl_buffer_for_gpu (MetaCursorRenderer      *renderer,
                                                  rowstride,
                                                  gbm_format);
 
-      wl_shm_buffer_end_access (shm_buffer);
+      meta_wayland_shm_buffer_end_access (shm_buffer);
     }
   else
     {
@@ -1113,9 +1113,11 @@ meta_onscreen_native_swap_drm_fb (CoglOnscreen *onscreen)
 }
 
 static void
-notify_view_crtc_presented (MetaRendererView *view,
-                            MetaKmsCrtc      *kms_crtc,
-                            int64_t           time_ns)
+notify_view_crtc_presented (MetaRendererView  *view,
+                            MetaKmsCrtc       *kms_crtc,
+                            int64_t            time_ns,
+                            unsigned int       sequence,
+                            CoglFrameInfoFlag  flags)
 {
   ClutterStageView *stage_view = CLUTTER_STAGE_VIEW (view);
   CoglFramebuffer *framebuffer =
@@ -1145,6 +1147,8 @@ notify_view_crtc_presented (MetaRendererView *view,
     {
       frame_info->presentation_time = time_ns;
       frame_info->refresh_rate = refresh_rate;
+      frame_info->sequence = sequence;
+      frame_info->flags = flags;
     }
 
   gpu_kms = META_GPU_KMS (meta_crtc_get_gpu (crtc));
@@ -1204,7 +1208,10 @@ page_flip_feedback_flipped (MetaKmsCrtc  *kms_crtc,
   };
 
   notify_view_crtc_presented (view, kms_crtc,
-                              timeval_to_nanoseconds (&page_flip_time));
+                              timeval_to_nanoseconds (&page_flip_time),
+                              sequence,
+                              COGL_FRAME_INFO_FLAG_HW_CLOCK |
+                              COGL_FRAME_INFO_FLAG_VSYNC);
 
   g_object_unref (view);
 }
@@ -1227,7 +1234,8 @@ page_flip_feedback_mode_set_fallback (MetaKmsCrtc *kms_crtc,
   gpu_kms = META_GPU_KMS (meta_crtc_get_gpu (crtc));
   now_ns = meta_gpu_kms_get_current_time_ns (gpu_kms);
 
-  notify_view_crtc_presented (view, kms_crtc, now_ns);
+  notify_view_crtc_presented (view, kms_crtc, now_ns, 0,
+                              COGL_FRAME_INFO_FLAG_NONE);
 
   g_object_unref (view);
 }
@@ -1244,7 +1252,8 @@ page_flip_feedback_discarded (MetaKmsCrtc  *kms_crtc,
 
   /*
    * Page flipping failed, but we want to fail gracefully, so to avoid freezing
-   * the frame clack, pretend we flipped.
+   * the frame clack, pretend we flipped. The frame is still marked as
+   * discarded, as it never made it to the screen.
    */
 
   if (error)
@@ -1254,7 +1263,8 @@ page_flip_feedback_discarded (MetaKmsCrtc  *kms_crtc,
   gpu_kms = META_GPU_KMS (meta_crtc_get_gpu (crtc));
   now_ns = meta_gpu_kms_get_current_time_ns (gpu_kms);
 
-  notify_view_crtc_presented (view, kms_crtc, now_ns);
+  notify_view_crtc_presented (view, kms_crtc, now_ns, 0,
+                              COGL_FRAME_INFO_FLAG_DISCARDED);
 
   g_object_unref (view);
 }
@@ -2220,35 +2230,99 @@ meta_renderer_native_create_dma_buf (CoglRenderer  *cogl_renderer,
   return NULL;
 }
 
-gboolean
-meta_onscreen_native_is_buffer_scanout_compatible (CoglOnscreen *onscreen,
-                                                   uint32_t      drm_format,
-                                                   uint64_t      drm_modifier,
-                                                   uint32_t      stride)
+/*
+ * Page flips can't change the buffer layout, so a client buffer can only be
+ * scanned out if it matches the onscreen's own buffer.
+ */
+static struct gbm_bo *
+get_scanout_reference_bo (CoglOnscreen *onscreen)
 {
   CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
   MetaOnscreenNative *onscreen_native = onscreen_egl->platform;
   MetaDrmBuffer *fb;
-  struct gbm_bo *gbm_bo;
 
   if (onscreen_native->crtc->config->transform != META_MONITOR_TRANSFORM_NORMAL)
-    return FALSE;
+    return NULL;
 
   if (onscreen_native->secondary_gpu_state)
-    return FALSE;
+    return NULL;
 
   if (!onscreen_native->gbm.surface)
-    return FALSE;
+    return NULL;
 
   fb = onscreen_native->gbm.current_fb ? onscreen_native->gbm.current_fb
                                        : onscreen_native->gbm.next_fb;
   if (!fb)
-    return FALSE;
+    return NULL;
 
   if (!META_IS_DRM_BUFFER_GBM (fb))
+    return NULL;
+
+  return meta_drm_buffer_gbm_get_bo (META_DRM_BUFFER_GBM (fb));
+}
+
+/**
+ * meta_onscreen_native_get_scanout_format:
+ * @onscreen: a #CoglOnscreen
+ * @drm_format: (out): return location for the DRM format
+ * @drm_modifier: (out): return location for the DRM modifier
+ *
+ * Gets the format and modifier a client buffer needs to have to be scanned
+ * out directly on @onscreen, as long as the CRTC's primary plane advertises
+ * it in its IN_FORMATS.
+ *
+ * Returns: %TRUE if direct scanout is possible at all on @onscreen
+ */
+gboolean
+meta_onscreen_native_get_scanout_format (CoglOnscreen *onscreen,
+                                         uint32_t     *drm_format,
+                                         uint64_t     *drm_modifier)
+{
+  CoglOnscreenEGL *onscreen_egl = onscreen->winsys;
+  MetaOnscreenNative *onscreen_native = onscreen_egl->platform;
+  struct gbm_bo *gbm_bo;
+  uint32_t format;
+  uint64_t modifier;
+  GArray *modifiers;
+
+  gbm_bo = get_scanout_reference_bo (onscreen);
+  if (!gbm_bo)
     return FALSE;
 
-  gbm_bo = meta_drm_buffer_gbm_get_bo (META_DRM_BUFFER_GBM (fb));
+  format = gbm_bo_get_format (gbm_bo);
+  modifier = gbm_bo_get_modifier (gbm_bo);
+
+  modifiers = meta_crtc_kms_get_modifiers (onscreen_native->crtc, format);
+  if (modifiers)
+    {
+      unsigned int i;
+
+      for (i = 0; i < modifiers->len; i++)
+        {
+          if (g_array_index (modifiers, uint64_t, i) == modifier)
+            break;
+        }
+
+      if (i == modifiers->len)
+        return FALSE;
+    }
+
+  *drm_format = format;
+  *drm_modifier = modifier;
+  return TRUE;
+}
+
+gboolean
+meta_onscreen_native_is_buffer_scanout_compatible (CoglOnscreen *onscreen,
+                                                   uint32_t      drm_format,
+                                                   uint64_t      drm_modifier,
+                                                   uint32_t      stride)
+{
+  struct gbm_bo *gbm_bo;
+
+  gbm_bo = get_scanout_reference_bo (onscreen);
+  if (!gbm_bo)
+    return FALSE;
 
   if (gbm_bo_get_format (gbm_bo) != drm_format)
     return FALSE;
@@ -57,6 +57,10 @@ void meta_renderer_native_finish_frame (MetaRendererNative *renderer_native);
 
 int64_t meta_renderer_native_get_frame_counter (MetaRendererNative *renderer_native);
 
+gboolean meta_onscreen_native_get_scanout_format (CoglOnscreen *onscreen,
+                                                  uint32_t     *drm_format,
+                                                  uint64_t     *drm_modifier);
+
 gboolean meta_onscreen_native_is_buffer_scanout_compatible (CoglOnscreen *onscreen,
                                                             uint32_t      drm_format,
                                                             uint64_t      drm_modifier,
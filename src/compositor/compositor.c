@@ -83,6 +83,7 @@
 
 #ifdef HAVE_WAYLAND
 #include "compositor/meta-window-actor-wayland.h"
+#include "wayland/meta-wayland-presentation-time.h"
 #include "wayland/meta-wayland-private.h"
 #endif
 
@@ -116,6 +117,7 @@ typedef struct _MetaCompositorPrivate
   guint post_paint_func_id;
 
   gulong stage_presented_id;
+  gulong stage_view_presented_id;
   gulong stage_after_paint_id;
 
   int64_t server_time_query_time;
@@ -577,6 +579,10 @@ meta_compositor_do_manage (MetaCompositor  *compositor,
     g_signal_connect (priv->stage, "presented",
                       G_CALLBACK (on_presented),
                       compositor);
+  priv->stage_view_presented_id =
+    g_signal_connect (priv->stage, "view-presented",
+                      G_CALLBACK (on_view_presented),
+                      compositor);
 
   /* We use connect_after() here to accomodate code in GNOME Shell that,
    * when benchmarking drawing performance, connects to ::after-paint
@@ -1075,6 +1081,35 @@ meta_compositor_sync_window_geometry (MetaCompositor *compositor,
     meta_plugin_manager_event_size_changed (priv->plugin_mgr, window_actor);
 }
 
+static gint64
+get_presentation_time (MetaCompositor   *compositor,
+                       ClutterFrameInfo *frame_info)
+{
+  MetaCompositorPrivate *priv =
+    meta_compositor_get_instance_private (compositor);
+  gint64 presentation_time_cogl = frame_info->presentation_time;
+  gint64 current_cogl_time;
+  gint64 current_monotonic_time;
+
+  if (presentation_time_cogl == 0)
+    return 0;
+
+  /* Cogl reports presentation in terms of its own clock, which is
+   * guaranteed to be in nanoseconds but with no specified base. The
+   * normal case with the open source GPU drivers on Linux 3.8 and
+   * newer is that the base of cogl_get_clock_time() is that of
+   * clock_gettime(CLOCK_MONOTONIC), so the same as g_get_monotonic_time),
+   * but there's no exposure of that through the API. clock_gettime()
+   * is fairly fast, so calling it twice and subtracting to get a
+   * nearly-zero number is acceptable, if a litle ugly.
+   */
+  current_cogl_time = cogl_get_clock_time (priv->context);
+  current_monotonic_time = g_get_monotonic_time ();
+
+  return current_monotonic_time +
+         (presentation_time_cogl - current_cogl_time) / 1000;
+}
+
 static void
 on_presented (ClutterStage     *stage,
               CoglFrameEvent    event,
@@ -1087,36 +1122,39 @@ on_presented (ClutterStage     *stage,
 
   if (event == COGL_FRAME_EVENT_COMPLETE)
     {
-      gint64 presentation_time_cogl = frame_info->presentation_time;
       gint64 presentation_time;
 
-      if (presentation_time_cogl != 0)
-        {
-          /* Cogl reports presentation in terms of its own clock, which is
-           * guaranteed to be in nanoseconds but with no specified base. The
-           * normal case with the open source GPU drivers on Linux 3.8 and
-           * newer is that the base of cogl_get_clock_time() is that of
-           * clock_gettime(CLOCK_MONOTONIC), so the same as g_get_monotonic_time),
-           * but there's no exposure of that through the API. clock_gettime()
-           * is fairly fast, so calling it twice and subtracting to get a
-           * nearly-zero number is acceptable, if a litle ugly.
-           */
-          gint64 current_cogl_time = cogl_get_clock_time (priv->context);
-          gint64 current_monotonic_time = g_get_monotonic_time ();
-
-          presentation_time =
-            current_monotonic_time + (presentation_time_cogl - current_cogl_time) / 1000;
-        }
-      else
-        {
-          presentation_time = 0;
-        }
+      presentation_time = get_presentation_time (compositor, frame_info);
 
       for (l = priv->windows; l; l = l->next)
         meta_window_actor_frame_complete (l->data, frame_info, presentation_time);
+
+#ifdef HAVE_WAYLAND
+      if (meta_is_wayland_compositor ())
+        meta_wayland_presentation_time_presented (meta_wayland_compositor_get_default (),
+                                                  NULL,
+                                                  frame_info,
+                                                  presentation_time);
+#endif
     }
 }
 
+static void
+on_view_presented (ClutterStage     *stage,
+                   ClutterStageView *view,
+                   ClutterFrameInfo *frame_info,
+                   MetaCompositor   *compositor)
+{
+#ifdef HAVE_WAYLAND
+  if (meta_is_wayland_compositor ())
+    meta_wayland_presentation_time_presented (meta_wayland_compositor_get_default (),
+                                              view,
+                                              frame_info,
+                                              get_presentation_time (compositor,
+                                                                     frame_info));
+#endif
+}
+
 static void
 meta_compositor_real_pre_paint (MetaCompositor *compositor)
 {
@@ -1271,6 +1309,7 @@ meta_compositor_dispose (GObject *object)
 
   g_clear_signal_handler (&priv->stage_after_paint_id, priv->stage);
   g_clear_signal_handler (&priv->stage_presented_id, priv->stage);
+  g_clear_signal_handler (&priv->stage_view_presented_id, priv->stage);
 
   g_clear_handle_id (&priv->pre_paint_func_id,
                      clutter_threads_remove_repaint_func);
@@ -22,8 +22,12 @@
 
 #include "compositor/meta-compositor-native.h"
 
+#include <math.h>
+
 #include "backends/meta-logical-monitor.h"
 #include "compositor/meta-surface-actor-wayland.h"
+#include "wayland/meta-wayland-dma-buf.h"
+#include "wayland/meta-wayland-private.h"
 
 struct _MetaCompositorNative
 {
@@ -59,8 +63,9 @@ get_window_view (MetaRenderer *renderer,
   return view_found;
 }
 
-static void
-maybe_assign_primary_plane (MetaCompositor *compositor)
+static MetaSurfaceActorWayland *
+find_scanout_candidate (MetaCompositor    *compositor,
+                        ClutterStageView **out_view)
 {
   MetaBackend *backend = meta_get_backend ();
   MetaRenderer *renderer = meta_backend_get_renderer (backend);
@@ -68,51 +73,104 @@ maybe_assign_primary_plane (MetaCompositor *compositor)
   MetaWindow *window;
   MetaRendererView *view;
   CoglFramebuffer *framebuffer;
-  CoglOnscreen *onscreen;
   MetaSurfaceActor *surface_actor;
-  MetaSurfaceActorWayland *surface_actor_wayland;
-  g_autoptr (CoglScanout) scanout = NULL;
+  MetaWaylandSurface *surface;
+  CoglTexture *texture;
+  MetaRectangle view_layout;
+  float actor_width, actor_height;
 
   if (meta_compositor_is_unredirect_inhibited (compositor))
-    return;
+    return NULL;
 
   window_actor = meta_compositor_get_top_window_actor (compositor);
   if (!window_actor)
-    return;
-
-  if (meta_window_actor_effect_in_progress (window_actor))
-    return;
-
-  if (clutter_actor_has_transitions (CLUTTER_ACTOR (window_actor)))
-    return;
+    return NULL;
 
   if (clutter_actor_get_n_children (CLUTTER_ACTOR (window_actor)) != 1)
-    return;
+    return NULL;
 
   window = meta_window_actor_get_meta_window (window_actor);
   if (!window)
-    return;
+    return NULL;
 
   view = get_window_view (renderer, window);
   if (!view)
-    return;
+    return NULL;
 
   framebuffer = clutter_stage_view_get_framebuffer (CLUTTER_STAGE_VIEW (view));
   if (!cogl_is_onscreen (framebuffer))
-    return;
+    return NULL;
+
+  if (meta_window_actor_effect_in_progress (window_actor))
+    return NULL;
+
+  if (clutter_actor_has_transitions (CLUTTER_ACTOR (window_actor)))
+    return NULL;
 
   surface_actor = meta_window_actor_get_surface (window_actor);
   if (!META_IS_SURFACE_ACTOR_WAYLAND (surface_actor))
+    return NULL;
+
+  /* Only a buffer covering the whole view, as is, can be scanned out */
+  surface =
+    meta_surface_actor_wayland_get_surface (META_SURFACE_ACTOR_WAYLAND (surface_actor));
+  if (!surface)
+    return NULL;
+
+  if (surface->buffer_transform != META_MONITOR_TRANSFORM_NORMAL ||
+      surface->viewport.has_src_rect)
+    return NULL;
+
+  texture = meta_wayland_surface_get_texture (surface);
+  if (!texture ||
+      cogl_texture_get_width (texture) != cogl_framebuffer_get_width (framebuffer) ||
+      cogl_texture_get_height (texture) != cogl_framebuffer_get_height (framebuffer))
+    return NULL;
+
+  clutter_stage_view_get_layout (CLUTTER_STAGE_VIEW (view), &view_layout);
+  clutter_actor_get_transformed_size (CLUTTER_ACTOR (surface_actor),
+                                      &actor_width, &actor_height);
+  if (roundf (actor_width) != view_layout.width ||
+      roundf (actor_height) != view_layout.height)
+    return NULL;
+
+  *out_view = CLUTTER_STAGE_VIEW (view);
+  return META_SURFACE_ACTOR_WAYLAND (surface_actor);
+}
+
+static void
+maybe_assign_primary_plane (MetaCompositor *compositor)
+{
+  MetaWaylandCompositor *wayland_compositor =
+    meta_wayland_compositor_get_default ();
+  ClutterStageView *view = NULL;
+  CoglOnscreen *onscreen = NULL;
+  MetaSurfaceActorWayland *surface_actor_wayland;
+  MetaWaylandSurface *surface = NULL;
+  g_autoptr (CoglScanout) scanout = NULL;
+
+  surface_actor_wayland = find_scanout_candidate (compositor, &view);
+  if (surface_actor_wayland)
+    {
+      surface = meta_surface_actor_wayland_get_surface (surface_actor_wayland);
+      onscreen = COGL_ONSCREEN (clutter_stage_view_get_framebuffer (view));
+    }
+
+  /* Let the client know what buffers could be scanned out, even if its
+   * current ones can't. */
+  meta_wayland_dma_buf_set_scanout_candidate (wayland_compositor,
+                                              surface,
+                                              onscreen);
+
+  if (!surface_actor_wayland)
     return;
 
-  surface_actor_wayland = META_SURFACE_ACTOR_WAYLAND (surface_actor);
-  onscreen = COGL_ONSCREEN (framebuffer);
   scanout = meta_surface_actor_wayland_try_acquire_scanout (surface_actor_wayland,
-                                                            onscreen);
+                                                            view);
   if (!scanout)
     return;
 
-  clutter_stage_view_assign_next_scanout (CLUTTER_STAGE_VIEW (view), scanout);
+  clutter_stage_view_assign_next_scanout (view, scanout);
 }
 
 static void
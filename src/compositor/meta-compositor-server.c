@@ -22,6 +22,8 @@
 
 #include "compositor/meta-compositor-server.h"
 
+#include "wayland/meta-wayland.h"
+
 G_DEFINE_TYPE (MetaCompositorServer, meta_compositor_server, META_TYPE_COMPOSITOR)
 
 static gboolean
@@ -36,6 +38,22 @@ meta_compositor_server_unmanage (MetaCompositor *compositor)
 {
 }
 
+static void
+meta_compositor_server_pre_paint (MetaCompositor *compositor)
+{
+  MetaCompositorClass *parent_class;
+
+  /* Input events were just processed for this frame; get them to the
+   * clients now rather than after painting, when the main loop gets to
+   * flush them. This doesn't help input arriving while painting, which
+   * waits for the main loop like any other source until the paint is
+   * done. */
+  meta_wayland_compositor_flush_clients (meta_wayland_compositor_get_default ());
+
+  parent_class = META_COMPOSITOR_CLASS (meta_compositor_server_parent_class);
+  parent_class->pre_paint (compositor);
+}
+
 MetaCompositorServer *
 meta_compositor_server_new (MetaDisplay *display)
 {
@@ -56,4 +74,5 @@ meta_compositor_server_class_init (MetaCompositorServerClass *klass)
 
   compositor_class->manage = meta_compositor_server_manage;
   compositor_class->unmanage = meta_compositor_server_unmanage;
+  compositor_class->pre_paint = meta_compositor_server_pre_paint;
 }
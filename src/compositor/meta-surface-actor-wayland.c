@@ -34,15 +34,23 @@
 #include "compositor/meta-shaped-texture-private.h"
 #include "compositor/region-utils.h"
 #include "wayland/meta-wayland-buffer.h"
+#include "wayland/meta-wayland-presentation-time.h"
 #include "wayland/meta-wayland-private.h"
 #include "wayland/meta-window-wayland.h"
 
+/* Frame callbacks of surfaces that aren't painted, e.g. because they are
+ * hidden or fully obscured, are sent at this interval rather than never,
+ * so that clients waiting on them don't stall indefinitely.
+ */
+#define UNPAINTED_FRAME_CALLBACK_INTERVAL_MS 1000
+
 struct _MetaSurfaceActorWayland
 {
   MetaSurfaceActor parent;
 
   MetaWaylandSurface *surface;
   struct wl_list frame_callback_list;
+  guint unpainted_frame_callback_id;
 };
 
 G_DEFINE_TYPE (MetaSurfaceActorWayland,
@@ -94,21 +102,60 @@ queue_frame_callbacks (MetaSurfaceActorWayland *self)
   wl_list_insert_list (&wayland_compositor->frame_callbacks,
                        &self->frame_callback_list);
   wl_list_init (&self->frame_callback_list);
+
+  g_clear_handle_id (&self->unpainted_frame_callback_id, g_source_remove);
+}
+
+static gboolean
+send_unpainted_frame_callbacks (gpointer user_data)
+{
+  MetaSurfaceActorWayland *self = user_data;
+  int64_t current_time = g_get_monotonic_time ();
+  MetaWaylandFrameCallback *cb, *next;
+
+  self->unpainted_frame_callback_id = 0;
+
+  wl_list_for_each_safe (cb, next, &self->frame_callback_list, link)
+    {
+      wl_callback_send_done (cb->resource, current_time / 1000);
+      wl_resource_destroy (cb->resource);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_presentation_feedbacks (MetaSurfaceActorWayland *self,
+                              ClutterStageView        *view,
+                              gboolean                 zero_copy)
+{
+  if (!self->surface)
+    return;
+
+  if (meta_surface_actor_is_obscured (META_SURFACE_ACTOR (self)))
+    return;
+
+  meta_wayland_presentation_time_queue_surface_feedbacks (self->surface,
+                                                          view,
+                                                          zero_copy);
 }
 
 CoglScanout *
 meta_surface_actor_wayland_try_acquire_scanout (MetaSurfaceActorWayland *self,
-                                                CoglOnscreen            *onscreen)
+                                                ClutterStageView        *view)
 {
   MetaWaylandSurface *surface;
+  CoglOnscreen *onscreen;
   CoglScanout *scanout;
 
+  onscreen = COGL_ONSCREEN (clutter_stage_view_get_onscreen (view));
   surface = meta_surface_actor_wayland_get_surface (self);
   scanout = meta_wayland_surface_try_acquire_scanout (surface, onscreen);
   if (!scanout)
     return NULL;
 
   queue_frame_callbacks (self);
+  queue_presentation_feedbacks (self, view, TRUE);
 
   return scanout;
 }
@@ -117,7 +164,30 @@ void
 meta_surface_actor_wayland_add_frame_callbacks (MetaSurfaceActorWayland *self,
                                                 struct wl_list *frame_callbacks)
 {
+  if (wl_list_empty (frame_callbacks))
+    return;
+
   wl_list_insert_list (&self->frame_callback_list, frame_callbacks);
+
+  /* Painting the surface will send them sooner, if it happens at all */
+  if (!self->unpainted_frame_callback_id)
+    {
+      self->unpainted_frame_callback_id =
+        g_timeout_add (UNPAINTED_FRAME_CALLBACK_INTERVAL_MS,
+                       send_unpainted_frame_callbacks,
+                       self);
+      g_source_set_name_by_id (self->unpainted_frame_callback_id,
+                               "[mutter] send_unpainted_frame_callbacks");
+    }
+}
+
+gboolean
+meta_surface_actor_wayland_is_painted (MetaSurfaceActorWayland *self)
+{
+  ClutterActor *actor = CLUTTER_ACTOR (self);
+
+  return (clutter_actor_is_mapped (actor) &&
+          !meta_surface_actor_is_obscured (META_SURFACE_ACTOR (self)));
 }
 
 static void
@@ -127,6 +197,9 @@ meta_surface_actor_wayland_paint (ClutterActor        *actor,
   MetaSurfaceActorWayland *self = META_SURFACE_ACTOR_WAYLAND (actor);
 
   queue_frame_callbacks (self);
+  queue_presentation_feedbacks (self,
+                                clutter_paint_context_get_stage_view (paint_context),
+                                FALSE);
 
   CLUTTER_ACTOR_CLASS (meta_surface_actor_wayland_parent_class)->paint (actor,
                                                                         paint_context);
@@ -150,6 +223,8 @@ meta_surface_actor_wayland_dispose (GObject *object)
       self->surface = NULL;
     }
 
+  g_clear_handle_id (&self->unpainted_frame_callback_id, g_source_remove);
+
   wl_list_for_each_safe (cb, next, &self->frame_callback_list, link)
     wl_resource_destroy (cb->resource);
 
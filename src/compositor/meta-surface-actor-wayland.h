@@ -52,8 +52,10 @@ void meta_surface_actor_wayland_get_subsurface_rect (MetaSurfaceActorWayland *se
 void meta_surface_actor_wayland_add_frame_callbacks (MetaSurfaceActorWayland *self,
                                                      struct wl_list *frame_callbacks);
 
+gboolean meta_surface_actor_wayland_is_painted (MetaSurfaceActorWayland *self);
+
 CoglScanout * meta_surface_actor_wayland_try_acquire_scanout (MetaSurfaceActorWayland *self,
-                                                              CoglOnscreen            *onscreen);
+                                                              ClutterStageView        *view);
 
 G_END_DECLS
 
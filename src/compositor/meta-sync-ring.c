@@ -37,6 +37,13 @@
 #include <GL/glx.h>
 #include <X11/extensions/sync.h>
 
+#ifdef HAVE_XSHMFENCE
+#include <unistd.h>
+#include <X11/Xlib-xcb.h>
+#include <X11/xshmfence.h>
+#include <xcb/dri3.h>
+#endif
+
 #include "clutter/clutter.h"
 #include "cogl/cogl.h"
 #include "meta/util.h"
@@ -54,6 +61,15 @@
  *
  * glClientWaitSync() and XAlarms are used in steps 2 and 4,
  * respectively, to double-check the expectections.
+ *
+ * When the X server supports DRI3, the fences are instead created from
+ * shared memory fences (see xshmfence_alloc_shm()). Those can be reset
+ * directly by us, without a request the X server has to process first, so
+ * there are no counters and alarms, step 4 goes away, and a fence can be
+ * reused as soon as the GPU is done with it. That way, all but one fence
+ * of the ring can be in flight at the same time. If anything goes wrong
+ * with shared memory fences, the ring is rebooted with the XAlarm based
+ * fences.
  */
 
 #define NUM_SYNCS 10
@@ -80,6 +96,10 @@ typedef struct
   XSyncAlarm xalarm;
   XSyncValue next_counter_value;
 
+#ifdef HAVE_XSHMFENCE
+  struct xshmfence *shm_fence;
+#endif
+
   MetaSyncState state;
 } MetaSync;
 
@@ -96,6 +116,9 @@ typedef struct
   MetaSync *current_sync;
   guint warmup_syncs;
 
+  gboolean use_shm_fences;
+  gboolean shm_fences_failed;
+
   guint reboots;
 } MetaSyncRing;
 
@@ -286,6 +309,18 @@ meta_sync_reset (MetaSync *self)
 
   g_return_if_fail (self->state == META_SYNC_STATE_DONE);
 
+#ifdef HAVE_XSHMFENCE
+  if (self->shm_fence)
+    {
+      /* The fence lives in memory shared with the X server, so there is
+       * nothing to wait for until it can be triggered again.
+       */
+      xshmfence_reset (self->shm_fence);
+      self->state = META_SYNC_STATE_READY;
+      return;
+    }
+#endif
+
   XSyncResetFence (self->xdisplay, self->xfence);
 
   attrs.trigger.wait_value = self->next_counter_value;
@@ -347,6 +382,84 @@ meta_sync_new (Display *xdisplay)
   return self;
 }
 
+#ifdef HAVE_XSHMFENCE
+static MetaSync *
+meta_sync_new_shm_fence (Display *xdisplay)
+{
+  xcb_connection_t *xcb_conn = XGetXCBConnection (xdisplay);
+  xcb_void_cookie_t cookie;
+  xcb_generic_error_t *error;
+  struct xshmfence *shm_fence;
+  MetaSync *self;
+  int fd;
+
+  fd = xshmfence_alloc_shm ();
+  if (fd < 0)
+    return NULL;
+
+  shm_fence = xshmfence_map_shm (fd);
+  if (!shm_fence)
+    {
+      close (fd);
+      return NULL;
+    }
+
+  self = g_malloc0 (sizeof (MetaSync));
+
+  self->xdisplay = xdisplay;
+  self->shm_fence = shm_fence;
+
+  /* The file descriptor is passed on to the X server */
+  self->xfence = xcb_generate_id (xcb_conn);
+  cookie = xcb_dri3_fence_from_fd_checked (xcb_conn,
+                                           DefaultRootWindow (xdisplay),
+                                           self->xfence,
+                                           FALSE,
+                                           fd);
+  error = xcb_request_check (xcb_conn, cookie);
+  if (error)
+    {
+      meta_verbose ("MetaSyncRing: failed to create fence from shared memory (%d)\n",
+                    error->error_code);
+      free (error);
+      xshmfence_unmap_shm (shm_fence);
+      g_free (self);
+      return NULL;
+    }
+
+  self->gl_x11_sync = 0;
+  self->gpu_fence = 0;
+
+  self->state = META_SYNC_STATE_READY;
+
+  return self;
+}
+
+static gboolean
+check_dri3 (Display *xdisplay)
+{
+  xcb_connection_t *xcb_conn = XGetXCBConnection (xdisplay);
+  const xcb_query_extension_reply_t *extension;
+  xcb_dri3_query_version_cookie_t cookie;
+  xcb_dri3_query_version_reply_t *reply;
+  gboolean ret;
+
+  extension = xcb_get_extension_data (xcb_conn, &xcb_dri3_id);
+  if (!extension || !extension->present)
+    return FALSE;
+
+  cookie = xcb_dri3_query_version (xcb_conn, 1, 0);
+  reply = xcb_dri3_query_version_reply (xcb_conn, cookie, NULL);
+  if (!reply)
+    return FALSE;
+
+  ret = reply->major_version >= 1;
+  free (reply);
+
+  return ret;
+}
+#endif
+
 static void
 meta_sync_import (MetaSync *self)
 {
@@ -405,12 +518,58 @@ meta_sync_free (MetaSync *self)
 
   meta_gl_delete_sync (self->gl_x11_sync);
   XSyncDestroyFence (self->xdisplay, self->xfence);
+
+#ifdef HAVE_XSHMFENCE
+  if (self->shm_fence)
+    {
+      xshmfence_unmap_shm (self->shm_fence);
+      g_free (self);
+      return;
+    }
+#endif
+
   XSyncDestroyCounter (self->xdisplay, self->xcounter);
   XSyncDestroyAlarm (self->xdisplay, self->xalarm);
 
   g_free (self);
 }
 
+#ifdef HAVE_XSHMFENCE
+static gboolean
+create_shm_fences (MetaSyncRing *ring)
+{
+  guint i;
+
+  if (ring->shm_fences_failed || !check_dri3 (ring->xdisplay))
+    return FALSE;
+
+  for (i = 0; i < NUM_SYNCS; ++i)
+    {
+      ring->syncs_array[i] = meta_sync_new_shm_fence (ring->xdisplay);
+      if (!ring->syncs_array[i])
+        break;
+    }
+
+  if (i == NUM_SYNCS)
+    return TRUE;
+
+  meta_verbose ("MetaSyncRing: falling back to XAlarm based fences\n");
+  ring->shm_fences_failed = TRUE;
+
+  while (i > 0)
+    {
+      MetaSync *sync = ring->syncs_array[--i];
+
+      XSyncDestroyFence (ring->xdisplay, sync->xfence);
+      xshmfence_unmap_shm (sync->shm_fence);
+      g_free (sync);
+      ring->syncs_array[i] = NULL;
+    }
+
+  return FALSE;
+}
+#endif
+
 gboolean
 meta_sync_ring_init (Display *xdisplay)
 {
@@ -438,12 +597,22 @@ meta_sync_ring_init (Display *xdisplay)
 
   ring->alarm_to_sync = g_hash_table_new (NULL, NULL);
 
-  for (i = 0; i < NUM_SYNCS; ++i)
+#ifdef HAVE_XSHMFENCE
+  ring->use_shm_fences = create_shm_fences (ring);
+#else
+  ring->use_shm_fences = FALSE;
+#endif
+
+  if (!ring->use_shm_fences)
     {
-      MetaSync *sync = meta_sync_new (ring->xdisplay);
-      ring->syncs_array[i] = sync;
-      g_hash_table_replace (ring->alarm_to_sync, (gpointer) sync->xalarm, sync);
+      for (i = 0; i < NUM_SYNCS; ++i)
+        {
+          MetaSync *sync = meta_sync_new (ring->xdisplay);
+          ring->syncs_array[i] = sync;
+          g_hash_table_replace (ring->alarm_to_sync, (gpointer) sync->xalarm, sync);
+        }
     }
+
   /* Since the connection we create the X fences on isn't the same as
    * the one used for the GLX context, we need to XSync() here to
    * ensure glImportSync() succeeds. */
@@ -495,6 +664,13 @@ meta_sync_ring_reboot (Display *xdisplay)
 
   ring->reboots += 1;
 
+  /* Don't trust shared memory fences after they got us stuck once */
+  if (ring->use_shm_fences)
+    {
+      meta_warning ("MetaSyncRing: falling back to XAlarm based fences\n");
+      ring->shm_fences_failed = TRUE;
+    }
+
   if (!meta_sync_ring_get ())
     {
       meta_warning ("MetaSyncRing: Too many reboots -- disabling\n");
@@ -508,15 +684,22 @@ gboolean
 meta_sync_ring_after_frame (void)
 {
   MetaSyncRing *ring = meta_sync_ring_get ();
+  guint frames_in_flight;
 
   if (!ring)
     return FALSE;
 
   g_return_val_if_fail (ring->xdisplay != NULL, FALSE);
 
-  if (ring->warmup_syncs >= NUM_SYNCS / 2)
+  /* Without alarms, the fence we reset is the next one we use */
+  if (ring->use_shm_fences)
+    frames_in_flight = NUM_SYNCS - 1;
+  else
+    frames_in_flight = NUM_SYNCS / 2;
+
+  if (ring->warmup_syncs >= frames_in_flight)
     {
-      guint reset_sync_idx = (ring->current_sync_idx + NUM_SYNCS - (NUM_SYNCS / 2)) % NUM_SYNCS;
+      guint reset_sync_idx = (ring->current_sync_idx + NUM_SYNCS - frames_in_flight) % NUM_SYNCS;
       MetaSync *sync_to_reset = ring->syncs_array[reset_sync_idx];
 
       GLenum status = meta_sync_check_update_finished (sync_to_reset, 0);
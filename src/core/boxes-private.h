@@ -243,6 +243,25 @@ GList* meta_rectangle_find_nonintersected_monitor_edges (
                                            const GList         *monitor_rects,
                                            const GSList        *all_struts);
 
+typedef struct _MetaEdgeIndex MetaEdgeIndex;
+
+/* Creates an index of edges sorted by position (as with
+ * meta_rectangle_edge_cmp_ignore_type()), to quickly find the next one
+ * aligning with a rectangle.
+ */
+META_EXPORT_TEST
+MetaEdgeIndex * meta_edge_index_new (const GArray *edges);
+
+META_EXPORT_TEST
+void meta_edge_index_free (MetaEdgeIndex *edge_index);
+
+META_EXPORT_TEST
+int meta_edge_index_find_aligned (const MetaEdgeIndex *edge_index,
+                                  int                  from,
+                                  int                  to,
+                                  int                  start,
+                                  int                  end);
+
 META_EXPORT_TEST
 gboolean meta_rectangle_is_adjacent_to (MetaRectangle *rect,
                                         MetaRectangle *other);
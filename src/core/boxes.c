@@ -420,116 +420,6 @@ meta_rectangle_resize_with_gravity (const MetaRectangle *old_rect,
   rect->height = new_height;
 }
 
-/* Not so simple helper function for get_minimal_spanning_set_for_region() */
-static GList*
-merge_spanning_rects_in_region (GList *region)
-{
-  /* NOTE FOR ANY OPTIMIZATION PEOPLE OUT THERE: Please see the
-   * documentation of get_minimal_spanning_set_for_region() for performance
-   * considerations that also apply to this function.
-   */
-
-  GList* compare;
-  compare = region;
-
-  if (region == NULL)
-    {
-      g_warning ("Region to merge was empty!  Either you have a some "
-                 "pathological STRUT list or there's a bug somewhere!\n");
-      return NULL;
-    }
-
-  while (compare && compare->next)
-    {
-      MetaRectangle *a = compare->data;
-      GList *other = compare->next;
-
-      g_assert (a->width > 0 && a->height > 0);
-
-      while (other)
-        {
-          MetaRectangle *b = other->data;
-          GList *delete_me = NULL;
-
-          g_assert (b->width > 0 && b->height > 0);
-
-          /* If a contains b, just remove b */
-          if (meta_rectangle_contains_rect (a, b))
-            {
-              delete_me = other;
-            }
-          /* If b contains a, just remove a */
-          else if (meta_rectangle_contains_rect (b, a))
-            {
-              delete_me = compare;
-            }
-          /* If a and b might be mergeable horizontally */
-          else if (a->y == b->y && a->height == b->height)
-            {
-              /* If a and b overlap */
-              if (meta_rectangle_overlap (a, b))
-                {
-                  int new_x = MIN (a->x, b->x);
-                  a->width = MAX (a->x + a->width, b->x + b->width) - new_x;
-                  a->x = new_x;
-                  delete_me = other;
-                }
-              /* If a and b are adjacent */
-              else if (a->x + a->width == b->x || a->x == b->x + b->width)
-                {
-                  int new_x = MIN (a->x, b->x);
-                  a->width = MAX (a->x + a->width, b->x + b->width) - new_x;
-                  a->x = new_x;
-                  delete_me = other;
-                }
-            }
-          /* If a and b might be mergeable vertically */
-          else if (a->x == b->x && a->width == b->width)
-            {
-              /* If a and b overlap */
-              if (meta_rectangle_overlap (a, b))
-                {
-                  int new_y = MIN (a->y, b->y);
-                  a->height = MAX (a->y + a->height, b->y + b->height) - new_y;
-                  a->y = new_y;
-                  delete_me = other;
-                }
-              /* If a and b are adjacent */
-              else if (a->y + a->height == b->y || a->y == b->y + b->height)
-                {
-                  int new_y = MIN (a->y, b->y);
-                  a->height = MAX (a->y + a->height, b->y + b->height) - new_y;
-                  a->y = new_y;
-                  delete_me = other;
-                }
-            }
-
-          other = other->next;
-
-          /* Delete any rectangle in the list that is no longer wanted */
-          if (delete_me != NULL)
-            {
-              /* Deleting the rect we compare others to is a little tricker */
-              if (compare == delete_me)
-                {
-                  compare = compare->next;
-                  other = compare->next;
-                  a = compare->data;
-                }
-
-              /* Okay, we can free it now */
-              g_free (delete_me->data);
-              region = g_list_delete_link (region, delete_me);
-            }
-
-        }
-
-      compare = compare->next;
-    }
-
-  return region;
-}
-
 /* Simple helper function for get_minimal_spanning_set_for_region()... */
 static gint
 compare_rect_areas (gconstpointer a, gconstpointer b)
@@ -540,7 +430,13 @@ compare_rect_areas (gconstpointer a, gconstpointer b)
   int a_area = meta_rectangle_area (a_rect);
   int b_area = meta_rectangle_area (b_rect);
 
-  return b_area - a_area; /* positive ret value denotes b > a, ... */
+  if (a_area != b_area)
+    return b_area - a_area; /* positive ret value denotes b > a, ... */
+
+  /* ...and for equal areas, keep the order stable from run to run */
+  if (a_rect->y != b_rect->y)
+    return a_rect->y - b_rect->y;
+  return a_rect->x - b_rect->x;
 }
 
 /* ... and another helper for get_minimal_spanning_set_for_region()... */
@@ -563,6 +459,91 @@ check_strut_align (MetaStrut *strut, const MetaRectangle *rect)
     }
 }
 
+/* ... and another one, which appends to @rects the rectangles that make up
+ * @rect without @strut_rect, each as big as possible...
+ */
+static void
+append_rect_minus_strut (GArray              *rects,
+                         const MetaRectangle *rect,
+                         const MetaRectangle *strut_rect)
+{
+  MetaRectangle piece;
+
+  /* If there is area in rect left of strut */
+  if (BOX_LEFT (*rect) < BOX_LEFT (*strut_rect))
+    {
+      piece = *rect;
+      piece.width = BOX_LEFT (*strut_rect) - BOX_LEFT (*rect);
+      g_array_append_val (rects, piece);
+    }
+  /* If there is area in rect right of strut */
+  if (BOX_RIGHT (*rect) > BOX_RIGHT (*strut_rect))
+    {
+      piece = *rect;
+      piece.x = BOX_RIGHT (*strut_rect);
+      piece.width = BOX_RIGHT (*rect) - piece.x;
+      g_array_append_val (rects, piece);
+    }
+  /* If there is area in rect above strut */
+  if (BOX_TOP (*rect) < BOX_TOP (*strut_rect))
+    {
+      piece = *rect;
+      piece.height = BOX_TOP (*strut_rect) - BOX_TOP (*rect);
+      g_array_append_val (rects, piece);
+    }
+  /* If there is area in rect below strut */
+  if (BOX_BOTTOM (*rect) > BOX_BOTTOM (*strut_rect))
+    {
+      piece = *rect;
+      piece.y = BOX_BOTTOM (*strut_rect);
+      piece.height = BOX_BOTTOM (*rect) - piece.y;
+      g_array_append_val (rects, piece);
+    }
+}
+
+/* ... and a last one, which removes the rectangles starting at @first_piece
+ * that are contained in any other rectangle of @rects.  The rectangles
+ * before @first_piece must not be contained in each other, nor can they be
+ * contained in the later ones as those are all parts of rectangles that
+ * were in the set alongside them.
+ */
+static void
+remove_contained_pieces (GArray *rects,
+                         guint   first_piece)
+{
+  MetaRectangle *all_rects = (MetaRectangle *) rects->data;
+  guint i, j, n_rects;
+
+  for (i = first_piece; i < rects->len; i++)
+    {
+      MetaRectangle *piece = &all_rects[i];
+
+      for (j = 0; j < rects->len; j++)
+        {
+          MetaRectangle *other = &all_rects[j];
+
+          if (j == i || !meta_rectangle_contains_rect (other, piece))
+            continue;
+
+          /* Out of two identical pieces, keep the first one */
+          if (j < i || !meta_rectangle_equal (other, piece))
+            {
+              /* Empty pieces never contain the others; drop them below */
+              piece->width = 0;
+              break;
+            }
+        }
+    }
+
+  n_rects = first_piece;
+  for (i = first_piece; i < rects->len; i++)
+    {
+      if (all_rects[i].width > 0)
+        all_rects[n_rects++] = all_rects[i];
+    }
+  g_array_set_size (rects, n_rects);
+}
+
 /**
  * meta_rectangle_get_minimal_spanning_set_for_region:
  * @basic_rect: Input rectangle
@@ -588,46 +569,23 @@ meta_rectangle_get_minimal_spanning_set_for_region (
   const MetaRectangle *basic_rect,
   const GSList  *all_struts)
 {
-  /* NOTE FOR OPTIMIZERS: This function *might* be somewhat slow,
-   * especially due to the call to merge_spanning_rects_in_region() (which
-   * is O(n^2) where n is the size of the list generated in this function).
-   * This is made more onerous due to the fact that it involves a fair
-   * number of memory allocation and deallocation calls.  However, n is 1
-   * for default installations of Gnome (because partial struts aren't used
-   * by default and only partial struts increase the size of the spanning
-   * set generated).  With one partial strut, n will be 2 or 3.  With 2
-   * partial struts, n will probably be 4 or 5.  So, n probably isn't large
-   * enough to make this worth bothering.  Further, it is only called from
-   * workspace.c:ensure_work_areas_validated (at least as of the time of
-   * writing this comment), which in turn should only be called if the
-   * strut list changes or the screen or monitor size changes.  If it ever
-   * does show up on profiles (most likely because people start using
-   * ridiculously huge numbers of partial struts), possible optimizations
-   * include:
-   *
-   * (1) rewrite merge_spanning_rects_in_region() to be O(n) or O(nlogn).
-   *     I'm not totally sure it's possible, but with a couple copies of
-   *     the list and sorting them appropriately, I believe it might be.
-   * (2) only call merge_spanning_rects_in_region() with a subset of the
-   *     full list of rectangles.  I believe from some of my preliminary
-   *     debugging and thinking about it that it is possible to figure out
-   *     apriori groups of rectangles which are only merge candidates with
-   *     each other.  (See testboxes.c:get_screen_region() when which==2
-   *     and track the steps of this function carefully to see what gave
-   *     me the hint that this might work)
-   * (3) figure out how to avoid merge_spanning_rects_in_region().  I think
-   *     it might be possible to modify this function to make that
-   *     possible, and I spent just a little while thinking about it, but n
-   *     wasn't large enough to convince me to care yet.
-   * (4) Some of the stuff Rob mentioned at http://mail.gnome.org/archives\
-   *     /metacity-devel-list/2005-November/msg00028.html.  (Sorry for the
-   *     URL splitting.)
+  /* NOTE FOR OPTIMIZERS: This runs for every monitor and for the whole
+   * screen, with the struts of all monitors, whenever the struts or the
+   * monitor layout change.  The rectangle set lives in two arrays that are
+   * swapped for every strut, so the only allocations are those of the
+   * arrays and of the returned list.  Since the set is pruned after every
+   * strut, it never holds more than the maximal rectangles of the region
+   * covered so far plus the new pieces of one strut; the cost of a strut
+   * is therefore O(n * p), where p is the number of new pieces, rather
+   * than the O(n^2) merging the set used to need once all struts had been
+   * applied.
    */
 
+  GArray        *rects;
+  GArray        *next_rects;
   GList         *ret;
-  GList         *tmp_list;
   const GSList  *strut_iter;
-  MetaRectangle *temp_rect;
+  guint          i;
 
   /* The algorithm is basically as follows:
    *   Initialize rectangle_set to basic_rect
@@ -638,80 +596,74 @@ meta_rectangle_get_minimal_spanning_set_for_region (
    *       - Remove the old (pre-split) rectangle from the rectangle_set,
    *         and replace it with the new rectangles generated from the
    *         splitting
+   *     Remove the new rectangles that are contained in any other one
+   *
+   * Every maximal rectangle of the region minus the struts applied so far
+   * either lies next to the new strut, in which case it is one of the
+   * pieces of a maximal rectangle of the previous set, or it is untouched.
+   * The set thus always consists of exactly the maximal rectangles, and
+   * there's nothing left to merge at the end.
    */
 
-  temp_rect = g_new (MetaRectangle, 1);
-  *temp_rect = *basic_rect;
-  ret = g_list_prepend (NULL, temp_rect);
+  rects = g_array_sized_new (FALSE, FALSE, sizeof (MetaRectangle), 16);
+  next_rects = g_array_sized_new (FALSE, FALSE, sizeof (MetaRectangle), 16);
+  g_array_append_val (rects, *basic_rect);
 
   for (strut_iter = all_struts; strut_iter; strut_iter = strut_iter->next)
     {
-      GList *rect_iter;
       MetaStrut *strut = (MetaStrut*)strut_iter->data;
       MetaRectangle *strut_rect = &strut->rect;
+      guint first_piece;
+      GArray *tmp;
+
+      /* Struts elsewhere, e.g. on other monitors, can't split anything */
+      if (!meta_rectangle_overlap (strut_rect, basic_rect) ||
+          !check_strut_align (strut, basic_rect))
+        continue;
+
+      g_array_set_size (next_rects, 0);
 
-      tmp_list = ret;
-      ret = NULL;
-      rect_iter = tmp_list;
-      while (rect_iter)
+      for (i = 0; i < rects->len; i++)
         {
-          MetaRectangle *rect = (MetaRectangle*) rect_iter->data;
+          MetaRectangle *rect = &g_array_index (rects, MetaRectangle, i);
 
-          if (!meta_rectangle_overlap (strut_rect, rect) ||
-              !check_strut_align (strut, basic_rect))
-            ret = g_list_prepend (ret, rect);
-          else
-            {
-              /* If there is area in rect left of strut */
-              if (BOX_LEFT (*rect) < BOX_LEFT (*strut_rect))
-                {
-                  temp_rect = g_new (MetaRectangle, 1);
-                  *temp_rect = *rect;
-                  temp_rect->width = BOX_LEFT (*strut_rect) - BOX_LEFT (*rect);
-                  ret = g_list_prepend (ret, temp_rect);
-                }
-              /* If there is area in rect right of strut */
-              if (BOX_RIGHT (*rect) > BOX_RIGHT (*strut_rect))
-                {
-                  int new_x;
-                  temp_rect = g_new (MetaRectangle, 1);
-                  *temp_rect = *rect;
-                  new_x = BOX_RIGHT (*strut_rect);
-                  temp_rect->width = BOX_RIGHT(*rect) - new_x;
-                  temp_rect->x = new_x;
-                  ret = g_list_prepend (ret, temp_rect);
-                }
-              /* If there is area in rect above strut */
-              if (BOX_TOP (*rect) < BOX_TOP (*strut_rect))
-                {
-                  temp_rect = g_new (MetaRectangle, 1);
-                  *temp_rect = *rect;
-                  temp_rect->height = BOX_TOP (*strut_rect) - BOX_TOP (*rect);
-                  ret = g_list_prepend (ret, temp_rect);
-                }
-              /* If there is area in rect below strut */
-              if (BOX_BOTTOM (*rect) > BOX_BOTTOM (*strut_rect))
-                {
-                  int new_y;
-                  temp_rect = g_new (MetaRectangle, 1);
-                  *temp_rect = *rect;
-                  new_y = BOX_BOTTOM (*strut_rect);
-                  temp_rect->height = BOX_BOTTOM (*rect) - new_y;
-                  temp_rect->y = new_y;
-                  ret = g_list_prepend (ret, temp_rect);
-                }
-              g_free (rect);
-            }
-          rect_iter = rect_iter->next;
+          if (!meta_rectangle_overlap (strut_rect, rect))
+            g_array_append_val (next_rects, *rect);
         }
-      g_list_free (tmp_list);
+
+      first_piece = next_rects->len;
+      for (i = 0; i < rects->len; i++)
+        {
+          MetaRectangle *rect = &g_array_index (rects, MetaRectangle, i);
+
+          if (meta_rectangle_overlap (strut_rect, rect))
+            append_rect_minus_strut (next_rects, rect, strut_rect);
+        }
+      remove_contained_pieces (next_rects, first_piece);
+
+      tmp = rects;
+      rects = next_rects;
+      next_rects = tmp;
     }
 
+  if (rects->len == 0)
+    g_warning ("Region to merge was empty!  Either you have a some "
+               "pathological STRUT list or there's a bug somewhere!\n");
+
   /* Sort by maximal area, just because I feel like it... */
-  ret = g_list_sort (ret, compare_rect_areas);
+  g_array_sort (rects, compare_rect_areas);
+
+  ret = NULL;
+  for (i = 0; i < rects->len; i++)
+    {
+      MetaRectangle *rect = &g_array_index (rects, MetaRectangle, i);
+
+      ret = g_list_prepend (ret, meta_rectangle_copy (rect));
+    }
+  ret = g_list_reverse (ret);
 
-  /* Merge rectangles if possible so that the list really is minimal */
-  ret = merge_spanning_rects_in_region (ret);
+  g_array_free (rects, TRUE);
+  g_array_free (next_rects, TRUE);
 
   return ret;
 }
@@ -2013,6 +1965,182 @@ meta_rectangle_find_nonintersected_monitor_edges (
   return ret;
 }
 
+/*
+ * An edge index is a segment tree over an array of edges sorted by position,
+ * where each node stores the lowest start and highest end of the extents of
+ * the edges below it, in the nonzero-width dimension of the edges. This
+ * allows skipping whole ranges of edges that cannot align with a rectangle
+ * when searching for the next edge that does.
+ */
+struct _MetaEdgeIndex
+{
+  int n_edges;
+  int n_leaves;
+
+  int *min_start;
+  int *max_end;
+};
+
+static void
+get_edge_extent (const MetaEdge *edge,
+                 int            *start,
+                 int            *end)
+{
+  switch (edge->side_type)
+    {
+    case META_SIDE_LEFT:
+    case META_SIDE_RIGHT:
+      *start = BOX_TOP (edge->rect);
+      *end = BOX_BOTTOM (edge->rect);
+      break;
+    case META_SIDE_TOP:
+    case META_SIDE_BOTTOM:
+      *start = BOX_LEFT (edge->rect);
+      *end = BOX_RIGHT (edge->rect);
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+/**
+ * meta_edge_index_new: (skip)
+ * @edges: (element-type MetaEdge*): edges sorted by position
+ *
+ * Returns: a new #MetaEdgeIndex for @edges, which must not change as long as
+ *   the index is used
+ */
+MetaEdgeIndex *
+meta_edge_index_new (const GArray *edges)
+{
+  MetaEdgeIndex *edge_index;
+  int i;
+
+  edge_index = g_new0 (MetaEdgeIndex, 1);
+  edge_index->n_edges = edges->len;
+
+  edge_index->n_leaves = 1;
+  while (edge_index->n_leaves < edge_index->n_edges)
+    edge_index->n_leaves *= 2;
+
+  edge_index->min_start = g_new (int, 2 * edge_index->n_leaves);
+  edge_index->max_end = g_new (int, 2 * edge_index->n_leaves);
+
+  for (i = 0; i < edge_index->n_leaves; i++)
+    {
+      int leaf = edge_index->n_leaves + i;
+
+      if (i < edge_index->n_edges)
+        {
+          get_edge_extent (g_array_index (edges, MetaEdge *, i),
+                           &edge_index->min_start[leaf],
+                           &edge_index->max_end[leaf]);
+        }
+      else
+        {
+          edge_index->min_start[leaf] = G_MAXINT;
+          edge_index->max_end[leaf] = G_MININT;
+        }
+    }
+
+  for (i = edge_index->n_leaves - 1; i > 0; i--)
+    {
+      edge_index->min_start[i] = MIN (edge_index->min_start[2 * i],
+                                      edge_index->min_start[2 * i + 1]);
+      edge_index->max_end[i] = MAX (edge_index->max_end[2 * i],
+                                    edge_index->max_end[2 * i + 1]);
+    }
+
+  return edge_index;
+}
+
+void
+meta_edge_index_free (MetaEdgeIndex *edge_index)
+{
+  g_free (edge_index->min_start);
+  g_free (edge_index->max_end);
+  g_free (edge_index);
+}
+
+static int
+edge_index_find (const MetaEdgeIndex *edge_index,
+                 int                  node,
+                 int                  node_first,
+                 int                  node_last,
+                 int                  first,
+                 int                  last,
+                 gboolean             forward,
+                 int                  start,
+                 int                  end)
+{
+  int middle, found;
+
+  if (node_last < first || node_first > last)
+    return -1;
+
+  if (edge_index->min_start[node] > end ||
+      edge_index->max_end[node] < start)
+    return -1;
+
+  if (node_first == node_last)
+    return node_first;
+
+  middle = node_first + (node_last - node_first) / 2;
+
+  if (forward)
+    {
+      found = edge_index_find (edge_index, 2 * node, node_first, middle,
+                               first, last, forward, start, end);
+      if (found < 0)
+        found = edge_index_find (edge_index, 2 * node + 1, middle + 1, node_last,
+                                 first, last, forward, start, end);
+    }
+  else
+    {
+      found = edge_index_find (edge_index, 2 * node + 1, middle + 1, node_last,
+                               first, last, forward, start, end);
+      if (found < 0)
+        found = edge_index_find (edge_index, 2 * node, node_first, middle,
+                                 first, last, forward, start, end);
+    }
+
+  return found;
+}
+
+/**
+ * meta_edge_index_find_aligned: (skip)
+ * @edge_index: a #MetaEdgeIndex
+ * @from: index of the edge to start searching at
+ * @to: index of the edge to stop searching at, inclusive; may be lower
+ *   than @from to search backwards
+ * @start: start of the extent to align with
+ * @end: end of the extent to align with
+ *
+ * Finds the first edge between @from and @to whose extent in its
+ * nonzero-width dimension overlaps or is adjacent to [@start, @end],
+ * i.e. the first edge meta_rectangle_edge_aligns() could return %TRUE for
+ * with a rectangle spanning that extent.
+ *
+ * Returns: the index of the edge, or -1 if there is none
+ */
+int
+meta_edge_index_find_aligned (const MetaEdgeIndex *edge_index,
+                              int                  from,
+                              int                  to,
+                              int                  start,
+                              int                  end)
+{
+  gboolean forward = from <= to;
+  int first = MAX (MIN (from, to), 0);
+  int last = MIN (MAX (from, to), edge_index->n_edges - 1);
+
+  if (first > last)
+    return -1;
+
+  return edge_index_find (edge_index, 1, 0, edge_index->n_leaves - 1,
+                          first, last, forward, start, end);
+}
+
 gboolean
 meta_rectangle_is_adjacent_to (MetaRectangle *rect,
                                MetaRectangle *other)
@@ -152,6 +152,34 @@ typedef struct
   MetaMoveResizeFlags  flags;
 } ConstraintInfo;
 
+/* The parts of the ConstraintInfo that only depend on the monitor the
+ * window is on, and on the work areas.
+ */
+typedef struct
+{
+  MetaLogicalMonitor *logical_monitor;
+  MetaRectangle       work_area_monitor;
+  GList              *usable_monitor_region;
+} MonitorConstraintData;
+
+/* Cached while the user moves or resizes a window, so the inputs that
+ * don't change between motion events aren't looked up again for each of
+ * them.  The regions are owned by the workspace; the cache is dropped
+ * whenever a work area is invalidated.
+ */
+struct MetaConstraintCache
+{
+  MetaWindow    *window;
+  MetaWorkspace *workspace;
+  gboolean       on_all_workspaces;
+
+  GList  *usable_screen_region;
+
+  /* MonitorConstraintData of the monitors the window has been on */
+  GArray *monitors;
+  int     last_monitor;
+};
+
 static gboolean do_screen_and_monitor_relative_constraints (MetaWindow     *window,
                                                             GList          *region_spanning_rectangles,
                                                             ConstraintInfo *info,
@@ -337,6 +365,115 @@ meta_window_constrain (MetaWindow          *window,
   update_onscreen_requirements (window, &info);
 }
 
+void
+meta_display_cleanup_constraint_cache (MetaDisplay *display)
+{
+  MetaConstraintCache *cache = display->grab_constraint_cache;
+
+  if (cache == NULL) /* Not currently cached */
+    return;
+
+  g_array_free (cache->monitors, TRUE);
+  g_free (cache);
+  display->grab_constraint_cache = NULL;
+}
+
+static MetaConstraintCache *
+ensure_constraint_cache (MetaWindow *window)
+{
+  MetaDisplay *display = window->display;
+  MetaWorkspace *cur_workspace;
+  MetaConstraintCache *cache;
+
+  /* Nothing but an ongoing move or resize constrains the same window over
+   * and over again, so don't bother caching anything otherwise.
+   */
+  if (display->event_route != META_EVENT_ROUTE_WINDOW_OP ||
+      display->grab_window != window)
+    return NULL;
+
+  cache = display->grab_constraint_cache;
+
+  /* The work areas of the window depend on the workspaces it is on */
+  if (cache &&
+      (cache->window != window ||
+       cache->workspace != window->workspace ||
+       cache->on_all_workspaces != window->on_all_workspaces))
+    {
+      meta_display_cleanup_constraint_cache (display);
+      cache = NULL;
+    }
+
+  if (cache)
+    return cache;
+
+  cur_workspace = display->workspace_manager->active_workspace;
+
+  cache = g_new0 (MetaConstraintCache, 1);
+  cache->window = window;
+  cache->workspace = window->workspace;
+  cache->on_all_workspaces = window->on_all_workspaces;
+  cache->usable_screen_region =
+    meta_workspace_get_onscreen_region (cur_workspace);
+  cache->monitors = g_array_new (FALSE, FALSE, sizeof (MonitorConstraintData));
+  cache->last_monitor = -1;
+
+  display->grab_constraint_cache = cache;
+
+  return cache;
+}
+
+static MonitorConstraintData *
+get_monitor_constraint_data (MetaConstraintCache *cache,
+                             MetaMonitorManager  *monitor_manager,
+                             MetaRectangle       *rect)
+{
+  MetaWorkspace *cur_workspace;
+  MetaLogicalMonitor *logical_monitor;
+  MonitorConstraintData *data;
+  guint i;
+
+  /* Logical monitors don't overlap, so no other monitor can be a better
+   * match for a rectangle that is entirely on the last one.
+   */
+  if (cache->last_monitor >= 0)
+    {
+      data = &g_array_index (cache->monitors, MonitorConstraintData,
+                             cache->last_monitor);
+      if (meta_rectangle_contains_rect (&data->logical_monitor->rect, rect))
+        return data;
+    }
+
+  logical_monitor =
+    meta_monitor_manager_get_logical_monitor_from_rect (monitor_manager, rect);
+
+  for (i = 0; i < cache->monitors->len; i++)
+    {
+      data = &g_array_index (cache->monitors, MonitorConstraintData, i);
+      if (data->logical_monitor == logical_monitor)
+        {
+          cache->last_monitor = i;
+          return data;
+        }
+    }
+
+  cur_workspace = cache->window->display->workspace_manager->active_workspace;
+
+  g_array_set_size (cache->monitors, cache->monitors->len + 1);
+  cache->last_monitor = cache->monitors->len - 1;
+
+  data = &g_array_index (cache->monitors, MonitorConstraintData,
+                         cache->last_monitor);
+  data->logical_monitor = logical_monitor;
+  meta_window_get_work_area_for_logical_monitor (cache->window,
+                                                 logical_monitor,
+                                                 &data->work_area_monitor);
+  data->usable_monitor_region =
+    meta_workspace_get_onmonitor_region (cur_workspace, logical_monitor);
+
+  return data;
+}
+
 static void
 setup_constraint_info (ConstraintInfo      *info,
                        MetaWindow          *window,
@@ -350,6 +487,8 @@ setup_constraint_info (ConstraintInfo      *info,
     meta_backend_get_monitor_manager (backend);
   MetaLogicalMonitor *logical_monitor;
   MetaWorkspace *cur_workspace;
+  MetaConstraintCache *cache;
+  MonitorConstraintData *monitor_data = NULL;
 
   info->orig    = *orig;
   info->current = *new;
@@ -405,12 +544,24 @@ setup_constraint_info (ConstraintInfo      *info,
   if (!info->is_user_action)
     info->fixed_directions = FIXED_DIRECTION_NONE;
 
-  logical_monitor =
-    meta_monitor_manager_get_logical_monitor_from_rect (monitor_manager,
-                                                        &info->current);
-  meta_window_get_work_area_for_logical_monitor (window,
-                                                 logical_monitor,
-                                                 &info->work_area_monitor);
+  cache = ensure_constraint_cache (window);
+  if (cache)
+    {
+      monitor_data = get_monitor_constraint_data (cache,
+                                                  monitor_manager,
+                                                  &info->current);
+      logical_monitor = monitor_data->logical_monitor;
+      info->work_area_monitor = monitor_data->work_area_monitor;
+    }
+  else
+    {
+      logical_monitor =
+        meta_monitor_manager_get_logical_monitor_from_rect (monitor_manager,
+                                                            &info->current);
+      meta_window_get_work_area_for_logical_monitor (window,
+                                                     logical_monitor,
+                                                     &info->work_area_monitor);
+    }
 
   if (window->fullscreen && meta_window_has_fullscreen_monitors (window))
     {
@@ -432,11 +583,19 @@ setup_constraint_info (ConstraintInfo      *info,
         meta_window_adjust_fullscreen_monitor_rect (window, &info->entire_monitor);
     }
 
-  cur_workspace = window->display->workspace_manager->active_workspace;
-  info->usable_screen_region   =
-    meta_workspace_get_onscreen_region (cur_workspace);
-  info->usable_monitor_region =
-    meta_workspace_get_onmonitor_region (cur_workspace, logical_monitor);
+  if (monitor_data)
+    {
+      info->usable_screen_region = cache->usable_screen_region;
+      info->usable_monitor_region = monitor_data->usable_monitor_region;
+    }
+  else
+    {
+      cur_workspace = window->display->workspace_manager->active_workspace;
+      info->usable_screen_region   =
+        meta_workspace_get_onscreen_region (cur_workspace);
+      info->usable_monitor_region =
+        meta_workspace_get_onmonitor_region (cur_workspace, logical_monitor);
+    }
 
   /* Log all this information for debugging */
   meta_topic (META_DEBUG_GEOMETRY,
@@ -36,4 +36,6 @@ void meta_window_constrain (MetaWindow          *window,
                             int                 *rel_x,
                             int                 *rel_y);
 
+void meta_display_cleanup_constraint_cache (MetaDisplay *display);
+
 #endif /* META_CONSTRAINTS_H */
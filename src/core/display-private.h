@@ -51,6 +51,7 @@ typedef struct _MetaStack      MetaStack;
 typedef struct _MetaUISlave    MetaUISlave;
 
 typedef struct MetaEdgeResistanceData MetaEdgeResistanceData;
+typedef struct MetaConstraintCache MetaConstraintCache;
 
 typedef enum
 {
@@ -193,6 +194,7 @@ struct _MetaDisplay
   gboolean    grab_threshold_movement_reached; /* raise_on_click == FALSE.    */
   int64_t     grab_last_moveresize_time;
   MetaEdgeResistanceData *grab_edge_resistance_data;
+  MetaConstraintCache *grab_constraint_cache;
   unsigned int grab_last_user_action_was_snap;
 
   int	      grab_resize_timeout_id;
@@ -329,8 +331,10 @@ void meta_display_grab_focus_window_button   (MetaDisplay *display,
 void meta_display_ungrab_focus_window_button (MetaDisplay *display,
                                               MetaWindow  *window);
 
-/* Next function is defined in edge-resistance.c */
+/* Next functions are defined in edge-resistance.c */
 void meta_display_cleanup_edges              (MetaDisplay *display);
+void meta_display_invalidate_window_edges    (MetaDisplay *display,
+                                              MetaWindow  *window);
 
 /* utility goo */
 const char* meta_event_mode_to_string   (int m);
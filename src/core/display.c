@@ -58,6 +58,7 @@
 #include "cogl/cogl.h"
 #include "core/bell.h"
 #include "core/boxes-private.h"
+#include "core/constraints.h"
 #include "core/display-private.h"
 #include "core/events.h"
 #include "core/frame.h"
@@ -1956,8 +1957,9 @@ meta_display_end_grab_op (MetaDisplay *display,
 
   if (display->event_route == META_EVENT_ROUTE_WINDOW_OP)
     {
-      /* Clear out the edge cache */
+      /* Clear out the edge and constraint caches */
       meta_display_cleanup_edges (display);
+      meta_display_cleanup_constraint_cache (display);
 
       /* Only raise the window in orthogonal raise
        * ('do-not-raise-on-click') mode if the user didn't try to move
@@ -2573,25 +2575,27 @@ meta_resize_gravity_from_grab_op (MetaGrabOp op)
 void
 meta_display_manage_all_xwindows (MetaDisplay *display)
 {
-  guint64 *_children;
   guint64 *children;
-  int n_children, i;
+  Window *xwindows;
+  int n_children, n_xwindows, i;
 
   meta_stack_freeze (display->stack);
-  meta_stack_tracker_get_stack (display->stack_tracker, &_children, &n_children);
+  meta_stack_tracker_get_stack (display->stack_tracker, &children, &n_children);
 
-  /* Copy the stack as it will be modified as part of the loop */
-  children = g_memdup (_children, sizeof (guint64) * n_children);
+  /* Copy the stack as it will be modified as part of managing the windows */
+  xwindows = g_new (Window, n_children);
+  n_xwindows = 0;
 
   for (i = 0; i < n_children; ++i)
     {
       if (!META_STACK_ID_IS_X11 (children[i]))
         continue;
-      meta_window_x11_new (display, children[i], TRUE,
-                           META_COMP_EFFECT_NONE);
+      xwindows[n_xwindows++] = (Window) children[i];
     }
 
-  g_free (children);
+  meta_window_x11_manage_existing (display, xwindows, n_xwindows);
+
+  g_free (xwindows);
   meta_stack_thaw (display->stack);
 }
 
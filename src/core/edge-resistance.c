@@ -52,15 +52,21 @@ typedef struct ResistanceDataForAnEdge ResistanceDataForAnEdge;
 
 struct MetaEdgeResistanceData
 {
-  GArray *left_edges;
-  GArray *right_edges;
-  GArray *top_edges;
-  GArray *bottom_edges;
+  /* Left and right edges sorted by x, top and bottom edges sorted by y */
+  GArray *vertical_edges;
+  GArray *horizontal_edges;
+
+  MetaEdgeIndex *vertical_index;
+  MetaEdgeIndex *horizontal_index;
 
   ResistanceDataForAnEdge left_data;
   ResistanceDataForAnEdge right_data;
   ResistanceDataForAnEdge top_data;
   ResistanceDataForAnEdge bottom_data;
+
+  /* Set when another window moved, was shown or hidden, or got restacked
+   * during the grab, so that the window edges need to be recomputed */
+  gboolean window_edges_stale;
 };
 
 static void compute_resistance_and_snapping_edges (MetaDisplay *display);
@@ -179,6 +185,7 @@ points_on_same_side (int ref, int pt1, int pt2)
 
 static int
 find_nearest_position (const GArray        *edges,
+                       const MetaEdgeIndex *edge_index,
                        int                  position,
                        int                  old_position,
                        const MetaRectangle *new_rect,
@@ -194,6 +201,7 @@ find_nearest_position (const GArray        *edges,
   int compare;
   MetaEdge *edge;
   int best, best_dist, i;
+  int span_start, span_end;
   gboolean edges_align;
 
   /* Initialize mid, edge, & compare in the off change that the array only
@@ -243,9 +251,18 @@ find_nearest_position (const GArray        *edges,
         }
     }
 
+  /* Only the edges overlapping new_rect matter, skip the others */
+  span_start = horizontal ? BOX_TOP (*new_rect) : BOX_LEFT (*new_rect);
+  span_end = horizontal ? BOX_BOTTOM (*new_rect) : BOX_RIGHT (*new_rect);
+
   /* Now start searching higher than mid */
   for (i = mid + 1; i < (int)edges->len; i++)
     {
+      i = meta_edge_index_find_aligned (edge_index, i, edges->len - 1,
+                                        span_start, span_end);
+      if (i < 0)
+        break;
+
       edge = g_array_index (edges, MetaEdge*, i);
       compare = horizontal ? edge->rect.x : edge->rect.y;
 
@@ -270,6 +287,11 @@ find_nearest_position (const GArray        *edges,
   /* Now start searching lower than mid */
   for (i = mid-1; i >= 0; i--)
     {
+      i = meta_edge_index_find_aligned (edge_index, i, 0,
+                                        span_start, span_end);
+      if (i < 0)
+        break;
+
       edge = g_array_index (edges, MetaEdge*, i);
       compare = horizontal ? edge->rect.x : edge->rect.y;
 
@@ -331,6 +353,7 @@ apply_edge_resistance (MetaWindow                *window,
                        const MetaRectangle       *old_rect,
                        const MetaRectangle       *new_rect,
                        GArray                    *edges,
+                       const MetaEdgeIndex       *edge_index,
                        ResistanceDataForAnEdge   *resistance_data,
                        GSourceFunc                timeout_func,
                        gboolean                   xdir,
@@ -338,6 +361,7 @@ apply_edge_resistance (MetaWindow                *window,
 {
   int i, begin, end;
   int last_edge;
+  int span_start, span_end;
   gboolean increasing = new_pos > old_pos;
   int      increment = increasing ? 1 : -1;
 
@@ -377,14 +401,36 @@ apply_edge_resistance (MetaWindow                *window,
   begin = CLAMP (begin, 0, last_edge);
   end   = CLAMP (end,   0, last_edge);
 
+  /* Only edges aligning with either rect are relevant, so skip any edge
+   * not overlapping the extent of both of them.
+   */
+  if (xdir)
+    {
+      span_start = MIN (BOX_TOP (*old_rect), BOX_TOP (*new_rect));
+      span_end = MAX (BOX_BOTTOM (*old_rect), BOX_BOTTOM (*new_rect));
+    }
+  else
+    {
+      span_start = MIN (BOX_LEFT (*old_rect), BOX_LEFT (*new_rect));
+      span_end = MAX (BOX_RIGHT (*old_rect), BOX_RIGHT (*new_rect));
+    }
+
   /* Loop over all these edges we're moving past/to. */
   i = begin;
   while ((increasing  && i <= end) ||
          (!increasing && i >= end))
     {
       gboolean  edges_align;
-      MetaEdge *edge = g_array_index (edges, MetaEdge*, i);
-      int       compare = xdir ? edge->rect.x : edge->rect.y;
+      MetaEdge *edge;
+      int       compare;
+
+      i = meta_edge_index_find_aligned (edge_index, i, end,
+                                        span_start, span_end);
+      if (i < 0)
+        break;
+
+      edge = g_array_index (edges, MetaEdge*, i);
+      compare = xdir ? edge->rect.x : edge->rect.y;
 
       /* Find out if this edge is relevant */
       edges_align = meta_rectangle_edge_aligns (new_rect, edge)  ||
@@ -499,6 +545,7 @@ apply_edge_snapping (int                  old_pos,
                      int                  new_pos,
                      const MetaRectangle *new_rect,
                      GArray              *edges,
+                     const MetaEdgeIndex *edge_index,
                      gboolean             xdir,
                      gboolean             keyboard_op)
 {
@@ -508,6 +555,7 @@ apply_edge_snapping (int                  old_pos,
     return new_pos;
 
   snap_to = find_nearest_position (edges,
+                                   edge_index,
                                    new_pos,
                                    old_pos,
                                    new_rect,
@@ -551,7 +599,8 @@ apply_edge_resistance_to_each_side (MetaDisplay         *display,
   gboolean                modified;
   int new_left, new_right, new_top, new_bottom;
 
-  if (display->grab_edge_resistance_data == NULL)
+  if (display->grab_edge_resistance_data == NULL ||
+      display->grab_edge_resistance_data->window_edges_stale)
     compute_resistance_and_snapping_edges (display);
 
   edge_data = display->grab_edge_resistance_data;
@@ -566,28 +615,32 @@ apply_edge_resistance_to_each_side (MetaDisplay         *display,
       new_left   = apply_edge_snapping (BOX_LEFT (*old_outer),
                                         BOX_LEFT (*new_outer),
                                         new_outer,
-                                        edge_data->left_edges,
+                                        edge_data->vertical_edges,
+                                        edge_data->vertical_index,
                                         TRUE,
                                         keyboard_op);
 
       new_right  = apply_edge_snapping (BOX_RIGHT (*old_outer),
                                         BOX_RIGHT (*new_outer),
                                         new_outer,
-                                        edge_data->right_edges,
+                                        edge_data->vertical_edges,
+                                        edge_data->vertical_index,
                                         TRUE,
                                         keyboard_op);
 
       new_top    = apply_edge_snapping (BOX_TOP (*old_outer),
                                         BOX_TOP (*new_outer),
                                         new_outer,
-                                        edge_data->top_edges,
+                                        edge_data->horizontal_edges,
+                                        edge_data->horizontal_index,
                                         FALSE,
                                         keyboard_op);
 
       new_bottom = apply_edge_snapping (BOX_BOTTOM (*old_outer),
                                         BOX_BOTTOM (*new_outer),
                                         new_outer,
-                                        edge_data->bottom_edges,
+                                        edge_data->horizontal_edges,
+                                        edge_data->horizontal_index,
                                         FALSE,
                                         keyboard_op);
     }
@@ -649,7 +702,8 @@ apply_edge_resistance_to_each_side (MetaDisplay         *display,
                                               BOX_LEFT (*new_outer),
                                               old_outer,
                                               new_outer,
-                                              edge_data->left_edges,
+                                              edge_data->vertical_edges,
+                                              edge_data->vertical_index,
                                               &edge_data->left_data,
                                               timeout_func,
                                               TRUE,
@@ -659,7 +713,8 @@ apply_edge_resistance_to_each_side (MetaDisplay         *display,
                                               BOX_RIGHT (*new_outer),
                                               old_outer,
                                               new_outer,
-                                              edge_data->right_edges,
+                                              edge_data->vertical_edges,
+                                              edge_data->vertical_index,
                                               &edge_data->right_data,
                                               timeout_func,
                                               TRUE,
@@ -678,7 +733,8 @@ apply_edge_resistance_to_each_side (MetaDisplay         *display,
                                               BOX_TOP (*new_outer),
                                               old_outer,
                                               new_outer,
-                                              edge_data->top_edges,
+                                              edge_data->horizontal_edges,
+                                              edge_data->horizontal_index,
                                               &edge_data->top_data,
                                               timeout_func,
                                               FALSE,
@@ -688,7 +744,8 @@ apply_edge_resistance_to_each_side (MetaDisplay         *display,
                                               BOX_BOTTOM (*new_outer),
                                               old_outer,
                                               new_outer,
-                                              edge_data->bottom_edges,
+                                              edge_data->horizontal_edges,
+                                              edge_data->horizontal_index,
                                               &edge_data->bottom_data,
                                               timeout_func,
                                               FALSE,
@@ -711,73 +768,43 @@ apply_edge_resistance_to_each_side (MetaDisplay         *display,
   return modified;
 }
 
-void
-meta_display_cleanup_edges (MetaDisplay *display)
+static void
+free_cached_edges (MetaEdgeResistanceData *edge_data)
 {
-  guint i,j;
-  MetaEdgeResistanceData *edge_data = display->grab_edge_resistance_data;
-  GHashTable *edges_to_be_freed;
-
-  if (edge_data == NULL) /* Not currently cached */
-    return;
+  guint i, j;
 
   /* We first need to clean out any window edges */
-  edges_to_be_freed = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-                                             g_free, NULL);
-  for (i = 0; i < 4; i++)
+  for (i = 0; i < 2; i++)
     {
-      GArray *tmp = NULL;
-      MetaSide side;
-      switch (i)
-        {
-        case 0:
-          tmp = edge_data->left_edges;
-          side = META_SIDE_LEFT;
-          break;
-        case 1:
-          tmp = edge_data->right_edges;
-          side = META_SIDE_RIGHT;
-          break;
-        case 2:
-          tmp = edge_data->top_edges;
-          side = META_SIDE_TOP;
-          break;
-        case 3:
-          tmp = edge_data->bottom_edges;
-          side = META_SIDE_BOTTOM;
-          break;
-        default:
-          g_assert_not_reached ();
-        }
+      GArray *tmp = i == 0 ? edge_data->vertical_edges
+                           : edge_data->horizontal_edges;
 
       for (j = 0; j < tmp->len; j++)
         {
           MetaEdge *edge = g_array_index (tmp, MetaEdge*, j);
-          if (edge->edge_type == META_EDGE_WINDOW &&
-              edge->side_type == side)
-            {
-              /* The same edge will appear in two arrays, and we can't free
-               * it yet we still need to compare edge->side_type for the other
-               * array that it is in.  So store it in a hash table for later
-               * freeing.  Could also do this in a simple linked list.
-               */
-              g_hash_table_insert (edges_to_be_freed, edge, edge);
-            }
+          if (edge->edge_type == META_EDGE_WINDOW)
+            g_free (edge);
         }
     }
 
-  /* Now free all the window edges (the key destroy function is g_free) */
-  g_hash_table_destroy (edges_to_be_freed);
-
   /* Now free the arrays and data */
-  g_array_free (edge_data->left_edges, TRUE);
-  g_array_free (edge_data->right_edges, TRUE);
-  g_array_free (edge_data->top_edges, TRUE);
-  g_array_free (edge_data->bottom_edges, TRUE);
-  edge_data->left_edges = NULL;
-  edge_data->right_edges = NULL;
-  edge_data->top_edges = NULL;
-  edge_data->bottom_edges = NULL;
+  g_clear_pointer (&edge_data->vertical_index, meta_edge_index_free);
+  g_clear_pointer (&edge_data->horizontal_index, meta_edge_index_free);
+  g_array_free (edge_data->vertical_edges, TRUE);
+  g_array_free (edge_data->horizontal_edges, TRUE);
+  edge_data->vertical_edges = NULL;
+  edge_data->horizontal_edges = NULL;
+}
+
+void
+meta_display_cleanup_edges (MetaDisplay *display)
+{
+  MetaEdgeResistanceData *edge_data = display->grab_edge_resistance_data;
+
+  if (edge_data == NULL) /* Not currently cached */
+    return;
+
+  free_cached_edges (edge_data);
 
   /* Cleanup the timeouts */
   if (edge_data->left_data.timeout_setup)
@@ -793,6 +820,36 @@ meta_display_cleanup_edges (MetaDisplay *display)
   display->grab_edge_resistance_data = NULL;
 }
 
+/**
+ * meta_display_invalidate_window_edges:
+ * @display: a #MetaDisplay
+ * @window: (nullable): the window that changed, or %NULL if the stacking
+ *   order changed
+ *
+ * Lets a move or resize operation in progress know that the edges of
+ * other windows may have changed, so that they are recomputed before
+ * resistance or snapping is applied again.
+ */
+void
+meta_display_invalidate_window_edges (MetaDisplay *display,
+                                      MetaWindow  *window)
+{
+  MetaEdgeResistanceData *edge_data = display->grab_edge_resistance_data;
+
+  if (edge_data == NULL)
+    return;
+
+  /* The grab window's edges aren't cached, and neither do the ones of
+   * the dialogs attached to it matter, as they move along with it. */
+  if (window != NULL &&
+      (window == display->grab_window ||
+       (meta_window_is_attached_dialog (window) &&
+        window->transient_for == display->grab_window)))
+    return;
+
+  edge_data->window_edges_stale = TRUE;
+}
+
 static int
 stupid_sort_requiring_extra_pointer_dereference (gconstpointer a,
                                                  gconstpointer b)
@@ -803,12 +860,11 @@ stupid_sort_requiring_extra_pointer_dereference (gconstpointer a,
 }
 
 static void
-cache_edges (MetaDisplay *display,
-             GList *window_edges,
-             GList *monitor_edges,
-             GList *screen_edges)
+cache_edges (MetaEdgeResistanceData *edge_data,
+             GList                  *window_edges,
+             GList                  *monitor_edges,
+             GList                  *screen_edges)
 {
-  MetaEdgeResistanceData *edge_data;
   GList *tmp;
   int num_left, num_right, num_top, num_bottom;
   int i;
@@ -887,25 +943,14 @@ cache_edges (MetaDisplay *display,
   /*
    * 2nd: Allocate the edges
    */
-  g_assert (display->grab_edge_resistance_data == NULL);
-  display->grab_edge_resistance_data = g_new0 (MetaEdgeResistanceData, 1);
-  edge_data = display->grab_edge_resistance_data;
-  edge_data->left_edges   = g_array_sized_new (FALSE,
-                                               FALSE,
-                                               sizeof(MetaEdge*),
-                                               num_left + num_right);
-  edge_data->right_edges  = g_array_sized_new (FALSE,
-                                               FALSE,
-                                               sizeof(MetaEdge*),
-                                               num_left + num_right);
-  edge_data->top_edges    = g_array_sized_new (FALSE,
-                                               FALSE,
-                                               sizeof(MetaEdge*),
-                                               num_top + num_bottom);
-  edge_data->bottom_edges = g_array_sized_new (FALSE,
-                                               FALSE,
-                                               sizeof(MetaEdge*),
-                                               num_top + num_bottom);
+  edge_data->vertical_edges   = g_array_sized_new (FALSE,
+                                                   FALSE,
+                                                   sizeof(MetaEdge*),
+                                                   num_left + num_right);
+  edge_data->horizontal_edges = g_array_sized_new (FALSE,
+                                                   FALSE,
+                                                   sizeof(MetaEdge*),
+                                                   num_top + num_bottom);
 
   /*
    * 3rd: Add the edges to the arrays
@@ -935,13 +980,11 @@ cache_edges (MetaDisplay *display,
             {
             case META_SIDE_LEFT:
             case META_SIDE_RIGHT:
-              g_array_append_val (edge_data->left_edges, edge);
-              g_array_append_val (edge_data->right_edges, edge);
+              g_array_append_val (edge_data->vertical_edges, edge);
               break;
             case META_SIDE_TOP:
             case META_SIDE_BOTTOM:
-              g_array_append_val (edge_data->top_edges, edge);
-              g_array_append_val (edge_data->bottom_edges, edge);
+              g_array_append_val (edge_data->horizontal_edges, edge);
               break;
             default:
               g_assert_not_reached ();
@@ -956,14 +999,17 @@ cache_edges (MetaDisplay *display,
    * avoided this sort by sticking them into the array with some simple
    * merging of the lists).
    */
-  g_array_sort (display->grab_edge_resistance_data->left_edges,
-                stupid_sort_requiring_extra_pointer_dereference);
-  g_array_sort (display->grab_edge_resistance_data->right_edges,
+  g_array_sort (edge_data->vertical_edges,
                 stupid_sort_requiring_extra_pointer_dereference);
-  g_array_sort (display->grab_edge_resistance_data->top_edges,
-                stupid_sort_requiring_extra_pointer_dereference);
-  g_array_sort (display->grab_edge_resistance_data->bottom_edges,
+  g_array_sort (edge_data->horizontal_edges,
                 stupid_sort_requiring_extra_pointer_dereference);
+
+  /*
+   * 5th: Index the arrays, so that looking for edges aligned with the
+   * window doesn't need to go through all of them
+   */
+  edge_data->vertical_index = meta_edge_index_new (edge_data->vertical_edges);
+  edge_data->horizontal_index = meta_edge_index_new (edge_data->horizontal_edges);
 }
 
 static void
@@ -985,6 +1031,7 @@ initialize_grab_edge_resistance_data (MetaDisplay *display)
 static void
 compute_resistance_and_snapping_edges (MetaDisplay *display)
 {
+  MetaEdgeResistanceData *edge_data = display->grab_edge_resistance_data;
   GList *stacked_windows;
   GList *cur_window_iter;
   GList *edges;
@@ -1002,6 +1049,11 @@ compute_resistance_and_snapping_edges (MetaDisplay *display)
               "Computing edges to resist-movement or snap-to for %s.\n",
               display->grab_window->desc);
 
+  /* Edges going stale during the grab are recomputed, but any resistance
+   * already built up against them is kept */
+  if (edge_data != NULL)
+    free_cached_edges (edge_data);
+
   /*
    * 1st: Get the list of relevant windows, from bottom to top
    */
@@ -1161,16 +1213,20 @@ compute_resistance_and_snapping_edges (MetaDisplay *display)
    * monitor edges in an array for quick access.  Free the edges since
    * they've been cached elsewhere.
    */
-  cache_edges (display,
+  if (edge_data == NULL)
+    {
+      display->grab_edge_resistance_data = g_new0 (MetaEdgeResistanceData, 1);
+      initialize_grab_edge_resistance_data (display);
+    }
+
+  edge_data = display->grab_edge_resistance_data;
+  edge_data->window_edges_stale = FALSE;
+
+  cache_edges (edge_data,
                edges,
                workspace_manager->active_workspace->monitor_edges,
                workspace_manager->active_workspace->screen_edges);
   g_list_free (edges);
-
-  /*
-   * 6th: Initialize the resistance timeouts and buildups
-   */
-  initialize_grab_edge_resistance_data (display);
 }
 
 void
@@ -1161,6 +1161,84 @@ meta_stack_tracker_keep_override_redirect_on_top (MetaStackTracker *tracker)
     }
 }
 
+/* Finds the largest set of managed windows stacked below @top_pos that are
+ * already in the right order relative to each other; these don't need to be
+ * restacked, only the other windows need to be moved in between them. This
+ * is the longest increasing subsequence of their positions in @managed.
+ */
+static void
+find_windows_in_order (MetaStackTracker *tracker,
+                       const guint64    *managed,
+                       int               n_managed,
+                       int               top_pos,
+                       gboolean         *in_order)
+{
+  g_autoptr (GHashTable) new_positions = NULL;
+  guint64 *windows;
+  int n_windows;
+  int *seq, *tails, *prev;
+  int n_seq = 0, n_tails = 0;
+  int i, j;
+
+  if (top_pos <= 0)
+    return;
+
+  meta_stack_tracker_get_stack (tracker, &windows, &n_windows);
+
+  new_positions = g_hash_table_new (g_int64_hash, g_int64_equal);
+  for (i = 0; i < n_managed; i++)
+    g_hash_table_insert (new_positions, (gpointer) &managed[i],
+                         GINT_TO_POINTER (i + 1));
+
+  seq = g_new (int, top_pos);
+  tails = g_new (int, top_pos);
+  prev = g_new (int, top_pos);
+
+  /* Hidden windows are below the guard window and are restacked
+   * separately, so only look at the windows above it */
+  for (i = top_pos - 1; i >= 0; i--)
+    {
+      int new_pos;
+
+      if (meta_stack_tracker_is_guard_window (tracker, windows[i]))
+        break;
+
+      new_pos = GPOINTER_TO_INT (g_hash_table_lookup (new_positions,
+                                                      &windows[i]));
+      if (new_pos > 0)
+        seq[n_seq++] = new_pos - 1;
+    }
+
+  /* seq was filled top to bottom; compute the longest strictly decreasing
+   * subsequence, i.e. the longest increasing one from bottom to top */
+  for (j = 0; j < n_seq; j++)
+    {
+      int lo = 0, hi = n_tails;
+
+      while (lo < hi)
+        {
+          int mid = (lo + hi) / 2;
+
+          if (seq[tails[mid]] > seq[j])
+            lo = mid + 1;
+          else
+            hi = mid;
+        }
+
+      prev[j] = lo > 0 ? tails[lo - 1] : -1;
+      tails[lo] = j;
+      if (lo == n_tails)
+        n_tails++;
+    }
+
+  for (j = n_tails > 0 ? tails[n_tails - 1] : -1; j >= 0; j = prev[j])
+    in_order[seq[j]] = TRUE;
+
+  g_free (prev);
+  g_free (tails);
+  g_free (seq);
+}
+
 void
 meta_stack_tracker_restack_managed (MetaStackTracker *tracker,
                                     const guint64    *managed,
@@ -1168,7 +1246,8 @@ meta_stack_tracker_restack_managed (MetaStackTracker *tracker,
 {
   guint64 *windows;
   int n_windows;
-  int old_pos, new_pos;
+  int old_pos, new_pos, top_pos;
+  gboolean *in_order;
 
   if (n_managed == 0)
     return;
@@ -1196,44 +1275,36 @@ meta_stack_tracker_restack_managed (MetaStackTracker *tracker,
       /* Move the first managed window in the new stack above all managed windows */
       meta_stack_tracker_raise_above (tracker, managed[new_pos], windows[old_pos]);
       meta_stack_tracker_get_stack (tracker, &windows, &n_windows);
-      /* Moving managed[new_pos] above windows[old_pos], moves the window at old_pos down by one */
     }
 
-  old_pos--;
-  new_pos--;
-
-  while (old_pos >= 0 && new_pos >= 0)
+  for (top_pos = n_windows - 1; top_pos >= 0; top_pos--)
     {
-      if (meta_stack_tracker_is_guard_window (tracker, windows[old_pos]))
+      if (windows[top_pos] == managed[new_pos])
         break;
+    }
 
-      if (windows[old_pos] == managed[new_pos])
-        {
-          old_pos--;
-          new_pos--;
-          continue;
-        }
+  /* Rather than walking both stacks and moving every window that doesn't
+   * match, which can move most of the windows when a single one changed
+   * place, only move the windows that are out of order; this results in
+   * the smallest number of restack requests and predictions.
+   */
+  in_order = g_new0 (gboolean, n_managed);
+  in_order[new_pos] = TRUE;
 
-      MetaWindow *old_window = meta_display_lookup_stack_id (tracker->display, windows[old_pos]);
-      if (!old_window || old_window->override_redirect || old_window->unmanaging)
-        {
-          old_pos--;
-          continue;
-        }
+  find_windows_in_order (tracker, managed, n_managed, top_pos, in_order);
 
+  for (new_pos = n_managed - 2; new_pos >= 0; new_pos--)
+    {
+      if (in_order[new_pos])
+        continue;
+
+      /* The window above has either been kept in place or moved right
+       * below the one above it, so this keeps the order of all windows
+       * restacked so far */
       meta_stack_tracker_lower_below (tracker, managed[new_pos], managed[new_pos + 1]);
-      meta_stack_tracker_get_stack (tracker, &windows, &n_windows);
-      /* Moving managed[new_pos] above windows[old_pos] moves the window at old_pos down by one,
-       * we'll examine it again to see if it matches the next new window */
-      old_pos--;
-      new_pos--;
     }
 
-  while (new_pos > 0)
-    {
-      meta_stack_tracker_lower_below (tracker, managed[new_pos], managed[new_pos - 1]);
-      new_pos--;
-    }
+  g_free (in_order);
 }
 
 void
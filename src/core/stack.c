@@ -45,6 +45,10 @@
 
 static void meta_window_set_stack_position_no_sync (MetaWindow *window,
                                                     int         position);
+static void stack_queue_resort (MetaStack  *stack,
+                                MetaWindow *moved_window);
+static void stack_queue_constrain (MetaStack  *stack,
+                                   MetaWindow *moved_window);
 static void stack_do_relayer (MetaStack *stack);
 static void stack_do_constrain (MetaStack *stack);
 static void stack_do_resort (MetaStack *stack);
@@ -98,7 +102,7 @@ on_stack_changed (MetaStack *stack)
         continue;
 
       meta_topic (META_DEBUG_STACK, "%u:%d - %s ",
-		  w->layer, w->stack_position, w->desc);
+		  w->layer, meta_window_get_stack_position (w), w->desc);
 
       if (w->frame)
 	top_level_window = w->frame->xwindow;
@@ -155,6 +159,12 @@ on_stack_changed (MetaStack *stack)
 static void
 meta_stack_init (MetaStack *stack)
 {
+  stack->sorted = g_sequence_new (NULL);
+  stack->positions = g_sequence_new (NULL);
+  stack->transient_family = g_ptr_array_new ();
+  stack->constraints = g_ptr_array_new ();
+  stack->constraint_pool = g_ptr_array_new_with_free_func (g_free);
+
   g_signal_connect (stack, "changed",
                     G_CALLBACK (on_stack_changed), NULL);
 }
@@ -164,7 +174,11 @@ meta_stack_finalize (GObject *object)
 {
   MetaStack *stack = META_STACK (object);
 
-  g_list_free (stack->sorted);
+  g_sequence_free (stack->sorted);
+  g_sequence_free (stack->positions);
+  g_ptr_array_free (stack->transient_family, TRUE);
+  g_ptr_array_free (stack->constraints, TRUE);
+  g_ptr_array_free (stack->constraint_pool, TRUE);
 
   G_OBJECT_CLASS (meta_stack_parent_class)->finalize (object);
 }
@@ -261,6 +275,7 @@ meta_stack_changed (MetaStack *stack)
     return;
 
   stack_ensure_sorted (stack);
+  meta_display_invalidate_window_edges (stack->display, NULL);
   g_signal_emit (stack, signals[CHANGED], 0);
 }
 
@@ -280,18 +295,18 @@ meta_stack_add (MetaStack  *stack,
   if (meta_window_is_in_stack (window))
     meta_bug ("Window %s had stack position already\n", window->desc);
 
-  stack->sorted = g_list_prepend (stack->sorted, window);
-  stack->need_resort = TRUE; /* may not be needed as we add to top */
-  stack->need_constrain = TRUE;
+  window->stack_sorted_iter = g_sequence_prepend (stack->sorted, window);
+  stack_queue_resort (stack, NULL); /* may not be needed as we add to top */
+  stack_queue_constrain (stack, NULL);
   stack->need_relayer = TRUE;
 
   g_signal_emit (stack, signals[WINDOW_ADDED], 0, window);
 
-  window->stack_position = stack->n_positions;
+  window->stack_position_iter = g_sequence_append (stack->positions, window);
   stack->n_positions += 1;
   meta_topic (META_DEBUG_STACK,
               "Window %s has stack_position initialized to %d\n",
-              window->desc, window->stack_position);
+              window->desc, meta_window_get_stack_position (window));
 
   meta_stack_changed (stack);
   meta_stack_update_window_tile_matches (stack, workspace_manager->active_workspace);
@@ -302,21 +317,38 @@ meta_stack_remove (MetaStack  *stack,
                    MetaWindow *window)
 {
   MetaWorkspaceManager *workspace_manager = window->display->workspace_manager;
+  gboolean was_sorted, was_constrained;
 
   COGL_TRACE_BEGIN_SCOPED (MetaStackRemove,
                            "Stack (remove window)");
 
   meta_topic (META_DEBUG_STACK, "Removing window %s from the stack\n", window->desc);
 
-  /* Set window to top position, so removing it will not leave gaps
-   * in the set of positions
+  was_sorted = !stack->need_resort;
+  was_constrained = !stack->need_constrain;
+
+  /* Removing the window from the positions shifts the windows above it
+   * down, so no gaps are left in the set of positions
    */
-  meta_window_set_stack_position_no_sync (window,
-                                          stack->n_positions - 1);
-  window->stack_position = -1;
+  g_sequence_remove (window->stack_position_iter);
+  window->stack_position_iter = NULL;
   stack->n_positions -= 1;
 
-  stack->sorted = g_list_remove (stack->sorted, window);
+  g_sequence_remove (window->stack_sorted_iter);
+  window->stack_sorted_iter = NULL;
+
+  /* The other windows kept their relative order, so removing a window
+   * cannot unsort the stack or break any of the remaining constraints.
+   */
+  if (was_sorted)
+    stack->need_resort = FALSE;
+  if (was_constrained)
+    stack->need_constrain = FALSE;
+
+  if (stack->resort_window == window)
+    stack->resort_window = NULL;
+  if (stack->constrain_window == window)
+    stack->constrain_window = NULL;
 
   g_signal_emit (stack, signals[WINDOW_REMOVED], 0, window);
 
@@ -330,6 +362,10 @@ meta_stack_update_layer (MetaStack  *stack,
 {
   MetaWorkspaceManager *workspace_manager = window->display->workspace_manager;
   stack->need_relayer = TRUE;
+  /* Layers are updated on type and group changes, which can also change
+   * the constraints of the window
+   */
+  stack_queue_constrain (stack, NULL);
 
   meta_stack_changed (stack);
   meta_stack_update_window_tile_matches (stack, workspace_manager->active_workspace);
@@ -340,7 +376,7 @@ meta_stack_update_transient (MetaStack  *stack,
                              MetaWindow *window)
 {
   MetaWorkspaceManager *workspace_manager = window->display->workspace_manager;
-  stack->need_constrain = TRUE;
+  stack_queue_constrain (stack, NULL);
 
   meta_stack_changed (stack);
   meta_stack_update_window_tile_matches (stack, workspace_manager->active_workspace);
@@ -352,25 +388,28 @@ meta_stack_raise (MetaStack  *stack,
                   MetaWindow *window)
 {
   MetaWorkspaceManager *workspace_manager = window->display->workspace_manager;
-  GList *l;
-  int max_stack_position = window->stack_position;
+  GSequenceIter *iter;
   MetaWorkspace *workspace;
 
+  g_return_if_fail (meta_window_is_in_stack (window));
+
   stack_ensure_sorted (stack);
 
+  /* Find the topmost window on the workspace, walking down from the top
+   * only past windows on other workspaces
+   */
   workspace = meta_window_get_workspace (window);
-  for (l = stack->sorted; l; l = l->next)
-    {
-      MetaWindow *w = (MetaWindow *) l->data;
-      if (meta_window_located_on_workspace (w, workspace) &&
-          w->stack_position > max_stack_position)
-        max_stack_position = w->stack_position;
-    }
+  iter = g_sequence_get_end_iter (stack->positions);
+  do
+    iter = g_sequence_iter_prev (iter);
+  while (iter != window->stack_position_iter &&
+         !meta_window_located_on_workspace (g_sequence_get (iter), workspace));
 
-  if (max_stack_position == window->stack_position)
+  if (iter == window->stack_position_iter)
     return;
 
-  meta_window_set_stack_position_no_sync (window, max_stack_position);
+  meta_window_set_stack_position_no_sync (window,
+                                          g_sequence_iter_get_position (iter));
 
   meta_stack_changed (stack);
   meta_stack_update_window_tile_matches (stack, workspace_manager->active_workspace);
@@ -381,25 +420,27 @@ meta_stack_lower (MetaStack  *stack,
                   MetaWindow *window)
 {
   MetaWorkspaceManager *workspace_manager = window->display->workspace_manager;
-  GList *l;
-  int min_stack_position = window->stack_position;
+  GSequenceIter *iter;
   MetaWorkspace *workspace;
 
+  g_return_if_fail (meta_window_is_in_stack (window));
+
   stack_ensure_sorted (stack);
 
+  /* Find the bottommost window on the workspace, walking up from the
+   * bottom only past windows on other workspaces
+   */
   workspace = meta_window_get_workspace (window);
-  for (l = stack->sorted; l; l = l->next)
-    {
-      MetaWindow *w = (MetaWindow *) l->data;
-      if (meta_window_located_on_workspace (w, workspace) &&
-          w->stack_position < min_stack_position)
-        min_stack_position = w->stack_position;
-    }
+  iter = g_sequence_get_begin_iter (stack->positions);
+  while (iter != window->stack_position_iter &&
+         !meta_window_located_on_workspace (g_sequence_get (iter), workspace))
+    iter = g_sequence_iter_next (iter);
 
-  if (min_stack_position == window->stack_position)
+  if (iter == window->stack_position_iter)
     return;
 
-  meta_window_set_stack_position_no_sync (window, min_stack_position);
+  meta_window_set_stack_position_no_sync (window,
+                                          g_sequence_iter_get_position (iter));
 
   meta_stack_changed (stack);
   meta_stack_update_window_tile_matches (stack, workspace_manager->active_workspace);
@@ -445,23 +486,21 @@ meta_stack_update_window_tile_matches (MetaStack     *stack,
  * so the lower stack position is later in the list
  */
 static int
-compare_window_position (void *a,
-                         void *b)
+compare_window_position (gconstpointer a,
+                         gconstpointer b,
+                         gpointer      user_data)
 {
-  MetaWindow *window_a = a;
-  MetaWindow *window_b = b;
+  const MetaWindow *window_a = a;
+  const MetaWindow *window_b = b;
 
   /* Go by layer, then stack_position */
   if (window_a->layer < window_b->layer)
     return 1; /* move window_a later in list */
   else if (window_a->layer > window_b->layer)
     return -1;
-  else if (window_a->stack_position < window_b->stack_position)
-    return 1; /* move window_a later in list */
-  else if (window_a->stack_position > window_b->stack_position)
-    return -1;
   else
-    return 0; /* not reached */
+    return g_sequence_iter_compare (window_b->stack_position_iter,
+                                    window_a->stack_position_iter);
 }
 
 /*
@@ -513,8 +552,10 @@ struct Constraint
    */
   Constraint *next;
 
-  /* used to create the graph. */
-  GSList *next_nodes;
+  /* used to create the graph: the list of
+   * constraints for window "above"
+   */
+  Constraint *next_nodes;
 
   /* constraint has been applied, used
    * to detect cycles.
@@ -536,14 +577,15 @@ struct Constraint
  * positions are a convenient index.
  */
 static void
-add_constraint (Constraint **constraints,
-                MetaWindow  *above,
-                MetaWindow  *below)
+add_constraint (MetaStack  *stack,
+                MetaWindow *above,
+                MetaWindow *below)
 {
+  int below_position = meta_window_get_stack_position (below);
   Constraint *c;
 
   /* check if constraint is a duplicate */
-  c = constraints[below->stack_position];
+  c = g_ptr_array_index (stack->constraints, below_position);
   while (c != NULL)
     {
       if (c->above == above)
@@ -552,131 +594,153 @@ add_constraint (Constraint **constraints,
     }
 
   /* if not, add the constraint */
-  c = g_new (Constraint, 1);
+  if (stack->n_pooled_constraints_used < stack->constraint_pool->len)
+    {
+      c = g_ptr_array_index (stack->constraint_pool,
+                             stack->n_pooled_constraints_used);
+    }
+  else
+    {
+      c = g_new (Constraint, 1);
+      g_ptr_array_add (stack->constraint_pool, c);
+    }
+  stack->n_pooled_constraints_used++;
+
   c->above = above;
   c->below = below;
-  c->next = constraints[below->stack_position];
+  c->next = g_ptr_array_index (stack->constraints, below_position);
   c->next_nodes = NULL;
   c->applied = FALSE;
   c->has_prev = FALSE;
 
-  constraints[below->stack_position] = c;
+  g_ptr_array_index (stack->constraints, below_position) = c;
+
+  above->stack_constrained = TRUE;
+  below->stack_constrained = TRUE;
 }
 
 static void
-create_constraints (Constraint **constraints,
-                    GList       *windows)
+create_window_constraints (MetaStack  *stack,
+                           MetaWindow *w)
 {
-  GList *tmp;
-
-  tmp = windows;
-  while (tmp != NULL)
+  if (!meta_window_is_in_stack (w))
     {
-      MetaWindow *w = tmp->data;
+      meta_topic (META_DEBUG_STACK, "Window %s not in the stack, not constraining it\n",
+                  w->desc);
+      return;
+    }
 
-      if (!meta_window_is_in_stack (w))
-        {
-          meta_topic (META_DEBUG_STACK, "Window %s not in the stack, not constraining it\n",
-                      w->desc);
-          tmp = tmp->next;
-          continue;
-        }
+  if (WINDOW_TRANSIENT_FOR_WHOLE_GROUP (w))
+    {
+      GSList *group_windows;
+      GSList *tmp2;
+      MetaGroup *group;
 
-      if (WINDOW_TRANSIENT_FOR_WHOLE_GROUP (w))
-        {
-          GSList *group_windows;
-          GSList *tmp2;
-          MetaGroup *group;
+      group = meta_window_get_group (w);
 
-          group = meta_window_get_group (w);
+      if (group != NULL)
+        group_windows = meta_group_list_windows (group);
+      else
+        group_windows = NULL;
 
-          if (group != NULL)
-            group_windows = meta_group_list_windows (group);
-          else
-            group_windows = NULL;
+      tmp2 = group_windows;
 
-          tmp2 = group_windows;
+      while (tmp2 != NULL)
+        {
+          MetaWindow *group_window = tmp2->data;
 
-          while (tmp2 != NULL)
+          if (!meta_window_is_in_stack (group_window) ||
+              group_window->override_redirect)
             {
-              MetaWindow *group_window = tmp2->data;
-
-              if (!meta_window_is_in_stack (group_window) ||
-                  group_window->override_redirect)
-                {
-                  tmp2 = tmp2->next;
-                  continue;
-                }
+              tmp2 = tmp2->next;
+              continue;
+            }
 
 #if 0
-              /* old way of doing it */
-              if (!(meta_window_is_ancestor_of_transient (w, group_window)) &&
-                  !WINDOW_TRANSIENT_FOR_WHOLE_GROUP (group_window))  /* note */;/*note*/
+          /* old way of doing it */
+          if (!(meta_window_is_ancestor_of_transient (w, group_window)) &&
+              !WINDOW_TRANSIENT_FOR_WHOLE_GROUP (group_window))  /* note */;/*note*/
 #else
-              /* better way I think, so transient-for-group are constrained
-               * only above non-transient-type windows in their group
-               */
-              if (!meta_window_has_transient_type (group_window))
+          /* better way I think, so transient-for-group are constrained
+           * only above non-transient-type windows in their group
+           */
+          if (!meta_window_has_transient_type (group_window))
 #endif
-                {
-                  meta_topic (META_DEBUG_STACK, "Constraining %s above %s as it's transient for its group\n",
-                              w->desc, group_window->desc);
-                  add_constraint (constraints, w, group_window);
-                }
-
-              tmp2 = tmp2->next;
+            {
+              meta_topic (META_DEBUG_STACK, "Constraining %s above %s as it's transient for its group\n",
+                          w->desc, group_window->desc);
+              add_constraint (stack, w, group_window);
             }
 
-          g_slist_free (group_windows);
+          tmp2 = tmp2->next;
         }
-      else if (w->transient_for != NULL)
-        {
-          MetaWindow *parent;
 
-          parent = w->transient_for;
+      g_slist_free (group_windows);
+    }
+  else if (w->transient_for != NULL)
+    {
+      MetaWindow *parent;
 
-          if (parent && meta_window_is_in_stack (parent))
-            {
-              meta_topic (META_DEBUG_STACK, "Constraining %s above %s due to transiency\n",
-                          w->desc, parent->desc);
-              add_constraint (constraints, w, parent);
-            }
+      parent = w->transient_for;
+
+      if (parent && meta_window_is_in_stack (parent))
+        {
+          meta_topic (META_DEBUG_STACK, "Constraining %s above %s due to transiency\n",
+                      w->desc, parent->desc);
+          add_constraint (stack, w, parent);
         }
+    }
+}
 
-      tmp = tmp->next;
+static void
+create_constraints (MetaStack *stack)
+{
+  GSequenceIter *iter;
+
+  for (iter = g_sequence_get_begin_iter (stack->sorted);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
+    {
+      MetaWindow *w = g_sequence_get (iter);
+
+      w->stack_constrained = FALSE;
     }
+
+  for (iter = g_sequence_get_begin_iter (stack->sorted);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
+    create_window_constraints (stack, g_sequence_get (iter));
 }
 
 static void
-graph_constraints (Constraint **constraints,
-                   int          n_constraints)
+graph_constraints (MetaStack *stack)
 {
-  int i;
+  guint i;
 
   i = 0;
-  while (i < n_constraints)
+  while (i < stack->constraints->len)
     {
       Constraint *c;
 
-      /* If we have "A below B" and "B below C" then AB -> BC so we
-       * add BC to next_nodes in AB.
+      /* If we have "A below B" and "B below C" then AB -> BC so the
+       * list of constraints where B is below are the next_nodes of AB.
        */
 
-      c = constraints[i];
+      c = g_ptr_array_index (stack->constraints, i);
       while (c != NULL)
         {
           Constraint *n;
 
-          g_assert (c->below->stack_position == i);
+          g_assert (meta_window_get_stack_position (c->below) == (int) i);
 
           /* Constraints where ->above is below are our
            * next_nodes and we are their previous
            */
-          n = constraints[c->above->stack_position];
+          n = g_ptr_array_index (stack->constraints,
+                                 meta_window_get_stack_position (c->above));
+          c->next_nodes = n;
           while (n != NULL)
             {
-              c->next_nodes = g_slist_prepend (c->next_nodes,
-                                               n);
               /* c is a previous node of n */
               n->has_prev = TRUE;
 
@@ -691,30 +755,11 @@ graph_constraints (Constraint **constraints,
 }
 
 static void
-free_constraints (Constraint **constraints,
-                  int          n_constraints)
+free_constraints (MetaStack *stack)
 {
-  int i;
-
-  i = 0;
-  while (i < n_constraints)
-    {
-      Constraint *c;
-
-      c = constraints[i];
-      while (c != NULL)
-        {
-          Constraint *next = c->next;
-
-          g_slist_free (c->next_nodes);
-
-          g_free (c);
-
-          c = next;
-        }
-
-      ++i;
-    }
+  /* The nodes stay in the pool for the next pass */
+  stack->n_pooled_constraints_used = 0;
+  g_ptr_array_set_size (stack->constraints, 0);
 }
 
 static void
@@ -722,6 +767,7 @@ ensure_above (MetaWindow *above,
               MetaWindow *below)
 {
   gboolean is_transient;
+  int below_position;
 
   is_transient = meta_window_has_transient_type (above) ||
                  above->transient_for == below;
@@ -731,78 +777,172 @@ ensure_above (MetaWindow *above,
 		  "Promoting window %s from layer %u to %u due to contraint\n",
 		  above->desc, above->layer, below->layer);
       above->layer = below->layer;
+      stack_queue_resort (above->display->stack, NULL);
     }
 
-  if (above->stack_position < below->stack_position)
+  below_position = meta_window_get_stack_position (below);
+  if (meta_window_get_stack_position (above) < below_position)
     {
       /* move above to below->stack_position bumping below down the stack */
-      meta_window_set_stack_position_no_sync (above, below->stack_position);
-      g_assert (below->stack_position + 1 == above->stack_position);
+      meta_window_set_stack_position_no_sync (above, below_position);
+      g_assert (meta_window_get_stack_position (below) + 1 ==
+                meta_window_get_stack_position (above));
     }
   meta_topic (META_DEBUG_STACK, "%s above at %d > %s below at %d\n",
-              above->desc, above->stack_position,
-              below->desc, below->stack_position);
+              above->desc, meta_window_get_stack_position (above),
+              below->desc, meta_window_get_stack_position (below));
 }
 
+static void traverse_constraints_reversed (Constraint *c);
+
 static void
 traverse_constraint (Constraint *c)
 {
-  GSList *tmp;
-
   if (c->applied)
     return;
 
   ensure_above (c->above, c->below);
   c->applied = TRUE;
 
-  tmp = c->next_nodes;
-  while (tmp != NULL)
-    {
-      traverse_constraint (tmp->data);
+  traverse_constraints_reversed (c->next_nodes);
+}
 
-      tmp = tmp->next;
-    }
+/* Traverses a list of constraints from its last node to its first */
+static void
+traverse_constraints_reversed (Constraint *c)
+{
+  if (c == NULL)
+    return;
+
+  traverse_constraints_reversed (c->next);
+  traverse_constraint (c);
 }
 
 static void
-apply_constraints (Constraint **constraints,
-                   int          n_constraints)
+traverse_heads_reversed (Constraint *c)
+{
+  if (c == NULL)
+    return;
+
+  traverse_heads_reversed (c->next);
+  if (!c->has_prev)
+    traverse_constraint (c);
+}
+
+static void
+apply_constraints (MetaStack *stack)
 {
-  GSList *heads;
-  GSList *tmp;
   int i;
 
-  /* List all heads in an ordered constraint chain */
-  heads = NULL;
-  i = 0;
-  while (i < n_constraints)
-    {
-      Constraint *c;
+  /* Traverse the chain from all heads in an ordered constraint chain
+   * and apply constraints, starting with the heads at the highest
+   * positions.
+   */
+  for (i = (int) stack->constraints->len - 1; i >= 0; i--)
+    traverse_heads_reversed (g_ptr_array_index (stack->constraints, i));
+}
 
-      c = constraints[i];
-      while (c != NULL)
-        {
-          if (!c->has_prev)
-            heads = g_slist_prepend (heads, c);
+static void
+stack_queue_resort (MetaStack  *stack,
+                    MetaWindow *moved_window)
+{
+  /* Only keep track of the moved window if it is the only reason for
+   * resorting; anything else needs a full sort
+   */
+  if (moved_window == NULL ||
+      (stack->need_resort && stack->resort_window != moved_window))
+    stack->resort_window = NULL;
+  else
+    stack->resort_window = moved_window;
 
-          c = c->next;
-        }
+  stack->need_resort = TRUE;
+}
 
-      ++i;
+static void
+stack_queue_constrain (MetaStack  *stack,
+                       MetaWindow *moved_window)
+{
+  if (moved_window == NULL ||
+      (stack->need_constrain && stack->constrain_window != moved_window))
+    stack->constrain_window = NULL;
+  else
+    stack->constrain_window = moved_window;
+
+  stack->need_constrain = TRUE;
+}
+
+static MetaWindow *
+get_transient_root (MetaWindow *window)
+{
+  while (window->transient_for != NULL)
+    window = window->transient_for;
+
+  return window;
+}
+
+/*
+ * Collects the windows sharing a transient root ancestor with @window, which
+ * are the only windows that can have constraints with it, into
+ * stack->transient_family. Returns %FALSE if any of them is constrained by a
+ * window that is transient for its whole group, as those constraints reach
+ * across transient families.
+ */
+static gboolean
+collect_transient_family (MetaStack  *stack,
+                          MetaWindow *window)
+{
+  GPtrArray *family = stack->transient_family;
+  MetaWindow *root;
+  gboolean has_group_transients = FALSE;
+  GSequenceIter *iter;
+  guint i;
+
+  g_ptr_array_set_size (family, 0);
+
+  root = get_transient_root (window);
+
+  for (iter = g_sequence_get_begin_iter (stack->sorted);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
+    {
+      MetaWindow *w = g_sequence_get (iter);
+
+      if (WINDOW_TRANSIENT_FOR_WHOLE_GROUP (w))
+        has_group_transients = TRUE;
+
+      if (get_transient_root (w) == root)
+        g_ptr_array_add (family, w);
     }
 
-  /* Now traverse the chain and apply constraints */
-  tmp = heads;
-  while (tmp != NULL)
+  if (!has_group_transients)
+    return TRUE;
+
+  for (iter = g_sequence_get_begin_iter (stack->sorted);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
     {
-      Constraint *c = tmp->data;
+      MetaWindow *w = g_sequence_get (iter);
+      MetaGroup *group;
+
+      if (!WINDOW_TRANSIENT_FOR_WHOLE_GROUP (w))
+        continue;
 
-      traverse_constraint (c);
+      group = meta_window_get_group (w);
 
-      tmp = tmp->next;
+      for (i = 0; i < family->len; i++)
+        {
+          MetaWindow *family_window = g_ptr_array_index (family, i);
+
+          if (family_window == w ||
+              (group != NULL && meta_window_get_group (family_window) == group))
+            {
+              g_ptr_array_set_size (family, 0);
+              return FALSE;
+            }
+        }
     }
 
-  g_slist_free (heads);
+  return TRUE;
 }
 
 /**
@@ -813,7 +953,7 @@ apply_constraints (Constraint **constraints,
 static void
 stack_do_relayer (MetaStack *stack)
 {
-  GList *tmp;
+  GSequenceIter *iter;
 
   if (!stack->need_relayer)
     return;
@@ -821,14 +961,14 @@ stack_do_relayer (MetaStack *stack)
   meta_topic (META_DEBUG_STACK,
               "Recomputing layers\n");
 
-  tmp = stack->sorted;
-
-  while (tmp != NULL)
+  for (iter = g_sequence_get_begin_iter (stack->sorted);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
     {
       MetaWindow *w;
       MetaStackLayer old_layer;
 
-      w = tmp->data;
+      w = g_sequence_get (iter);
       old_layer = w->layer;
 
       w->layer = meta_window_calculate_layer (w);
@@ -838,15 +978,13 @@ stack_do_relayer (MetaStack *stack)
           meta_topic (META_DEBUG_STACK,
                       "Window %s moved from layer %u to %u\n",
                       w->desc, old_layer, w->layer);
-          stack->need_resort = TRUE;
-          stack->need_constrain = TRUE;
+          stack_queue_resort (stack, NULL);
+          stack_queue_constrain (stack, NULL);
           /* don't need to constrain as constraining
            * purely operates in terms of stack_position
            * not layer
            */
         }
-
-      tmp = tmp->next;
     }
 
   stack->need_relayer = FALSE;
@@ -861,28 +999,76 @@ stack_do_relayer (MetaStack *stack)
 static void
 stack_do_constrain (MetaStack *stack)
 {
-  Constraint **constraints;
-
-  /* It'd be nice if this were all faster, probably */
+  gboolean family_only = FALSE;
+  guint i;
 
   if (!stack->need_constrain)
     return;
 
-  meta_topic (META_DEBUG_STACK,
-              "Reapplying constraints\n");
+  /* If a single window moved since the constraints were last applied,
+   * the windows outside of its transient family kept their relative
+   * order, so only the constraints within the family can be broken.
+   * Any change of transiency queues a full pass, so a window without
+   * constraints then still has none.
+   */
+  if (stack->constrain_window != NULL &&
+      !stack->constrain_window->stack_constrained)
+    {
+      meta_topic (META_DEBUG_STACK,
+                  "Window %s has no constraints, not reapplying "
+                  "constraints\n", stack->constrain_window->desc);
+      stack->constrain_window = NULL;
+      stack->need_constrain = FALSE;
+      return;
+    }
 
-  constraints = g_new0 (Constraint*,
-                        stack->n_positions);
+  if (stack->constrain_window != NULL &&
+      collect_transient_family (stack, stack->constrain_window))
+    {
+      if (stack->transient_family->len <= 1)
+        {
+          meta_topic (META_DEBUG_STACK,
+                      "Window %s has no transient family, not reapplying "
+                      "constraints\n", stack->constrain_window->desc);
+          g_ptr_array_set_size (stack->transient_family, 0);
+          stack->constrain_window = NULL;
+          stack->need_constrain = FALSE;
+          return;
+        }
+
+      meta_topic (META_DEBUG_STACK,
+                  "Reapplying constraints for the transient family of %s\n",
+                  stack->constrain_window->desc);
+      family_only = TRUE;
+    }
+  else
+    {
+      meta_topic (META_DEBUG_STACK,
+                  "Reapplying constraints\n");
+    }
+
+  /* Growing the array clears the new elements */
+  g_ptr_array_set_size (stack->constraints, stack->n_positions);
 
-  create_constraints (constraints, stack->sorted);
+  if (family_only)
+    {
+      for (i = 0; i < stack->transient_family->len; i++)
+        create_window_constraints (stack,
+                                   g_ptr_array_index (stack->transient_family, i));
+      g_ptr_array_set_size (stack->transient_family, 0);
+    }
+  else
+    {
+      create_constraints (stack);
+    }
 
-  graph_constraints (constraints, stack->n_positions);
+  graph_constraints (stack);
 
-  apply_constraints (constraints, stack->n_positions);
+  apply_constraints (stack);
 
-  free_constraints (constraints, stack->n_positions);
-  g_free (constraints);
+  free_constraints (stack);
 
+  stack->constrain_window = NULL;
   stack->need_constrain = FALSE;
 }
 
@@ -897,14 +1083,31 @@ stack_do_resort (MetaStack *stack)
   if (!stack->need_resort)
     return;
 
-  meta_topic (META_DEBUG_STACK,
-              "Sorting stack list\n");
+  if (stack->resort_window != NULL)
+    {
+      MetaWindow *window = stack->resort_window;
 
-  stack->sorted = g_list_sort (stack->sorted,
-                               (GCompareFunc) compare_window_position);
+      meta_topic (META_DEBUG_STACK,
+                  "Moving %s to its place in the stack list\n",
+                  window->desc);
+
+      /* The rest of the list is still sorted, so just move the window
+       * to its place with a binary search.
+       */
+      g_sequence_sort_changed (window->stack_sorted_iter,
+                               compare_window_position, NULL);
+    }
+  else
+    {
+      meta_topic (META_DEBUG_STACK,
+                  "Sorting stack list\n");
+
+      g_sequence_sort (stack->sorted, compare_window_position, NULL);
+    }
 
   meta_display_queue_check_fullscreen (stack->display);
 
+  stack->resort_window = NULL;
   stack->need_resort = FALSE;
 }
 
@@ -930,10 +1133,13 @@ stack_ensure_sorted (MetaStack *stack)
 MetaWindow *
 meta_stack_get_top (MetaStack *stack)
 {
+  GSequenceIter *iter;
+
   stack_ensure_sorted (stack);
 
-  if (stack->sorted)
-    return stack->sorted->data;
+  iter = g_sequence_get_begin_iter (stack->sorted);
+  if (!g_sequence_iter_is_end (iter))
+    return g_sequence_get (iter);
   else
     return NULL;
 }
@@ -941,13 +1147,13 @@ meta_stack_get_top (MetaStack *stack)
 MetaWindow *
 meta_stack_get_bottom (MetaStack  *stack)
 {
-  GList *link;
+  GSequenceIter *iter;
 
   stack_ensure_sorted (stack);
 
-  link = g_list_last (stack->sorted);
-  if (link != NULL)
-    return link->data;
+  iter = g_sequence_get_end_iter (stack->sorted);
+  if (!g_sequence_iter_is_begin (iter))
+    return g_sequence_get (g_sequence_iter_prev (iter));
   else
     return NULL;
 }
@@ -957,18 +1163,18 @@ meta_stack_get_above (MetaStack  *stack,
                       MetaWindow *window,
                       gboolean    only_within_layer)
 {
-  GList *link;
+  GSequenceIter *iter;
   MetaWindow *above;
 
   stack_ensure_sorted (stack);
 
-  link = g_list_find (stack->sorted, window);
-  if (link == NULL)
+  iter = window->stack_sorted_iter;
+  if (iter == NULL)
     return NULL;
-  if (link->prev == NULL)
+  if (g_sequence_iter_is_begin (iter))
     return NULL;
 
-  above = link->prev->data;
+  above = g_sequence_get (g_sequence_iter_prev (iter));
 
   if (only_within_layer &&
       above->layer != window->layer)
@@ -982,19 +1188,21 @@ meta_stack_get_below (MetaStack  *stack,
                       MetaWindow *window,
                       gboolean    only_within_layer)
 {
-  GList *link;
+  GSequenceIter *iter;
   MetaWindow *below;
 
   stack_ensure_sorted (stack);
 
-  link = g_list_find (stack->sorted, window);
+  iter = window->stack_sorted_iter;
 
-  if (link == NULL)
+  if (iter == NULL)
     return NULL;
-  if (link->next == NULL)
+
+  iter = g_sequence_iter_next (iter);
+  if (g_sequence_iter_is_end (iter))
     return NULL;
 
-  below = link->next->data;
+  below = g_sequence_get (iter);
 
   if (only_within_layer &&
       below->layer != window->layer)
@@ -1048,14 +1256,16 @@ get_default_focus_window (MetaStack     *stack,
    * not_this_one is being unfocused or going away, so exclude it.
    */
 
-  GList *l;
+  GSequenceIter *iter;
 
   stack_ensure_sorted (stack);
 
   /* top of this layer is at the front of the list */
-  for (l = stack->sorted; l != NULL; l = l->next)
+  for (iter = g_sequence_get_begin_iter (stack->sorted);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
     {
-      MetaWindow *window = l->data;
+      MetaWindow *window = g_sequence_get (iter);
 
       if (!window)
         continue;
@@ -1100,15 +1310,15 @@ meta_stack_list_windows (MetaStack     *stack,
                          MetaWorkspace *workspace)
 {
   GList *workspace_windows = NULL;
-  GList *link;
+  GSequenceIter *iter;
 
   stack_ensure_sorted (stack); /* do adds/removes */
 
-  link = stack->sorted;
-
-  while (link)
+  for (iter = g_sequence_get_begin_iter (stack->sorted);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
     {
-      MetaWindow *window = link->data;
+      MetaWindow *window = g_sequence_get (iter);
 
       if (window &&
           (workspace == NULL || meta_window_located_on_workspace (window, workspace)))
@@ -1116,8 +1326,6 @@ meta_stack_list_windows (MetaStack     *stack,
           workspace_windows = g_list_prepend (workspace_windows,
                                               window);
         }
-
-      link = link->next;
     }
 
   return workspace_windows;
@@ -1156,39 +1364,26 @@ meta_stack_windows_cmp (MetaStack  *stack,
     return -1;
   else if (window_a->layer > window_b->layer)
     return 1;
-  else if (window_a->stack_position < window_b->stack_position)
-    return -1;
-  else if (window_a->stack_position > window_b->stack_position)
-    return 1;
-  else
-    return 0; /* not reached */
-}
-
-static int
-compare_just_window_stack_position (void *a,
-                                    void *b)
-{
-  MetaWindow *window_a = a;
-  MetaWindow *window_b = b;
-
-  if (window_a->stack_position < window_b->stack_position)
-    return -1; /* move window_a earlier in list */
-  else if (window_a->stack_position > window_b->stack_position)
-    return 1;
   else
-    return 0; /* not reached */
+    return g_sequence_iter_compare (window_a->stack_position_iter,
+                                    window_b->stack_position_iter);
 }
 
 GList *
 meta_stack_get_positions (MetaStack *stack)
 {
-  GList *tmp;
+  GList *tmp = NULL;
+  GSequenceIter *iter;
 
   /* Make sure to handle any adds or removes */
   stack_ensure_sorted (stack);
 
-  tmp = g_list_copy (stack->sorted);
-  tmp = g_list_sort (tmp, (GCompareFunc) compare_just_window_stack_position);
+  iter = g_sequence_get_end_iter (stack->positions);
+  while (!g_sequence_iter_is_begin (iter))
+    {
+      iter = g_sequence_iter_prev (iter);
+      tmp = g_list_prepend (tmp, g_sequence_get (iter));
+    }
 
   return tmp;
 }
@@ -1234,32 +1429,34 @@ void
 meta_stack_set_positions (MetaStack *stack,
                           GList     *windows)
 {
-  int i;
+  GList *current;
   GList *tmp;
+  gboolean same_windows;
 
   /* Make sure any adds or removes aren't in limbo -- is this needed? */
   stack_ensure_sorted (stack);
 
-  if (!lists_contain_same_windows (windows, stack->sorted))
+  current = meta_stack_list_windows (stack, NULL);
+  same_windows = lists_contain_same_windows (windows, current);
+  g_list_free (current);
+
+  if (!same_windows)
     {
       meta_warning ("This list of windows has somehow changed; not resetting "
                     "positions of the windows.\n");
       return;
     }
 
-  g_list_free (stack->sorted);
-  stack->sorted = g_list_copy (windows);
-
-  stack->need_resort = TRUE;
-  stack->need_constrain = TRUE;
+  stack_queue_resort (stack, NULL);
+  stack_queue_constrain (stack, NULL);
 
-  i = 0;
-  tmp = windows;
-  while (tmp != NULL)
+  /* Moving each window to the top in turn leaves them in list order */
+  for (tmp = windows; tmp != NULL; tmp = tmp->next)
     {
       MetaWindow *w = tmp->data;
-      w->stack_position = i++;
-      tmp = tmp->next;
+
+      g_sequence_move (w->stack_position_iter,
+                       g_sequence_get_end_iter (stack->positions));
     }
 
   meta_topic (META_DEBUG_STACK,
@@ -1273,54 +1470,40 @@ void
 meta_window_set_stack_position_no_sync (MetaWindow *window,
                                         int         position)
 {
-  int low, high, delta;
-  GList *tmp;
+  MetaStack *stack = window->display->stack;
+  int current_position;
+  GSequenceIter *dest;
 
-  g_return_if_fail (window->display->stack != NULL);
-  g_return_if_fail (window->stack_position >= 0);
+  g_return_if_fail (stack != NULL);
+  g_return_if_fail (meta_window_is_in_stack (window));
   g_return_if_fail (position >= 0);
-  g_return_if_fail (position < window->display->stack->n_positions);
+  g_return_if_fail (position < stack->n_positions);
 
-  if (position == window->stack_position)
+  current_position = meta_window_get_stack_position (window);
+  if (position == current_position)
     {
       meta_topic (META_DEBUG_STACK, "Window %s already has position %d\n",
                   window->desc, position);
       return;
     }
 
-  window->display->stack->need_resort = TRUE;
-  window->display->stack->need_constrain = TRUE;
+  stack_queue_resort (stack, window);
+  stack_queue_constrain (stack, window);
 
-  if (position < window->stack_position)
-    {
-      low = position;
-      high = window->stack_position - 1;
-      delta = 1;
-    }
+  /* The windows in between shift by one as the window is moved in front
+   * of the window at the destination, after it is taken out of its own
+   * place.
+   */
+  if (position < current_position)
+    dest = g_sequence_get_iter_at_pos (stack->positions, position);
   else
-    {
-      low = window->stack_position + 1;
-      high = position;
-      delta = -1;
-    }
-
-  tmp = window->display->stack->sorted;
-  while (tmp != NULL)
-    {
-      MetaWindow *w = tmp->data;
-
-      if (w->stack_position >= low &&
-          w->stack_position <= high)
-        w->stack_position += delta;
-
-      tmp = tmp->next;
-    }
+    dest = g_sequence_get_iter_at_pos (stack->positions, position + 1);
 
-  window->stack_position = position;
+  g_sequence_move (window->stack_position_iter, dest);
 
   meta_topic (META_DEBUG_STACK,
               "Window %s had stack_position set to %d\n",
-              window->desc, window->stack_position);
+              window->desc, position);
 }
 
 void
@@ -1334,3 +1517,12 @@ meta_window_set_stack_position (MetaWindow *window,
   meta_stack_update_window_tile_matches (window->display->stack,
                                          workspace_manager->active_workspace);
 }
+
+int
+meta_window_get_stack_position (MetaWindow *window)
+{
+  if (window->stack_position_iter == NULL)
+    return -1;
+
+  return g_sequence_iter_get_position (window->stack_position_iter);
+}
@@ -27,7 +27,7 @@
  *
  * There are two factors that determine window position.
  *
- * One is window->stack_position, which is a unique integer
+ * One is the window's stack position, which is a unique integer
  * indicating how windows are ordered with respect to one
  * another. The ordering here transcends layers; it isn't changed
  * as the window is moved among layers. This allows us to move several
@@ -56,8 +56,19 @@ struct _MetaStack
   /** The MetaDisplay containing this stack. */
   MetaDisplay *display;
 
-  /** The MetaWindows of the windows we manage, sorted in order. */
-  GList *sorted;
+  /**
+   * The MetaWindows of the windows we manage, sorted in order, top window
+   * first. Each window keeps its iter in stack_sorted_iter.
+   */
+  GSequence *sorted;
+
+  /**
+   * The same windows, ordered by stack position regardless of layer, bottom
+   * window first. Stack positions are the indices in this sequence, so
+   * moving a window doesn't need to renumber the others. Each window keeps
+   * its iter in stack_position_iter.
+   */
+  GSequence *positions;
 
   /**
    * If this is zero, the local stack oughtn't to be brought up to date with
@@ -76,11 +87,44 @@ struct _MetaStack
   GArray *last_all_root_children_stacked;
 
   /**
-   * Number of stack positions; same as the length of added, but
+   * Number of stack positions; same as the length of positions, but
    * kept for quick reference.
    */
   gint n_positions;
 
+  /**
+   * If set, the only window that changed stack position since the stack was
+   * last sorted. The other windows kept their relative order, so only this
+   * window needs to be moved to its place in the sorted list.
+   */
+  MetaWindow *resort_window;
+
+  /**
+   * If set, the only window that changed stack position since the
+   * constraints were last applied. Only the constraints within its
+   * transient family need to be applied again.
+   */
+  MetaWindow *constrain_window;
+
+  /**
+   * Scratch array holding the transient family of constrain_window while
+   * constraints are reapplied; kept around to avoid reallocating it.
+   */
+  GPtrArray *transient_family;
+
+  /**
+   * The constraints being applied, indexed by the stack position of their
+   * lower window; kept around to avoid reallocating it.
+   */
+  GPtrArray *constraints;
+
+  /**
+   * Constraint nodes allocated so far, reused by every constraint pass.
+   * The first n_pooled_constraints_used are in use by the current pass.
+   */
+  GPtrArray *constraint_pool;
+  guint n_pooled_constraints_used;
+
   /** Is the stack in need of re-sorting? */
   unsigned int need_resort : 1;
 
@@ -375,6 +419,17 @@ int meta_stack_windows_cmp (MetaStack  *stack,
 void meta_window_set_stack_position (MetaWindow *window,
                                      int         position);
 
+/**
+ * meta_window_get_stack_position:
+ * @window: A window
+ *
+ * Looks up the position of a window within the stack, regardless of its
+ * layer (0 is the bottom).
+ *
+ * \return The stack position of @window, or -1 if it isn't in the stack.
+ */
+int meta_window_get_stack_position (MetaWindow *window);
+
 /**
  * meta_stack_get_positions:
  * @stack: The stack to examine.
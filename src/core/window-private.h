@@ -516,7 +516,11 @@ struct _MetaWindow
 
   /* Managed by stack.c */
   MetaStackLayer layer;
-  int stack_position; /* see comment in stack.h */
+  GSequenceIter *stack_position_iter; /* see comment in stack.h */
+  GSequenceIter *stack_sorted_iter;
+  /* Whether the window had a stacking constraint when they were last
+   * created */
+  guint stack_constrained : 1;
 
   /* Managed by delete.c */
   MetaCloseDialog *close_dialog;
@@ -1159,7 +1159,8 @@ _meta_window_shared_new (MetaDisplay         *display,
   window->struts = NULL;
 
   window->layer = META_LAYER_LAST; /* invalid value */
-  window->stack_position = -1;
+  window->stack_position_iter = NULL;
+  window->stack_sorted_iter = NULL;
   window->initial_workspace = 0; /* not used */
   window->initial_timestamp = 0; /* not used */
 
@@ -1770,6 +1771,8 @@ implement_showing (MetaWindow *window,
   else
     meta_window_show (window);
 
+  meta_display_invalidate_window_edges (window->display, window);
+
   if (!window->override_redirect)
     sync_client_window_mapped (window);
 }
@@ -4114,6 +4117,9 @@ meta_window_move_resize_internal (MetaWindow          *window,
   if (moved_or_resized || did_placement)
     window->unconstrained_rect = unconstrained_rect;
 
+  if (moved_or_resized)
+    meta_display_invalidate_window_edges (window->display, window);
+
   if ((moved_or_resized ||
        did_placement ||
        (result & META_MOVE_RESIZE_RESULT_STATE_CHANGED) != 0) &&
@@ -7011,24 +7017,29 @@ ensure_mru_position_after (MetaWindow *window,
 gboolean
 meta_window_is_in_stack (MetaWindow *window)
 {
-  return window->stack_position >= 0;
+  return window->stack_position_iter != NULL;
 }
 
 void
 meta_window_stack_just_below (MetaWindow *window,
                               MetaWindow *below_this_one)
 {
+  int position, below_position;
+
   g_return_if_fail (window         != NULL);
   g_return_if_fail (below_this_one != NULL);
 
-  if (window->stack_position > below_this_one->stack_position)
+  position = meta_window_get_stack_position (window);
+  below_position = meta_window_get_stack_position (below_this_one);
+
+  if (position > below_position)
     {
       meta_topic (META_DEBUG_STACK,
                   "Setting stack position of window %s to %d (making it below window %s).\n",
                   window->desc,
-                  below_this_one->stack_position,
+                  below_position,
                   below_this_one->desc);
-      meta_window_set_stack_position (window, below_this_one->stack_position);
+      meta_window_set_stack_position (window, below_position);
     }
   else
     {
@@ -7042,17 +7053,22 @@ void
 meta_window_stack_just_above (MetaWindow *window,
                               MetaWindow *above_this_one)
 {
+  int position, above_position;
+
   g_return_if_fail (window         != NULL);
   g_return_if_fail (above_this_one != NULL);
 
-  if (window->stack_position < above_this_one->stack_position)
+  position = meta_window_get_stack_position (window);
+  above_position = meta_window_get_stack_position (above_this_one);
+
+  if (position < above_position)
     {
       meta_topic (META_DEBUG_STACK,
                   "Setting stack position of window %s to %d (making it above window %s).\n",
                   window->desc,
-                  above_this_one->stack_position,
+                  above_position,
                   above_this_one->desc);
-      meta_window_set_stack_position (window, above_this_one->stack_position);
+      meta_window_set_stack_position (window, above_position);
     }
   else
     {
@@ -7152,7 +7168,7 @@ meta_window_set_demands_attention (MetaWindow *window)
 {
   MetaWorkspaceManager *workspace_manager = window->display->workspace_manager;
   MetaRectangle candidate_rect, other_rect;
-  GList *stack = window->display->stack->sorted;
+  MetaStack *stack = window->display->stack;
   MetaWindow *other_window;
   gboolean obscured = FALSE;
 
@@ -7174,13 +7190,10 @@ meta_window_set_demands_attention (MetaWindow *window)
     {
       meta_window_get_frame_rect (window, &candidate_rect);
 
-      /* The stack is sorted with the top windows first. */
-
-      while (stack != NULL && stack->data != window)
+      for (other_window = meta_stack_get_above (stack, window, FALSE);
+           other_window != NULL;
+           other_window = meta_stack_get_above (stack, other_window, FALSE))
         {
-          other_window = stack->data;
-          stack = stack->next;
-
           if (meta_window_located_on_workspace (other_window, workspace))
             {
               meta_window_get_frame_rect (other_window, &other_rect);
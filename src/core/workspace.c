@@ -42,6 +42,7 @@
 #include "backends/meta-logical-monitor.h"
 #include "cogl/cogl.h"
 #include "core/boxes-private.h"
+#include "core/constraints.h"
 #include "core/meta-workspace-manager-private.h"
 #include "core/workspace-private.h"
 #include "meta/compositor.h"
@@ -537,9 +538,10 @@ meta_workspace_activate_with_focus (MetaWorkspace *workspace,
       return;
     }
 
-  /* Free any cached pointers to the workspaces's edges from
+  /* Free any cached pointers to the workspaces's edges and regions from
    * a current resize or move operation */
   meta_display_cleanup_edges (workspace->display);
+  meta_display_cleanup_constraint_cache (workspace->display);
 
   if (workspace->manager->active_workspace)
     workspace_switch_sound (workspace->manager->active_workspace, workspace);
@@ -730,6 +732,10 @@ meta_workspace_invalidate_work_area (MetaWorkspace *workspace)
 {
   GList *windows, *l;
 
+  /* The window being moved or resized might be on this workspace even if
+   * it isn't the active one, so its work area could be changing */
+  meta_display_cleanup_constraint_cache (workspace->display);
+
   if (workspace->work_areas_invalid)
     {
       meta_topic (META_DEBUG_WORKAREA,
@@ -991,6 +991,102 @@ verify_edge_lists_are_equal (GList *code, GList *answer)
     }
 }
 
+static void
+get_benchmark_setup (GList  **monitors,
+                     GSList **struts)
+{
+  int i;
+
+  *monitors = NULL;
+  *struts = NULL;
+
+  /* 8 monitors in two rows of four, with 5 panels, docks and sidebars on
+   * each, most of them partial
+   */
+  for (i = 0; i < 8; i++)
+    {
+      int x = (i % 4) * 1920;
+      int y = (i / 4) * 1080;
+
+      *monitors = g_list_prepend (*monitors,
+                                  new_meta_rect (x, y, 1920, 1080));
+
+      *struts = g_slist_prepend (*struts,
+                                 new_meta_strut (x, y, 1920, 32,
+                                                 META_SIDE_TOP));
+      *struts = g_slist_prepend (*struts,
+                                 new_meta_strut (x + 480 + (i * 37) % 200,
+                                                 y + 1016, 960, 64,
+                                                 META_SIDE_BOTTOM));
+      *struts = g_slist_prepend (*struts,
+                                 new_meta_strut (x + 1620, y + 1056, 300, 24,
+                                                 META_SIDE_BOTTOM));
+      *struts = g_slist_prepend (*struts,
+                                 new_meta_strut (x, y + 200 + (i * 53) % 300,
+                                                 48, 400,
+                                                 META_SIDE_LEFT));
+      *struts = g_slist_prepend (*struts,
+                                 new_meta_strut (x + 1872,
+                                                 y + 100 + (i * 71) % 300,
+                                                 48, 600,
+                                                 META_SIDE_RIGHT));
+    }
+}
+
+static void
+test_regions_benchmark (void)
+{
+  MetaRectangle screen_rect;
+  GList *monitors;
+  GSList *struts;
+  int i;
+
+  screen_rect = meta_rect (0, 0, 4 * 1920, 2 * 1080);
+  get_benchmark_setup (&monitors, &struts);
+
+  /* Do what updating the work areas of a workspace does */
+  g_test_timer_start ();
+  for (i = 0; i < 1000; i++)
+    {
+      GList *l;
+      GList *region;
+      GList *edges;
+
+      for (l = monitors; l; l = l->next)
+        {
+          MetaRectangle *monitor_rect = l->data;
+          GList *m;
+
+          region = meta_rectangle_get_minimal_spanning_set_for_region (monitor_rect,
+                                                                       struts);
+          g_assert_nonnull (region);
+          for (m = region; m; m = m->next)
+            g_assert (meta_rectangle_contains_rect (monitor_rect, m->data));
+          meta_rectangle_free_list_and_elements (region);
+        }
+
+      region = meta_rectangle_get_minimal_spanning_set_for_region (&screen_rect,
+                                                                   struts);
+      g_assert_nonnull (region);
+      meta_rectangle_free_list_and_elements (region);
+
+      edges = meta_rectangle_find_onscreen_edges (&screen_rect, struts);
+      meta_rectangle_free_list_and_elements (edges);
+
+      edges = meta_rectangle_find_nonintersected_monitor_edges (monitors,
+                                                                struts);
+      meta_rectangle_free_list_and_elements (edges);
+    }
+
+  g_test_minimized_result (g_test_timer_elapsed (),
+                           "Work areas for 8 monitors and 40 struts, "
+                           "1000 times: %.3f s",
+                           g_test_timer_last ());
+
+  free_strut_list (struts);
+  meta_rectangle_free_list_and_elements (monitors);
+}
+
 static void
 test_find_onscreen_edges (void)
 {
@@ -1308,6 +1404,150 @@ test_gravity_resize (void)
   g_assert (meta_rectangle_equal (&rect, &temp));
 }
 
+static int
+compare_edge_pointers (gconstpointer a,
+                       gconstpointer b)
+{
+  return meta_rectangle_edge_cmp_ignore_type (*(MetaEdge **) a,
+                                              *(MetaEdge **) b);
+}
+
+static GArray *
+get_random_vertical_edges (int n_edges)
+{
+  GArray *edges;
+  int i;
+
+  edges = g_array_sized_new (FALSE, FALSE, sizeof (MetaEdge *), n_edges);
+  for (i = 0; i < n_edges; i++)
+    {
+      MetaEdge *edge;
+
+      edge = new_screen_edge (rand () % 1600, rand () % 1200,
+                              0, rand () % 300 + 1,
+                              i % 2 ? META_SIDE_LEFT : META_SIDE_RIGHT);
+      g_array_append_val (edges, edge);
+    }
+
+  g_array_sort (edges, compare_edge_pointers);
+
+  return edges;
+}
+
+static void
+free_edge_array (GArray *edges)
+{
+  guint i;
+
+  for (i = 0; i < edges->len; i++)
+    g_free (g_array_index (edges, MetaEdge *, i));
+  g_array_free (edges, TRUE);
+}
+
+static int
+find_aligned_edge_linearly (GArray              *edges,
+                            int                  from,
+                            int                  to,
+                            const MetaRectangle *rect)
+{
+  int increment = from <= to ? 1 : -1;
+  int i;
+
+  for (i = from; increment > 0 ? i <= to : i >= to; i += increment)
+    {
+      if (meta_rectangle_edge_aligns (rect, g_array_index (edges, MetaEdge *, i)))
+        return i;
+    }
+
+  return -1;
+}
+
+static void
+test_edge_index (void)
+{
+  GArray *edges;
+  MetaEdgeIndex *edge_index;
+  int i;
+
+  edges = get_random_vertical_edges (200);
+  edge_index = meta_edge_index_new (edges);
+
+  for (i = 0; i < NUM_RANDOM_RUNS; i++)
+    {
+      MetaRectangle rect;
+      int from, to;
+
+      get_random_rect (&rect);
+      from = rand () % edges->len;
+      to = rand () % edges->len;
+
+      g_assert_cmpint (meta_edge_index_find_aligned (edge_index, from, to,
+                                                     BOX_TOP (rect),
+                                                     BOX_BOTTOM (rect)),
+                       ==,
+                       find_aligned_edge_linearly (edges, from, to, &rect));
+    }
+
+  meta_edge_index_free (edge_index);
+  free_edge_array (edges);
+
+  /* An empty index never finds anything */
+  edges = g_array_new (FALSE, FALSE, sizeof (MetaEdge *));
+  edge_index = meta_edge_index_new (edges);
+  g_assert_cmpint (meta_edge_index_find_aligned (edge_index, 0, 0, 0, 100), ==, -1);
+  meta_edge_index_free (edge_index);
+  g_array_free (edges, TRUE);
+}
+
+static void
+test_edge_index_benchmark (void)
+{
+  GArray *edges;
+  MetaEdgeIndex *edge_index;
+  GTimer *timer;
+  double linear_time, index_time;
+  int i, n_found = 0;
+
+  /* Roughly the edges of 1000 windows, with small windows so that most
+   * edges don't align with the dragged one */
+  edges = get_random_vertical_edges (2000);
+  timer = g_timer_new ();
+
+  g_timer_start (timer);
+  for (i = 0; i < NUM_RANDOM_RUNS; i++)
+    {
+      MetaRectangle rect = meta_rect (0, i % 1200, 400, 10);
+
+      n_found += find_aligned_edge_linearly (edges, 0, edges->len - 1, &rect) >= 0;
+    }
+  linear_time = g_timer_elapsed (timer, NULL);
+
+  g_timer_start (timer);
+  edge_index = meta_edge_index_new (edges);
+  for (i = 0; i < NUM_RANDOM_RUNS; i++)
+    {
+      MetaRectangle rect = meta_rect (0, i % 1200, 400, 10);
+
+      n_found -= meta_edge_index_find_aligned (edge_index, 0, edges->len - 1,
+                                               BOX_TOP (rect),
+                                               BOX_BOTTOM (rect)) >= 0;
+    }
+  index_time = g_timer_elapsed (timer, NULL);
+
+  g_assert_cmpint (n_found, ==, 0);
+
+  g_test_message ("Finding aligned edges among %u edges, %d times: "
+                  "linear scan %.3f ms, edge index %.3f ms",
+                  edges->len, NUM_RANDOM_RUNS,
+                  linear_time * 1000, index_time * 1000);
+  g_test_minimized_result (index_time, "Edge index: %.3f ms",
+                           index_time * 1000);
+
+  g_timer_destroy (timer);
+  meta_edge_index_free (edge_index);
+  free_edge_array (edges);
+}
+
 #define EPSILON 0.000000001
 static void
 test_find_closest_point_to_line (void)
@@ -1376,11 +1616,17 @@ init_boxes_tests (void)
   g_test_add_func ("/util/boxes/clamp-to-region", test_clamping_to_region);
   g_test_add_func ("/util/boxes/clip-to-region", test_clipping_to_region);
   g_test_add_func ("/util/boxes/shove-into-region", test_shoving_into_region);
+  if (g_test_perf ())
+    g_test_add_func ("/util/boxes/regions-benchmark", test_regions_benchmark);
 
   /* And now the functions dealing with edges more than boxes */
   g_test_add_func ("/util/boxes/onscreen-edges", test_find_onscreen_edges);
   g_test_add_func ("/util/boxes/nonintersected-monitor-edges",
                    test_find_nonintersected_monitor_edges);
+  g_test_add_func ("/util/boxes/edge-index", test_edge_index);
+  if (g_test_perf ())
+    g_test_add_func ("/util/boxes/edge-index-benchmark",
+                     test_edge_index_benchmark);
 
   /* And now the misfit functions that don't quite fit in anywhere else... */
   g_test_add_func ("/util/boxes/gravity-resize", test_gravity_resize);
@@ -88,7 +88,79 @@ actor_margin_layout (void)
   clutter_test_assert_actor_at_point (stage, &p, flower[2]);
 }
 
+static void
+on_queue_relayout (ClutterActor *actor,
+                   gpointer      data)
+{
+  int *n_relayouts = data;
+
+  *n_relayouts += 1;
+}
+
+static void
+actor_boundary_layout (void)
+{
+  ClutterActor *stage = clutter_test_get_stage ();
+  ClutterActor *vase;
+  ClutterActor *flower[2];
+  ClutterActor *petal;
+  graphene_point_t p;
+  int n_relayouts = 0;
+
+  vase = clutter_actor_new ();
+  clutter_actor_set_name (vase, "Vase");
+  clutter_actor_set_layout_manager (vase, clutter_box_layout_new ());
+  clutter_actor_add_child (stage, vase);
+
+  flower[0] = clutter_actor_new ();
+  clutter_actor_set_background_color (flower[0], CLUTTER_COLOR_Red);
+  clutter_actor_set_size (flower[0], 100, 100);
+  clutter_actor_set_name (flower[0], "Red Flower");
+  clutter_actor_add_child (vase, flower[0]);
+
+  petal = clutter_actor_new ();
+  clutter_actor_set_background_color (petal, CLUTTER_COLOR_Blue);
+  clutter_actor_set_name (petal, "Blue Petal");
+  clutter_actor_add_child (flower[0], petal);
+
+  flower[1] = clutter_actor_new ();
+  clutter_actor_set_background_color (flower[1], CLUTTER_COLOR_Yellow);
+  clutter_actor_set_size (flower[1], 100, 100);
+  clutter_actor_set_name (flower[1], "Yellow Flower");
+  clutter_actor_add_child (vase, flower[1]);
+
+  graphene_point_init (&p, 150, 50);
+  clutter_test_assert_actor_at_point (stage, &p, flower[1]);
+
+  g_signal_connect (vase, "queue-relayout",
+                    G_CALLBACK (on_queue_relayout),
+                    &n_relayouts);
+
+  /* a fixed size actor does not need its parent to be laid out again
+   * when one of its children changes size
+   */
+  clutter_actor_set_size (petal, 50, 50);
+  g_assert_cmpint (n_relayouts, ==, 0);
+
+  graphene_point_init (&p, 25, 25);
+  clutter_test_assert_actor_at_point (stage, &p, petal);
+
+  graphene_point_init (&p, 150, 50);
+  clutter_test_assert_actor_at_point (stage, &p, flower[1]);
+
+  /* but it does when something the parent depends on changes */
+  clutter_actor_set_margin_right (flower[0], 10);
+  g_assert_cmpint (n_relayouts, >, 0);
+
+  graphene_point_init (&p, 105, 50);
+  clutter_test_assert_actor_at_point (stage, &p, vase);
+
+  graphene_point_init (&p, 115, 50);
+  clutter_test_assert_actor_at_point (stage, &p, flower[1]);
+}
+
 CLUTTER_TEST_SUITE (
   CLUTTER_TEST_UNIT ("/actor/layout/basic", actor_basic_layout)
   CLUTTER_TEST_UNIT ("/actor/layout/margin", actor_margin_layout)
+  CLUTTER_TEST_UNIT ("/actor/layout/boundary", actor_boundary_layout)
 )
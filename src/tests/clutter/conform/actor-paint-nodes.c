@@ -0,0 +1,137 @@
+#include <clutter/clutter.h>
+
+#include "tests/clutter-test-utils.h"
+
+typedef struct _FooActor      FooActor;
+typedef struct _FooActorClass FooActorClass;
+
+struct _FooActorClass
+{
+  ClutterActorClass parent_class;
+};
+
+struct _FooActor
+{
+  ClutterActor parent;
+
+  int paint_node_count;
+};
+
+GType foo_actor_get_type (void) G_GNUC_CONST;
+
+G_DEFINE_TYPE (FooActor, foo_actor, CLUTTER_TYPE_ACTOR);
+
+static void
+foo_actor_paint_node (ClutterActor     *actor,
+                      ClutterPaintNode *root)
+{
+  FooActor *foo_actor = (FooActor *) actor;
+  ClutterColor color = { 255, 0, 0, 255 };
+  ClutterPaintNode *node;
+  ClutterActorBox box;
+
+  foo_actor->paint_node_count++;
+
+  clutter_actor_get_allocation_box (actor, &box);
+  clutter_actor_box_set_origin (&box, 0, 0);
+
+  node = clutter_color_node_new (&color);
+  clutter_paint_node_add_rectangle (node, &box);
+  clutter_paint_node_add_child (root, node);
+  clutter_paint_node_unref (node);
+}
+
+static void
+foo_actor_class_init (FooActorClass *klass)
+{
+  ClutterActorClass *actor_class = (ClutterActorClass *) klass;
+
+  actor_class->paint_node = foo_actor_paint_node;
+}
+
+static void
+foo_actor_init (FooActor *self)
+{
+}
+
+static void
+wait_for_paint (ClutterActor *stage)
+{
+  GMainLoop *main_loop = g_main_loop_new (NULL, TRUE);
+  gulong paint_handler;
+
+  paint_handler = g_signal_connect_data (stage,
+                                         "paint",
+                                         G_CALLBACK (g_main_loop_quit),
+                                         main_loop,
+                                         NULL,
+                                         G_CONNECT_SWAPPED | G_CONNECT_AFTER);
+
+  /* A redraw queued on the stage doesn't touch the nodes of its children */
+  clutter_actor_queue_redraw (stage);
+
+  g_main_loop_run (main_loop);
+
+  g_clear_signal_handler (&paint_handler, stage);
+  g_main_loop_unref (main_loop);
+}
+
+static void
+actor_retained_paint_nodes (void)
+{
+  ClutterActor *stage = clutter_test_get_stage ();
+  FooActor *foo_actor;
+  ClutterActor *actor;
+
+  foo_actor = g_object_new (foo_actor_get_type (), NULL);
+  actor = CLUTTER_ACTOR (foo_actor);
+  clutter_actor_set_size (actor, 100, 100);
+  clutter_actor_set_retain_paint_nodes (actor, TRUE);
+  g_assert_true (clutter_actor_get_retain_paint_nodes (actor));
+  clutter_actor_add_child (stage, actor);
+
+  clutter_actor_show (stage);
+
+  wait_for_paint (stage);
+  g_assert_cmpint (foo_actor->paint_node_count, ==, 1);
+
+  /* Nothing changed, so the retained nodes are painted again */
+  wait_for_paint (stage);
+  g_assert_cmpint (foo_actor->paint_node_count, ==, 1);
+
+  /* A redraw queued on the actor itself drops them */
+  clutter_actor_queue_redraw (actor);
+  wait_for_paint (stage);
+  g_assert_cmpint (foo_actor->paint_node_count, ==, 2);
+
+  wait_for_paint (stage);
+  g_assert_cmpint (foo_actor->paint_node_count, ==, 2);
+
+  /* So does a change of allocation */
+  clutter_actor_set_size (actor, 50, 50);
+  wait_for_paint (stage);
+  g_assert_cmpint (foo_actor->paint_node_count, ==, 3);
+
+  wait_for_paint (stage);
+  g_assert_cmpint (foo_actor->paint_node_count, ==, 3);
+
+  /* And unmapping the actor */
+  clutter_actor_hide (actor);
+  wait_for_paint (stage);
+  g_assert_cmpint (foo_actor->paint_node_count, ==, 3);
+
+  clutter_actor_show (actor);
+  wait_for_paint (stage);
+  g_assert_cmpint (foo_actor->paint_node_count, ==, 4);
+
+  /* Actors that don't retain their nodes build them on every paint */
+  clutter_actor_set_retain_paint_nodes (actor, FALSE);
+  wait_for_paint (stage);
+  g_assert_cmpint (foo_actor->paint_node_count, ==, 5);
+
+  clutter_actor_destroy (actor);
+}
+
+CLUTTER_TEST_SUITE (
+  CLUTTER_TEST_UNIT ("/actor/paint-nodes/retained", actor_retained_paint_nodes)
+)
@@ -36,4 +36,8 @@ G_DECLARE_FINAL_TYPE (MetaSelectionSourceWayland,
 
 MetaSelectionSource * meta_selection_source_wayland_new (MetaWaylandDataSource *source);
 
+void meta_selection_source_wayland_send (MetaSelectionSourceWayland *source_wayland,
+                                         const char                 *mimetype,
+                                         int                         fd);
+
 #endif /* META_SELECTION_SOURCE_WAYLAND_H */
@@ -154,6 +154,19 @@ copy_string_array_to_list (struct wl_array *array)
   return l;
 }
 
+/*
+ * Asks the client owning the data source to write the content straight
+ * into @fd, without it going through the compositor. Takes ownership of
+ * @fd.
+ */
+void
+meta_selection_source_wayland_send (MetaSelectionSourceWayland *source_wayland,
+                                    const char                 *mimetype,
+                                    int                         fd)
+{
+  meta_wayland_data_source_send (source_wayland->data_source, mimetype, fd);
+}
+
 MetaSelectionSource *
 meta_selection_source_wayland_new (MetaWaylandDataSource *data_source)
 {
@@ -270,9 +270,13 @@ meta_wayland_actor_surface_apply_state (MetaWaylandSurfaceRole  *surface_role,
       return;
     }
 
+  /* Hidden or obscured surfaces would not be painted by the redraw, and
+   * instead get their frame callbacks throttled by the surface actor.
+   */
   if (!wl_list_empty (&pending->frame_callback_list) &&
       cairo_region_is_empty (pending->surface_damage) &&
-      cairo_region_is_empty (pending->buffer_damage))
+      cairo_region_is_empty (pending->buffer_damage) &&
+      meta_surface_actor_wayland_is_painted (META_SURFACE_ACTOR_WAYLAND (priv->actor)))
     clutter_actor_queue_redraw (CLUTTER_ACTOR (priv->actor));
 
   meta_wayland_actor_surface_queue_frame_callbacks (actor_surface, pending);
@@ -57,6 +57,7 @@
 #include "cogl/cogl-egl.h"
 #include "meta/util.h"
 #include "wayland/meta-wayland-dma-buf.h"
+#include "wayland/meta-wayland-shm.h"
 
 #ifdef HAVE_NATIVE_BACKEND
 #include "backends/native/meta-drm-buffer-gbm.h"
@@ -142,7 +143,7 @@ meta_wayland_buffer_realize (MetaWaylandBuffer *buffer)
 #endif
   MetaWaylandDmaBufBuffer *dma_buf;
 
-  if (wl_shm_buffer_get (buffer->resource) != NULL)
+  if (meta_wayland_shm_buffer_from_resource (buffer->resource))
     {
       buffer->type = META_WAYLAND_BUFFER_TYPE_SHM;
       return TRUE;
@@ -187,14 +188,14 @@ meta_wayland_buffer_realize (MetaWaylandBuffer *buffer)
 }
 
 static void
-shm_buffer_get_cogl_pixel_format (struct wl_shm_buffer  *shm_buffer,
+shm_buffer_get_cogl_pixel_format (MetaWaylandShmBuffer  *shm_buffer,
                                   CoglPixelFormat       *format_out,
                                   CoglTextureComponents *components_out)
 {
   CoglPixelFormat format;
   CoglTextureComponents components = COGL_TEXTURE_COMPONENTS_RGBA;
 
-  switch (wl_shm_buffer_get_format (shm_buffer))
+  switch (meta_wayland_shm_buffer_get_format (shm_buffer))
     {
 #if G_BYTE_ORDER == G_BIG_ENDIAN
     case WL_SHM_FORMAT_ARGB8888:
@@ -224,6 +225,35 @@ shm_buffer_get_cogl_pixel_format (struct wl_shm_buffer  *shm_buffer,
     *components_out = components;
 }
 
+static gboolean
+shm_buffer_try_import (MetaWaylandBuffer    *buffer,
+                       MetaWaylandShmBuffer *shm_buffer)
+{
+  g_autoptr (GError) error = NULL;
+
+  if (buffer->shm.texture)
+    return TRUE;
+
+  if (buffer->shm.import_failed)
+    return FALSE;
+
+  buffer->shm.dma_buf = meta_wayland_shm_buffer_create_dma_buf (shm_buffer);
+  if (buffer->shm.dma_buf)
+    {
+      buffer->shm.texture =
+        meta_wayland_dma_buf_create_texture (buffer->shm.dma_buf, &error);
+      if (!buffer->shm.texture)
+        {
+          g_debug ("Failed to import shared memory buffer: %s",
+                   error->message);
+          g_clear_object (&buffer->shm.dma_buf);
+        }
+    }
+
+  buffer->shm.import_failed = !buffer->shm.texture;
+  return !buffer->shm.import_failed;
+}
+
 static gboolean
 shm_buffer_attach (MetaWaylandBuffer  *buffer,
                    CoglTexture       **texture,
@@ -232,20 +262,33 @@ shm_buffer_attach (MetaWaylandBuffer  *buffer,
   MetaBackend *backend = meta_get_backend ();
   ClutterBackend *clutter_backend = meta_backend_get_clutter_backend (backend);
   CoglContext *cogl_context = clutter_backend_get_cogl_context (clutter_backend);
-  struct wl_shm_buffer *shm_buffer;
+  MetaWaylandShmBuffer *shm_buffer;
   int stride, width, height;
   CoglPixelFormat format;
   CoglTextureComponents components;
   CoglBitmap *bitmap;
   CoglTexture *new_texture;
 
-  shm_buffer = wl_shm_buffer_get (buffer->resource);
-  stride = wl_shm_buffer_get_stride (shm_buffer);
-  width = wl_shm_buffer_get_width (shm_buffer);
-  height = wl_shm_buffer_get_height (shm_buffer);
+  shm_buffer = meta_wayland_shm_buffer_from_resource (buffer->resource);
+
+  /* Sample the client memory directly if it could be imported, and only
+   * copy it into a texture of our own otherwise */
+  if (shm_buffer_try_import (buffer, shm_buffer))
+    {
+      cogl_clear_object (texture);
+      *texture = cogl_object_ref (buffer->shm.texture);
+      buffer->is_y_inverted = TRUE;
+      return TRUE;
+    }
+
+  stride = meta_wayland_shm_buffer_get_stride (shm_buffer);
+  width = meta_wayland_shm_buffer_get_width (shm_buffer);
+  height = meta_wayland_shm_buffer_get_height (shm_buffer);
   shm_buffer_get_cogl_pixel_format (shm_buffer, &format, &components);
 
+  /* A texture imported from another buffer must not be written to */
   if (*texture &&
+      cogl_texture_is_get_data_supported (*texture) &&
       cogl_texture_get_width (*texture) == width &&
       cogl_texture_get_height (*texture) == height &&
       cogl_texture_get_components (*texture) == components &&
@@ -257,13 +300,13 @@ shm_buffer_attach (MetaWaylandBuffer  *buffer,
 
   cogl_clear_object (texture);
 
-  wl_shm_buffer_begin_access (shm_buffer);
+  meta_wayland_shm_buffer_begin_access (shm_buffer);
 
   bitmap = cogl_bitmap_new_for_data (cogl_context,
                                      width, height,
                                      format,
                                      stride,
-                                     wl_shm_buffer_get_data (shm_buffer));
+                                     meta_wayland_shm_buffer_get_data (shm_buffer));
 
   new_texture = COGL_TEXTURE (cogl_texture_2d_new_from_bitmap (bitmap));
   cogl_texture_set_components (new_texture, components);
@@ -290,7 +333,7 @@ shm_buffer_attach (MetaWaylandBuffer  *buffer,
 
   cogl_object_unref (bitmap);
 
-  wl_shm_buffer_end_access (shm_buffer);
+  meta_wayland_shm_buffer_end_access (shm_buffer);
 
   if (!new_texture)
     return FALSE;
@@ -502,24 +545,29 @@ process_shm_buffer_damage (MetaWaylandBuffer *buffer,
                            cairo_region_t    *region,
                            GError           **error)
 {
-  struct wl_shm_buffer *shm_buffer;
+  MetaWaylandShmBuffer *shm_buffer;
   int i, n_rectangles;
   gboolean set_texture_failed = FALSE;
   CoglPixelFormat format;
 
+  /* The imported texture samples the client memory, there is no copy to
+   * update */
+  if (texture == buffer->shm.texture)
+    return TRUE;
+
   n_rectangles = cairo_region_num_rectangles (region);
 
-  shm_buffer = wl_shm_buffer_get (buffer->resource);
+  shm_buffer = meta_wayland_shm_buffer_from_resource (buffer->resource);
 
   shm_buffer_get_cogl_pixel_format (shm_buffer, &format, NULL);
   g_return_val_if_fail (cogl_pixel_format_get_n_planes (format) == 1, FALSE);
 
-  wl_shm_buffer_begin_access (shm_buffer);
+  meta_wayland_shm_buffer_begin_access (shm_buffer);
 
   for (i = 0; i < n_rectangles; i++)
     {
-      const uint8_t *data = wl_shm_buffer_get_data (shm_buffer);
-      int32_t stride = wl_shm_buffer_get_stride (shm_buffer);
+      const uint8_t *data = meta_wayland_shm_buffer_get_data (shm_buffer);
+      int32_t stride = meta_wayland_shm_buffer_get_stride (shm_buffer);
       cairo_rectangle_int_t rect;
       int bpp;
 
@@ -540,7 +588,7 @@ process_shm_buffer_damage (MetaWaylandBuffer *buffer,
         }
     }
 
-  wl_shm_buffer_end_access (shm_buffer);
+  meta_wayland_shm_buffer_end_access (shm_buffer);
 
   return !set_texture_failed;
 }
@@ -674,6 +722,8 @@ meta_wayland_buffer_finalize (GObject *object)
 {
   MetaWaylandBuffer *buffer = META_WAYLAND_BUFFER (object);
 
+  g_clear_pointer (&buffer->shm.texture, cogl_object_unref);
+  g_clear_object (&buffer->shm.dma_buf);
   g_clear_pointer (&buffer->egl_image.texture, cogl_object_unref);
 #ifdef HAVE_WAYLAND_EGLSTREAM
   g_clear_pointer (&buffer->egl_stream.texture, cogl_object_unref);
@@ -55,6 +55,13 @@ struct _MetaWaylandBuffer
 
   MetaWaylandBufferType type;
 
+  struct {
+    /* Shared memory imported through udmabuf, sampled without a copy */
+    MetaWaylandDmaBufBuffer *dma_buf;
+    CoglTexture *texture;
+    gboolean import_failed;
+  } shm;
+
   struct {
     CoglTexture *texture;
   } egl_image;
@@ -75,6 +75,10 @@ primary_offer_receive (struct wl_client   *client,
       return;
     }
 
+  if (meta_wayland_data_offer_send_from_wayland_owner (META_SELECTION_PRIMARY,
+                                                       mime_type, fd))
+    return;
+
   stream = g_unix_output_stream_new (fd, TRUE);
   meta_selection_transfer_async (meta_display_get_selection (display),
                                  META_SELECTION_PRIMARY,
@@ -31,7 +31,9 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "core/meta-selection-private.h"
 #include "meta/meta-selection.h"
+#include "wayland/meta-selection-source-wayland-private.h"
 #include "wayland/meta-wayland-data-device.h"
 #include "wayland/meta-wayland-private.h"
 
@@ -63,6 +65,31 @@ data_offer_accept (struct wl_client *client,
   offer->accepted = mime_type != NULL;
 }
 
+/*
+ * If the selection is owned by a Wayland client, the requesting client's fd
+ * is passed on to it, so that the content is written straight to the
+ * requester. Only X11 and compositor owned selections need to be copied by
+ * the compositor. Returns TRUE if @fd was handed over, in which case it is
+ * no longer owned by the caller.
+ */
+gboolean
+meta_wayland_data_offer_send_from_wayland_owner (MetaSelectionType  selection_type,
+                                                 const char        *mime_type,
+                                                 int                fd)
+{
+  MetaDisplay *display = meta_get_display ();
+  MetaSelectionSource *owner;
+
+  owner = meta_selection_get_current_owner (meta_display_get_selection (display),
+                                            selection_type);
+  if (!owner || !META_IS_SELECTION_SOURCE_WAYLAND (owner))
+    return FALSE;
+
+  meta_selection_source_wayland_send (META_SELECTION_SOURCE_WAYLAND (owner),
+                                      mime_type, fd);
+  return TRUE;
+}
+
 static void
 transfer_cb (MetaSelection *selection,
              GAsyncResult  *res,
@@ -86,6 +113,7 @@ data_offer_receive (struct wl_client *client, struct wl_resource *resource,
   MetaWaylandDataOffer *offer = wl_resource_get_user_data (resource);
   MetaDisplay *display = meta_get_display ();
   MetaSelectionType selection_type;
+  GOutputStream *stream;
   GList *mime_types;
   gboolean found;
 
@@ -95,24 +123,25 @@ data_offer_receive (struct wl_client *client, struct wl_resource *resource,
   found = g_list_find_custom (mime_types, mime_type, (GCompareFunc) g_strcmp0) != NULL;
   g_list_free_full (mime_types, g_free);
 
-  if (found)
-    {
-      GOutputStream *stream;
-
-      stream = g_unix_output_stream_new (fd, TRUE);
-      meta_selection_transfer_async (meta_display_get_selection (display),
-                                     selection_type,
-                                     mime_type,
-                                     -1,
-                                     stream,
-                                     NULL,
-                                     (GAsyncReadyCallback) transfer_cb,
-                                     stream);
-    }
-  else
+  if (!found)
     {
       close (fd);
+      return;
     }
+
+  if (meta_wayland_data_offer_send_from_wayland_owner (selection_type,
+                                                       mime_type, fd))
+    return;
+
+  stream = g_unix_output_stream_new (fd, TRUE);
+  meta_selection_transfer_async (meta_display_get_selection (display),
+                                 selection_type,
+                                 mime_type,
+                                 -1,
+                                 stream,
+                                 NULL,
+                                 (GAsyncReadyCallback) transfer_cb,
+                                 stream);
 }
 
 static void
@@ -48,4 +48,8 @@ void meta_wayland_data_offer_update_action (MetaWaylandDataOffer *offer);
 struct wl_resource *    meta_wayland_data_offer_get_resource (MetaWaylandDataOffer *offer);
 MetaWaylandDataSource * meta_wayland_data_offer_get_source   (MetaWaylandDataOffer *offer);
 
+gboolean meta_wayland_data_offer_send_from_wayland_owner (MetaSelectionType  selection_type,
+                                                          const char        *mime_type,
+                                                          int                fd);
+
 #endif /* META_WAYLAND_DATA_OFFER_H */
@@ -40,12 +40,15 @@
 #include "wayland/meta-wayland-dma-buf.h"
 
 #include <drm_fourcc.h>
+#include <poll.h>
+#include <sys/stat.h>
 
 #include "backends/meta-backend-private.h"
 #include "backends/meta-egl-ext.h"
 #include "backends/meta-egl.h"
 #include "cogl/cogl-egl.h"
 #include "cogl/cogl.h"
+#include "core/meta-anonymous-file.h"
 #include "meta/meta-backend.h"
 #include "wayland/meta-wayland-buffer.h"
 #include "wayland/meta-wayland-private.h"
@@ -53,6 +56,7 @@
 
 #ifdef HAVE_NATIVE_BACKEND
 #include "backends/native/meta-drm-buffer-gbm.h"
+#include "backends/native/meta-gpu-kms.h"
 #include "backends/native/meta-renderer-native.h"
 #endif
 
@@ -62,8 +66,20 @@
 #define DRM_FORMAT_MOD_INVALID ((1ULL << 56) - 1)
 #endif
 
+#ifndef DRM_FORMAT_MOD_LINEAR
+#define DRM_FORMAT_MOD_LINEAR 0
+#endif
+
 #define META_WAYLAND_DMA_BUF_MAX_FDS 4
 
+/* Layout of the entries of the format table shared with clients */
+typedef struct _MetaWaylandDmaBufFormat
+{
+  uint32_t drm_format;
+  uint32_t padding;
+  uint64_t drm_modifier;
+} MetaWaylandDmaBufFormat;
+
 struct _MetaWaylandDmaBufBuffer
 {
   GObject parent;
@@ -80,16 +96,25 @@ struct _MetaWaylandDmaBufBuffer
 
 G_DEFINE_TYPE (MetaWaylandDmaBufBuffer, meta_wayland_dma_buf_buffer, G_TYPE_OBJECT);
 
-static gboolean
-meta_wayland_dma_buf_realize_texture (MetaWaylandBuffer  *buffer,
-                                      GError            **error)
+/**
+ * meta_wayland_dma_buf_create_texture:
+ * @dma_buf: A #MetaWaylandDmaBufBuffer
+ * @error: Return location for a #GError
+ *
+ * Imports @dma_buf as an EGLImage and wraps it in a texture sampling the
+ * buffer memory directly.
+ *
+ * Returns: (transfer full): The texture, or %NULL on failure
+ */
+CoglTexture *
+meta_wayland_dma_buf_create_texture (MetaWaylandDmaBufBuffer  *dma_buf,
+                                     GError                  **error)
 {
   MetaBackend *backend = meta_get_backend ();
   MetaEgl *egl = meta_backend_get_egl (backend);
   ClutterBackend *clutter_backend = meta_backend_get_clutter_backend (backend);
   CoglContext *cogl_context = clutter_backend_get_cogl_context (clutter_backend);
   EGLDisplay egl_display = cogl_egl_context_get_egl_display (cogl_context);
-  MetaWaylandDmaBufBuffer *dma_buf = buffer->dma_buf.dma_buf;
   uint32_t n_planes;
   uint64_t modifiers[META_WAYLAND_DMA_BUF_MAX_FDS];
   CoglPixelFormat cogl_format;
@@ -97,9 +122,6 @@ meta_wayland_dma_buf_realize_texture (MetaWaylandBuffer  *buffer,
   CoglEglImageFlags flags;
   CoglTexture2D *texture;
 
-  if (buffer->dma_buf.texture)
-    return TRUE;
-
   switch (dma_buf->drm_format)
     {
     /*
@@ -125,7 +147,7 @@ meta_wayland_dma_buf_realize_texture (MetaWaylandBuffer  *buffer,
       g_set_error (error, G_IO_ERROR,
                    G_IO_ERROR_FAILED,
                    "Unsupported buffer format %d", dma_buf->drm_format);
-      return FALSE;
+      return NULL;
     }
 
   for (n_planes = 0; n_planes < META_WAYLAND_DMA_BUF_MAX_FDS; n_planes++)
@@ -148,7 +170,7 @@ meta_wayland_dma_buf_realize_texture (MetaWaylandBuffer  *buffer,
                                             modifiers,
                                             error);
   if (egl_image == EGL_NO_IMAGE_KHR)
-    return FALSE;
+    return NULL;
 
   flags = COGL_EGL_IMAGE_FLAG_NO_GET_DATA;
   texture = cogl_egl_texture_2d_new_from_image (cogl_context,
@@ -161,10 +183,24 @@ meta_wayland_dma_buf_realize_texture (MetaWaylandBuffer  *buffer,
 
   meta_egl_destroy_image (egl, egl_display, egl_image, NULL);
 
+  return COGL_TEXTURE (texture);
+}
+
+static gboolean
+meta_wayland_dma_buf_realize_texture (MetaWaylandBuffer  *buffer,
+                                      GError            **error)
+{
+  MetaWaylandDmaBufBuffer *dma_buf = buffer->dma_buf.dma_buf;
+  CoglTexture *texture;
+
+  if (buffer->dma_buf.texture)
+    return TRUE;
+
+  texture = meta_wayland_dma_buf_create_texture (dma_buf, error);
   if (!texture)
     return FALSE;
 
-  buffer->dma_buf.texture = COGL_TEXTURE (texture);
+  buffer->dma_buf.texture = texture;
   buffer->is_y_inverted = dma_buf->is_y_inverted;
 
   return TRUE;
@@ -183,6 +219,35 @@ meta_wayland_dma_buf_buffer_attach (MetaWaylandBuffer  *buffer,
   return TRUE;
 }
 
+/**
+ * meta_wayland_dma_buf_get_busy_fd:
+ * @dma_buf: A #MetaWaylandDmaBufBuffer
+ *
+ * Polling a dma-buf for reading waits for the implicit fence of any pending
+ * write to it, i.e. for the client's rendering to finish.
+ *
+ * Returns: A plane file descriptor of @dma_buf that is not yet ready to be
+ * read from, or -1 if all of them are
+ */
+int
+meta_wayland_dma_buf_get_busy_fd (MetaWaylandDmaBufBuffer *dma_buf)
+{
+  int i;
+
+  for (i = 0; i < META_WAYLAND_DMA_BUF_MAX_FDS; i++)
+    {
+      struct pollfd pollfd = { .fd = dma_buf->fds[i], .events = POLLIN };
+
+      if (dma_buf->fds[i] < 0)
+        break;
+
+      if (poll (&pollfd, 1, 0) == 0)
+        return dma_buf->fds[i];
+    }
+
+  return -1;
+}
+
 #ifdef HAVE_NATIVE_BACKEND
 static struct gbm_bo *
 create_gbm_bo (MetaWaylandDmaBufBuffer *dma_buf,
@@ -567,12 +632,6 @@ dma_buf_handle_create_buffer_params (struct wl_client   *client,
                                   buffer_params_destructor);
 }
 
-static const struct zwp_linux_dmabuf_v1_interface dma_buf_implementation =
-{
-  dma_buf_handle_destroy,
-  dma_buf_handle_create_buffer_params,
-};
-
 static gboolean
 should_send_modifiers (MetaBackend *backend)
 {
@@ -583,8 +642,21 @@ should_send_modifiers (MetaBackend *backend)
 }
 
 static void
-send_modifiers (struct wl_resource *resource,
-                uint32_t            format)
+add_format (GArray   *formats,
+            uint32_t  drm_format,
+            uint64_t  drm_modifier)
+{
+  MetaWaylandDmaBufFormat format = {
+    .drm_format = drm_format,
+    .drm_modifier = drm_modifier,
+  };
+
+  g_array_append_val (formats, format);
+}
+
+static void
+add_format_modifiers (GArray   *formats,
+                      uint32_t  drm_format)
 {
   MetaBackend *backend = meta_get_backend ();
   MetaEgl *egl = meta_backend_get_egl (backend);
@@ -597,58 +669,333 @@ send_modifiers (struct wl_resource *resource,
   gboolean ret;
   int i;
 
-  zwp_linux_dmabuf_v1_send_format (resource, format);
-
-  /* The modifier event was only added in v3; v1 and v2 only have the format
-   * event. */
-  if (wl_resource_get_version (resource) < ZWP_LINUX_DMABUF_V1_MODIFIER_SINCE_VERSION)
-    return;
-
   if (!should_send_modifiers (backend))
     {
-      zwp_linux_dmabuf_v1_send_modifier (resource, format,
-                                         DRM_FORMAT_MOD_INVALID >> 32,
-                                         DRM_FORMAT_MOD_INVALID & 0xffffffff);
+      add_format (formats, drm_format, DRM_FORMAT_MOD_INVALID);
       return;
     }
 
   /* First query the number of available modifiers, then allocate an array,
    * then fill the array. */
-  ret = meta_egl_query_dma_buf_modifiers (egl, egl_display, format, 0, NULL,
+  ret = meta_egl_query_dma_buf_modifiers (egl, egl_display, drm_format, 0, NULL,
                                           NULL, &num_modifiers, NULL);
   if (!ret)
     return;
 
   if (num_modifiers == 0)
     {
-      zwp_linux_dmabuf_v1_send_modifier (resource, format,
-                                         DRM_FORMAT_MOD_INVALID >> 32,
-                                         DRM_FORMAT_MOD_INVALID & 0xffffffff);
+      add_format (formats, drm_format, DRM_FORMAT_MOD_INVALID);
       return;
     }
 
   modifiers = g_new0 (uint64_t, num_modifiers);
-  ret = meta_egl_query_dma_buf_modifiers (egl, egl_display, format,
+  ret = meta_egl_query_dma_buf_modifiers (egl, egl_display, drm_format,
                                           num_modifiers, modifiers, NULL,
                                           &num_modifiers, &error);
   if (!ret)
     {
       g_warning ("Failed to query modifiers for format 0x%" PRIu32 ": %s",
-                 format, error ? error->message : "unknown error");
+                 drm_format, error ? error->message : "unknown error");
+      g_error_free (error);
       g_free (modifiers);
       return;
     }
 
   for (i = 0; i < num_modifiers; i++)
+    add_format (formats, drm_format, modifiers[i]);
+
+  g_free (modifiers);
+}
+
+static GArray *
+query_formats (void)
+{
+  GArray *formats;
+
+  formats = g_array_new (FALSE, FALSE, sizeof (MetaWaylandDmaBufFormat));
+  add_format_modifiers (formats, DRM_FORMAT_ARGB8888);
+  add_format_modifiers (formats, DRM_FORMAT_XRGB8888);
+  add_format_modifiers (formats, DRM_FORMAT_ARGB2101010);
+  add_format_modifiers (formats, DRM_FORMAT_RGB565);
+
+  /* Feedback refers to formats by a 16 bit index into the table */
+  if (formats->len > G_MAXUINT16)
+    g_array_set_size (formats, G_MAXUINT16);
+
+  return formats;
+}
+
+static void
+send_formats (MetaWaylandCompositor *compositor,
+              struct wl_resource    *resource)
+{
+  GArray *formats = compositor->dma_buf.formats;
+  unsigned int i;
+
+  for (i = 0; i < formats->len; i++)
     {
-      zwp_linux_dmabuf_v1_send_modifier (resource, format,
-                                         modifiers[i] >> 32,
-                                         modifiers[i] & 0xffffffff);
+      MetaWaylandDmaBufFormat *format =
+        &g_array_index (formats, MetaWaylandDmaBufFormat, i);
+
+      if (i == 0 ||
+          format[-1].drm_format != format->drm_format)
+        zwp_linux_dmabuf_v1_send_format (resource, format->drm_format);
+
+      /* The modifier event was only added in v3; v1 and v2 only have the
+       * format event. */
+      if (wl_resource_get_version (resource) < ZWP_LINUX_DMABUF_V1_MODIFIER_SINCE_VERSION)
+        continue;
+
+      zwp_linux_dmabuf_v1_send_modifier (resource, format->drm_format,
+                                         format->drm_modifier >> 32,
+                                         format->drm_modifier & 0xffffffff);
     }
+}
 
-  g_free (modifiers);
+static void
+send_tranche (struct wl_resource *resource,
+              struct wl_array    *device,
+              struct wl_array    *indices,
+              uint32_t            flags)
+{
+  zwp_linux_dmabuf_feedback_v1_send_tranche_target_device (resource, device);
+  zwp_linux_dmabuf_feedback_v1_send_tranche_formats (resource, indices);
+  if (flags)
+    zwp_linux_dmabuf_feedback_v1_send_tranche_flags (resource, flags);
+  zwp_linux_dmabuf_feedback_v1_send_tranche_done (resource);
+}
+
+static void
+send_feedback (MetaWaylandCompositor *compositor,
+               struct wl_resource    *resource,
+               int                    scanout_format_index)
+{
+  MetaAnonymousFile *format_table = compositor->dma_buf.format_table;
+  struct wl_array device;
+  struct wl_array indices;
+  uint16_t *index;
+  unsigned int i;
+  int fd;
+
+  fd = meta_anonymous_file_open_fd (format_table,
+                                    META_ANONYMOUS_FILE_MAPMODE_PRIVATE);
+  zwp_linux_dmabuf_feedback_v1_send_format_table (resource, fd,
+                                                  meta_anonymous_file_size (format_table));
+  meta_anonymous_file_close_fd (fd);
+
+  wl_array_init (&device);
+  *(dev_t *) wl_array_add (&device, sizeof (dev_t)) =
+    compositor->dma_buf.main_device;
+  zwp_linux_dmabuf_feedback_v1_send_main_device (resource, &device);
+
+  wl_array_init (&indices);
+
+  if (scanout_format_index >= 0)
+    {
+      index = wl_array_add (&indices, sizeof (uint16_t));
+      *index = scanout_format_index;
+      send_tranche (resource, &device, &indices,
+                    ZWP_LINUX_DMABUF_FEEDBACK_V1_TRANCHE_FLAGS_SCANOUT);
+      indices.size = 0;
+    }
+
+  for (i = 0; i < compositor->dma_buf.formats->len; i++)
+    {
+      index = wl_array_add (&indices, sizeof (uint16_t));
+      *index = i;
+    }
+  send_tranche (resource, &device, &indices, 0);
+
+  zwp_linux_dmabuf_feedback_v1_send_done (resource);
+
+  wl_array_release (&indices);
+  wl_array_release (&device);
+}
+
+static void
+send_surface_feedback (MetaWaylandSurface *surface)
+{
+  MetaWaylandCompositor *compositor = surface->compositor;
+  struct wl_resource *resource;
+  int scanout_format_index = -1;
+
+  if (compositor->dma_buf.scanout_candidate == surface)
+    scanout_format_index = compositor->dma_buf.scanout_format_index;
+
+  wl_resource_for_each (resource, &surface->dma_buf_feedback.resources)
+    send_feedback (compositor, resource, scanout_format_index);
+}
+
+static int
+find_scanout_format_index (MetaWaylandCompositor *compositor,
+                           CoglOnscreen          *onscreen)
+{
+#ifdef HAVE_NATIVE_BACKEND
+  GArray *formats = compositor->dma_buf.formats;
+  uint32_t drm_format;
+  uint64_t drm_modifier;
+  unsigned int i;
+
+  if (!meta_onscreen_native_get_scanout_format (onscreen,
+                                                &drm_format,
+                                                &drm_modifier))
+    return -1;
+
+  for (i = 0; i < formats->len; i++)
+    {
+      MetaWaylandDmaBufFormat *format =
+        &g_array_index (formats, MetaWaylandDmaBufFormat, i);
+
+      if (format->drm_format == drm_format &&
+          format->drm_modifier == drm_modifier)
+        return i;
+    }
+#endif
+
+  return -1;
+}
+
+/**
+ * meta_wayland_dma_buf_set_scanout_candidate:
+ * @compositor: The #MetaWaylandCompositor
+ * @surface: (nullable): The surface that could be scanned out directly
+ * @onscreen: (nullable): The onscreen @surface would be scanned out on
+ *
+ * Updates which surface gets a scanout tranche in its dma-buf feedback, so
+ * that its client can allocate buffers suitable for direct scanout. The
+ * feedback of the previous and new candidate is re-sent when it changes.
+ */
+void
+meta_wayland_dma_buf_set_scanout_candidate (MetaWaylandCompositor *compositor,
+                                            MetaWaylandSurface    *surface,
+                                            CoglOnscreen          *onscreen)
+{
+  MetaWaylandSurface *old_candidate = compositor->dma_buf.scanout_candidate;
+  int scanout_format_index = -1;
+
+  if (!compositor->dma_buf.format_table)
+    return;
+
+  if (surface)
+    scanout_format_index = find_scanout_format_index (compositor, onscreen);
+
+  if (scanout_format_index < 0)
+    surface = NULL;
+
+  if (surface == old_candidate &&
+      scanout_format_index == compositor->dma_buf.scanout_format_index)
+    return;
+
+  compositor->dma_buf.scanout_candidate = surface;
+  compositor->dma_buf.scanout_format_index = scanout_format_index;
+
+  if (old_candidate && old_candidate != surface)
+    send_surface_feedback (old_candidate);
+  if (surface)
+    send_surface_feedback (surface);
+}
+
+void
+meta_wayland_dma_buf_forget_surface (MetaWaylandCompositor *compositor,
+                                     MetaWaylandSurface    *surface)
+{
+  struct wl_resource *resource, *next;
+
+  if (compositor->dma_buf.scanout_candidate == surface)
+    {
+      compositor->dma_buf.scanout_candidate = NULL;
+      compositor->dma_buf.scanout_format_index = -1;
+    }
+
+  wl_resource_for_each_safe (resource, next, &surface->dma_buf_feedback.resources)
+    {
+      wl_list_remove (wl_resource_get_link (resource));
+      wl_list_init (wl_resource_get_link (resource));
+      wl_resource_set_user_data (resource, NULL);
+    }
+}
+
+static void
+dma_buf_feedback_destroy (struct wl_client   *client,
+                          struct wl_resource *resource)
+{
+  wl_resource_destroy (resource);
+}
+
+static const struct zwp_linux_dmabuf_feedback_v1_interface dma_buf_feedback_implementation =
+{
+  dma_buf_feedback_destroy,
+};
+
+static void
+surface_feedback_destructor (struct wl_resource *resource)
+{
+  wl_list_remove (wl_resource_get_link (resource));
+}
+
+static struct wl_resource *
+create_feedback_resource (struct wl_client   *client,
+                          struct wl_resource *dma_buf_resource,
+                          uint32_t            feedback_id)
+{
+  return wl_resource_create (client,
+                             &zwp_linux_dmabuf_feedback_v1_interface,
+                             wl_resource_get_version (dma_buf_resource),
+                             feedback_id);
 }
 
+static void
+dma_buf_handle_get_default_feedback (struct wl_client   *client,
+                                     struct wl_resource *dma_buf_resource,
+                                     uint32_t            feedback_id)
+{
+  MetaWaylandCompositor *compositor =
+    wl_resource_get_user_data (dma_buf_resource);
+  struct wl_resource *feedback_resource;
+
+  feedback_resource = create_feedback_resource (client, dma_buf_resource,
+                                                feedback_id);
+  wl_resource_set_implementation (feedback_resource,
+                                  &dma_buf_feedback_implementation,
+                                  NULL, NULL);
+
+  send_feedback (compositor, feedback_resource, -1);
+}
+
+static void
+dma_buf_handle_get_surface_feedback (struct wl_client   *client,
+                                     struct wl_resource *dma_buf_resource,
+                                     uint32_t            feedback_id,
+                                     struct wl_resource *surface_resource)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (surface_resource);
+  MetaWaylandCompositor *compositor = surface->compositor;
+  struct wl_resource *feedback_resource;
+  int scanout_format_index = -1;
+
+  feedback_resource = create_feedback_resource (client, dma_buf_resource,
+                                                feedback_id);
+  wl_resource_set_implementation (feedback_resource,
+                                  &dma_buf_feedback_implementation,
+                                  surface,
+                                  surface_feedback_destructor);
+  wl_list_insert (&surface->dma_buf_feedback.resources,
+                  wl_resource_get_link (feedback_resource));
+
+  if (compositor->dma_buf.scanout_candidate == surface)
+    scanout_format_index = compositor->dma_buf.scanout_format_index;
+
+  send_feedback (compositor, feedback_resource, scanout_format_index);
+}
+
+static const struct zwp_linux_dmabuf_v1_interface dma_buf_implementation =
+{
+  dma_buf_handle_destroy,
+  dma_buf_handle_create_buffer_params,
+  dma_buf_handle_get_default_feedback,
+  dma_buf_handle_get_surface_feedback,
+};
+
 static void
 dma_buf_bind (struct wl_client *client,
               void             *data,
@@ -662,10 +1009,33 @@ dma_buf_bind (struct wl_client *client,
                                  version, id);
   wl_resource_set_implementation (resource, &dma_buf_implementation,
                                   compositor, NULL);
-  send_modifiers (resource, DRM_FORMAT_ARGB8888);
-  send_modifiers (resource, DRM_FORMAT_XRGB8888);
-  send_modifiers (resource, DRM_FORMAT_ARGB2101010);
-  send_modifiers (resource, DRM_FORMAT_RGB565);
+
+  /* Starting with v4, formats are only advertised through feedback */
+  if (version < ZWP_LINUX_DMABUF_V1_GET_DEFAULT_FEEDBACK_SINCE_VERSION)
+    send_formats (compositor, resource);
+}
+
+static gboolean
+get_main_device (MetaBackend *backend,
+                 dev_t       *device)
+{
+#ifdef HAVE_NATIVE_BACKEND
+  MetaRenderer *renderer = meta_backend_get_renderer (backend);
+  MetaGpuKms *gpu_kms;
+  struct stat device_stat;
+
+  if (!META_IS_RENDERER_NATIVE (renderer))
+    return FALSE;
+
+  gpu_kms = meta_renderer_native_get_primary_gpu (META_RENDERER_NATIVE (renderer));
+  if (stat (meta_gpu_kms_get_file_path (gpu_kms), &device_stat) != 0)
+    return FALSE;
+
+  *device = device_stat.st_rdev;
+  return TRUE;
+#else
+  return FALSE;
+#endif
 }
 
 /**
@@ -673,6 +1043,8 @@ dma_buf_bind (struct wl_client *client,
  * @compositor: The #MetaWaylandCompositor
  *
  * Creates the global Wayland object that exposes the linux-dmabuf protocol.
+ * Feedback (version 4) is only exposed when the device the compositor renders
+ * with is known.
  *
  * Returns: Whether the initialization was succesfull. If this is %FALSE,
  * clients won't be able to use the linux-dmabuf protocol to pass buffers.
@@ -685,6 +1057,8 @@ meta_wayland_dma_buf_init (MetaWaylandCompositor *compositor)
   ClutterBackend *clutter_backend = meta_backend_get_clutter_backend (backend);
   CoglContext *cogl_context = clutter_backend_get_cogl_context (clutter_backend);
   EGLDisplay egl_display = cogl_egl_context_get_egl_display (cogl_context);
+  GArray *formats;
+  uint32_t version;
 
   g_assert (backend && egl && clutter_backend && cogl_context && egl_display);
 
@@ -693,9 +1067,25 @@ meta_wayland_dma_buf_init (MetaWaylandCompositor *compositor)
                                 NULL))
     return FALSE;
 
+  formats = query_formats ();
+  compositor->dma_buf.formats = formats;
+  compositor->dma_buf.scanout_format_index = -1;
+
+  if (get_main_device (backend, &compositor->dma_buf.main_device))
+    {
+      compositor->dma_buf.format_table =
+        meta_anonymous_file_new (formats->len * sizeof (MetaWaylandDmaBufFormat),
+                                 (const uint8_t *) formats->data);
+      version = META_ZWP_LINUX_DMABUF_V1_VERSION;
+    }
+  else
+    {
+      version = ZWP_LINUX_DMABUF_V1_GET_DEFAULT_FEEDBACK_SINCE_VERSION - 1;
+    }
+
   if (!wl_global_create (compositor->wayland_display,
                          &zwp_linux_dmabuf_v1_interface,
-                         META_ZWP_LINUX_DMABUF_V1_VERSION,
+                         version,
                          compositor,
                          dma_buf_bind))
     return FALSE;
@@ -703,6 +1093,94 @@ meta_wayland_dma_buf_init (MetaWaylandCompositor *compositor)
   return TRUE;
 }
 
+static gboolean
+find_linear_modifier (MetaWaylandCompositor *compositor,
+                      uint32_t               drm_format,
+                      uint64_t              *drm_modifier)
+{
+  GArray *formats = compositor->dma_buf.formats;
+  gboolean has_implicit_modifier = FALSE;
+  unsigned int i;
+
+  if (!formats)
+    return FALSE;
+
+  for (i = 0; i < formats->len; i++)
+    {
+      MetaWaylandDmaBufFormat *format =
+        &g_array_index (formats, MetaWaylandDmaBufFormat, i);
+
+      if (format->drm_format != drm_format)
+        continue;
+
+      if (format->drm_modifier == DRM_FORMAT_MOD_LINEAR)
+        {
+          *drm_modifier = DRM_FORMAT_MOD_LINEAR;
+          return TRUE;
+        }
+
+      if (format->drm_modifier == DRM_FORMAT_MOD_INVALID)
+        has_implicit_modifier = TRUE;
+    }
+
+  /* Without modifiers, a buffer allocated outside of the GPU driver is
+   * expected to be linear */
+  if (has_implicit_modifier)
+    {
+      *drm_modifier = DRM_FORMAT_MOD_INVALID;
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+/**
+ * meta_wayland_dma_buf_buffer_new_linear:
+ * @compositor: The #MetaWaylandCompositor
+ * @fd: (transfer full): The dma-buf file descriptor
+ * @width: Width of the buffer
+ * @height: Height of the buffer
+ * @drm_format: DRM fourcc code of the buffer
+ * @offset: Offset of the first pixel within @fd
+ * @stride: Stride of the buffer in bytes
+ *
+ * Creates a single plane, linear dma-buf buffer, such as one wrapping shared
+ * memory. @fd is closed on failure.
+ *
+ * Returns: (transfer full) (nullable): The dma-buf buffer, or %NULL if the
+ * renderer can't import linear buffers of @drm_format
+ */
+MetaWaylandDmaBufBuffer *
+meta_wayland_dma_buf_buffer_new_linear (MetaWaylandCompositor *compositor,
+                                        int                    fd,
+                                        int                    width,
+                                        int                    height,
+                                        uint32_t               drm_format,
+                                        uint32_t               offset,
+                                        uint32_t               stride)
+{
+  MetaWaylandDmaBufBuffer *dma_buf;
+  uint64_t drm_modifier;
+
+  if (!find_linear_modifier (compositor, drm_format, &drm_modifier))
+    {
+      close (fd);
+      return NULL;
+    }
+
+  dma_buf = g_object_new (META_TYPE_WAYLAND_DMA_BUF_BUFFER, NULL);
+  dma_buf->width = width;
+  dma_buf->height = height;
+  dma_buf->drm_format = drm_format;
+  dma_buf->drm_modifier = drm_modifier;
+  dma_buf->is_y_inverted = TRUE;
+  dma_buf->fds[0] = fd;
+  dma_buf->offsets[0] = offset;
+  dma_buf->strides[0] = stride;
+
+  return dma_buf;
+}
+
 static void
 meta_wayland_dma_buf_buffer_finalize (GObject *object)
 {
@@ -49,8 +49,33 @@ meta_wayland_dma_buf_buffer_attach (MetaWaylandBuffer  *buffer,
 MetaWaylandDmaBufBuffer *
 meta_wayland_dma_buf_from_buffer (MetaWaylandBuffer *buffer);
 
+MetaWaylandDmaBufBuffer *
+meta_wayland_dma_buf_buffer_new_linear (MetaWaylandCompositor *compositor,
+                                        int                    fd,
+                                        int                    width,
+                                        int                    height,
+                                        uint32_t               drm_format,
+                                        uint32_t               offset,
+                                        uint32_t               stride);
+
+CoglTexture *
+meta_wayland_dma_buf_create_texture (MetaWaylandDmaBufBuffer  *dma_buf,
+                                     GError                  **error);
+
+int
+meta_wayland_dma_buf_get_busy_fd (MetaWaylandDmaBufBuffer *dma_buf);
+
 CoglScanout *
 meta_wayland_dma_buf_try_acquire_scanout (MetaWaylandDmaBufBuffer *dma_buf,
                                           CoglOnscreen            *onscreen);
 
+void
+meta_wayland_dma_buf_set_scanout_candidate (MetaWaylandCompositor *compositor,
+                                            MetaWaylandSurface    *surface,
+                                            CoglOnscreen          *onscreen);
+
+void
+meta_wayland_dma_buf_forget_surface (MetaWaylandCompositor *compositor,
+                                     MetaWaylandSurface    *surface);
+
 #endif /* META_WAYLAND_DMA_BUF_H */
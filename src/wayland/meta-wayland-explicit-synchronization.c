@@ -0,0 +1,480 @@
+/*
+ * Wayland Support
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ */
+
+#include "config.h"
+
+#include "wayland/meta-wayland-explicit-synchronization.h"
+
+#include <glib.h>
+#include <linux/sync_file.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "backends/meta-backend-private.h"
+#include "backends/meta-egl-ext.h"
+#include "backends/meta-egl.h"
+#include "cogl/cogl-egl.h"
+#include "wayland/meta-wayland-buffer.h"
+#include "wayland/meta-wayland-private.h"
+#include "wayland/meta-wayland-surface.h"
+#include "wayland/meta-wayland-versions.h"
+
+#include "linux-explicit-synchronization-unstable-v1-server-protocol.h"
+
+static EGLDisplay
+get_egl_display (void)
+{
+  MetaBackend *backend = meta_get_backend ();
+  ClutterBackend *clutter_backend = meta_backend_get_clutter_backend (backend);
+  CoglContext *cogl_context = clutter_backend_get_cogl_context (clutter_backend);
+
+  return cogl_egl_context_get_egl_display (cogl_context);
+}
+
+gboolean
+meta_wayland_sync_file_is_signaled (int fd)
+{
+  struct pollfd pollfd = { .fd = fd, .events = POLLIN };
+
+  return poll (&pollfd, 1, 0) == 1;
+}
+
+static gboolean
+is_sync_file (int fd)
+{
+  struct sync_file_info info = { 0 };
+
+  return ioctl (fd, SYNC_IOC_FILE_INFO, &info) == 0;
+}
+
+/* Makes GL commands submitted from now on wait on the fence on the GPU side,
+ * taking ownership of @fence_fd. The fence is never waited on by the CPU, as
+ * a client could hand over one that doesn't ever signal. */
+static void
+wait_acquire_fence (MetaWaylandSurface *surface,
+                    int                 fence_fd)
+{
+  MetaEgl *egl = meta_backend_get_egl (meta_get_backend ());
+  EGLDisplay egl_display = get_egl_display ();
+  EGLint attribs[] = {
+    EGL_SYNC_NATIVE_FENCE_FD_ANDROID, fence_fd,
+    EGL_NONE
+  };
+  EGLSyncKHR sync;
+  GError *error = NULL;
+
+  sync = meta_egl_create_sync (egl, egl_display,
+                               EGL_SYNC_NATIVE_FENCE_ANDROID, attribs,
+                               &error);
+  if (sync == EGL_NO_SYNC_KHR)
+    {
+      if (surface->synchronization.resource)
+        {
+          wl_resource_post_error (surface->synchronization.resource,
+                                  ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_INVALID_FENCE,
+                                  "Failed to import the acquire fence: %s",
+                                  error->message);
+        }
+      else
+        {
+          g_warning ("Failed to import acquire fence: %s", error->message);
+        }
+
+      g_error_free (error);
+      close (fence_fd);
+      return;
+    }
+
+  if (!meta_egl_wait_sync (egl, egl_display, sync, &error))
+    {
+      g_warning ("Failed to wait on acquire fence: %s", error->message);
+      g_error_free (error);
+    }
+
+  meta_egl_destroy_sync (egl, egl_display, sync, NULL);
+}
+
+/* Returns a fence that signals once the GPU has finished all commands
+ * submitted so far, or -1 if it couldn't be created. */
+static int
+create_release_fence (void)
+{
+  MetaEgl *egl = meta_backend_get_egl (meta_get_backend ());
+  EGLDisplay egl_display = get_egl_display ();
+  EGLSyncKHR sync;
+  int fence_fd;
+  GError *error = NULL;
+
+  sync = meta_egl_create_sync (egl, egl_display,
+                               EGL_SYNC_NATIVE_FENCE_ANDROID, NULL,
+                               &error);
+  if (sync == EGL_NO_SYNC_KHR)
+    {
+      g_warning ("Failed to create release fence: %s", error->message);
+      g_error_free (error);
+      return -1;
+    }
+
+  /* The fence only gets a file descriptor once it has been flushed */
+  meta_egl_client_wait_sync (egl, egl_display, sync,
+                             EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, 0,
+                             NULL);
+  fence_fd = meta_egl_dup_native_fence_fd (egl, egl_display, sync, NULL);
+  meta_egl_destroy_sync (egl, egl_display, sync, NULL);
+
+  return fence_fd;
+}
+
+static void
+buffer_release_destructor (struct wl_resource *resource)
+{
+  struct wl_resource **owner = wl_resource_get_user_data (resource);
+
+  if (owner)
+    *owner = NULL;
+}
+
+void
+meta_wayland_buffer_release_move (struct wl_resource **to,
+                                  struct wl_resource **from)
+{
+  if (*from == NULL)
+    return;
+
+  if (*to)
+    meta_wayland_buffer_release_send (to, NULL);
+
+  *to = g_steal_pointer (from);
+  wl_resource_set_user_data (*to, to);
+}
+
+/**
+ * meta_wayland_buffer_release_send:
+ * @release: Pointer to the owned zwp_linux_buffer_release_v1 resource
+ * @buffer: (nullable): The buffer that is no longer used
+ *
+ * Tells the client that @buffer may be reused, and destroys the release
+ * object. If the GPU may still be reading from @buffer, the client is handed
+ * a fence to wait on rather than having the compositor block on it.
+ */
+void
+meta_wayland_buffer_release_send (struct wl_resource **release,
+                                  MetaWaylandBuffer   *buffer)
+{
+  struct wl_resource *resource;
+  int fence_fd = -1;
+
+  resource = g_steal_pointer (release);
+  if (!resource)
+    return;
+
+  if (buffer && buffer->type == META_WAYLAND_BUFFER_TYPE_DMA_BUF)
+    fence_fd = create_release_fence ();
+
+  if (fence_fd >= 0)
+    {
+      zwp_linux_buffer_release_v1_send_fenced_release (resource, fence_fd);
+      close (fence_fd);
+    }
+  else
+    {
+      zwp_linux_buffer_release_v1_send_immediate_release (resource);
+    }
+
+  wl_resource_set_user_data (resource, NULL);
+  wl_resource_destroy (resource);
+}
+
+gboolean
+meta_wayland_surface_synchronization_validate (MetaWaylandSurface      *surface,
+                                               MetaWaylandSurfaceState *pending)
+{
+  struct wl_resource *resource = surface->synchronization.resource;
+
+  if (!resource)
+    return TRUE;
+
+  if (pending->acquire_fence_fd < 0 && !pending->buffer_release)
+    return TRUE;
+
+  if (!pending->newly_attached || !pending->buffer)
+    {
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_NO_BUFFER,
+                              "No buffer was attached");
+      return FALSE;
+    }
+
+  if (pending->acquire_fence_fd >= 0 &&
+      pending->buffer->type != META_WAYLAND_BUFFER_TYPE_DMA_BUF)
+    {
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_UNSUPPORTED_BUFFER,
+                              "Acquire fences are only supported for dma-buf buffers");
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+void
+meta_wayland_surface_synchronization_apply_state (MetaWaylandSurface      *surface,
+                                                  MetaWaylandSurfaceState *state)
+{
+  MetaWaylandBufferRef *buffer_ref = surface->buffer_ref;
+  int fence_fd;
+
+  meta_wayland_buffer_release_move (&buffer_ref->release,
+                                    &state->buffer_release);
+
+  if (state->acquire_fence_fd < 0)
+    return;
+
+  fence_fd = state->acquire_fence_fd;
+  state->acquire_fence_fd = -1;
+
+  /* Only states cached for synchronized subsurfaces can get here with a
+   * fence that hasn't signaled yet; other commits are queued until it has. */
+  if (meta_wayland_sync_file_is_signaled (fence_fd))
+    {
+      close (fence_fd);
+      return;
+    }
+
+  /* Keep a reference for checking whether the buffer can be scanned out */
+  if (buffer_ref->acquire_fence_fd >= 0)
+    close (buffer_ref->acquire_fence_fd);
+  buffer_ref->acquire_fence_fd = dup (fence_fd);
+
+  wait_acquire_fence (surface, fence_fd);
+}
+
+static void
+surface_synchronization_destructor (struct wl_resource *resource)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (resource);
+
+  if (!surface)
+    return;
+
+  g_clear_signal_handler (&surface->synchronization.destroy_handler_id,
+                          surface);
+  surface->synchronization.resource = NULL;
+}
+
+static void
+on_surface_destroyed (MetaWaylandSurface *surface)
+{
+  wl_resource_set_user_data (surface->synchronization.resource, NULL);
+}
+
+static void
+surface_synchronization_destroy (struct wl_client   *client,
+                                 struct wl_resource *resource)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (resource);
+
+  /* Fences set since the last commit are discarded, releases are not */
+  if (surface)
+    {
+      MetaWaylandSurfaceState *pending;
+
+      pending = meta_wayland_surface_get_pending_state (surface);
+      if (pending->acquire_fence_fd >= 0)
+        {
+          close (pending->acquire_fence_fd);
+          pending->acquire_fence_fd = -1;
+        }
+    }
+
+  wl_resource_destroy (resource);
+}
+
+static void
+surface_synchronization_set_acquire_fence (struct wl_client   *client,
+                                           struct wl_resource *resource,
+                                           int32_t             fd)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (resource);
+  MetaWaylandSurfaceState *pending;
+
+  if (!surface)
+    {
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_NO_SURFACE,
+                              "The surface has been destroyed");
+      close (fd);
+      return;
+    }
+
+  if (!is_sync_file (fd))
+    {
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_INVALID_FENCE,
+                              "The acquire fence is not a sync file");
+      close (fd);
+      return;
+    }
+
+  pending = meta_wayland_surface_get_pending_state (surface);
+  if (pending->acquire_fence_fd >= 0)
+    {
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_DUPLICATE_FENCE,
+                              "An acquire fence was already set for this commit");
+      close (fd);
+      return;
+    }
+
+  pending->acquire_fence_fd = fd;
+}
+
+static void
+surface_synchronization_get_release (struct wl_client   *client,
+                                     struct wl_resource *resource,
+                                     uint32_t            id)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (resource);
+  MetaWaylandSurfaceState *pending;
+  struct wl_resource *release_resource;
+
+  if (!surface)
+    {
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_NO_SURFACE,
+                              "The surface has been destroyed");
+      return;
+    }
+
+  pending = meta_wayland_surface_get_pending_state (surface);
+  if (pending->buffer_release)
+    {
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_SURFACE_SYNCHRONIZATION_V1_ERROR_DUPLICATE_RELEASE,
+                              "A release was already requested for this commit");
+      return;
+    }
+
+  release_resource = wl_resource_create (client,
+                                         &zwp_linux_buffer_release_v1_interface,
+                                         wl_resource_get_version (resource),
+                                         id);
+  wl_resource_set_implementation (release_resource,
+                                  NULL,
+                                  &pending->buffer_release,
+                                  buffer_release_destructor);
+  pending->buffer_release = release_resource;
+}
+
+static const struct zwp_linux_surface_synchronization_v1_interface
+meta_wayland_surface_synchronization_interface = {
+  surface_synchronization_destroy,
+  surface_synchronization_set_acquire_fence,
+  surface_synchronization_get_release,
+};
+
+static void
+explicit_synchronization_destroy (struct wl_client   *client,
+                                  struct wl_resource *resource)
+{
+  wl_resource_destroy (resource);
+}
+
+static void
+explicit_synchronization_get_synchronization (struct wl_client   *client,
+                                              struct wl_resource *resource,
+                                              uint32_t            id,
+                                              struct wl_resource *surface_resource)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (surface_resource);
+  struct wl_resource *synchronization_resource;
+
+  if (surface->synchronization.resource)
+    {
+      wl_resource_post_error (resource,
+                              ZWP_LINUX_EXPLICIT_SYNCHRONIZATION_V1_ERROR_SYNCHRONIZATION_EXISTS,
+                              "Surface already has a synchronization object");
+      return;
+    }
+
+  synchronization_resource =
+    wl_resource_create (client,
+                        &zwp_linux_surface_synchronization_v1_interface,
+                        wl_resource_get_version (resource),
+                        id);
+  wl_resource_set_implementation (synchronization_resource,
+                                  &meta_wayland_surface_synchronization_interface,
+                                  surface,
+                                  surface_synchronization_destructor);
+
+  surface->synchronization.resource = synchronization_resource;
+  surface->synchronization.destroy_handler_id =
+    g_signal_connect (surface,
+                      "destroy",
+                      G_CALLBACK (on_surface_destroyed),
+                      NULL);
+}
+
+static const struct zwp_linux_explicit_synchronization_v1_interface
+meta_wayland_explicit_synchronization_interface = {
+  explicit_synchronization_destroy,
+  explicit_synchronization_get_synchronization,
+};
+
+static void
+explicit_synchronization_bind (struct wl_client *client,
+                               void             *data,
+                               uint32_t          version,
+                               uint32_t          id)
+{
+  struct wl_resource *resource;
+
+  resource = wl_resource_create (client,
+                                 &zwp_linux_explicit_synchronization_v1_interface,
+                                 version,
+                                 id);
+  wl_resource_set_implementation (resource,
+                                  &meta_wayland_explicit_synchronization_interface,
+                                  data,
+                                  NULL);
+}
+
+void
+meta_wayland_init_explicit_synchronization (MetaWaylandCompositor *compositor)
+{
+  MetaEgl *egl = meta_backend_get_egl (meta_get_backend ());
+
+  /* Acquire fences are waited on by the GPU and release fences are created
+   * from the rendering stream, neither of which is possible without native
+   * fence support. */
+  if (!meta_egl_has_extensions (egl, get_egl_display (), NULL,
+                                "EGL_ANDROID_native_fence_sync",
+                                "EGL_KHR_wait_sync",
+                                NULL))
+    return;
+
+  if (wl_global_create (compositor->wayland_display,
+                        &zwp_linux_explicit_synchronization_v1_interface,
+                        META_ZWP_LINUX_EXPLICIT_SYNCHRONIZATION_V1_VERSION,
+                        compositor,
+                        explicit_synchronization_bind) == NULL)
+    g_error ("Failed to register a global linux-explicit-synchronization object");
+}
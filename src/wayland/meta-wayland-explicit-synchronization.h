@@ -0,0 +1,45 @@
+/*
+ * Wayland Support
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ */
+
+#ifndef META_WAYLAND_EXPLICIT_SYNCHRONIZATION_H
+#define META_WAYLAND_EXPLICIT_SYNCHRONIZATION_H
+
+#include <glib.h>
+#include <wayland-server.h>
+
+#include "wayland/meta-wayland-types.h"
+
+void meta_wayland_init_explicit_synchronization (MetaWaylandCompositor *compositor);
+
+gboolean meta_wayland_surface_synchronization_validate (MetaWaylandSurface      *surface,
+                                                        MetaWaylandSurfaceState *pending);
+
+void meta_wayland_surface_synchronization_apply_state (MetaWaylandSurface      *surface,
+                                                       MetaWaylandSurfaceState *state);
+
+void meta_wayland_buffer_release_move (struct wl_resource **to,
+                                       struct wl_resource **from);
+
+void meta_wayland_buffer_release_send (struct wl_resource **release,
+                                       MetaWaylandBuffer   *buffer);
+
+gboolean meta_wayland_sync_file_is_signaled (int fd);
+
+#endif /* META_WAYLAND_EXPLICIT_SYNCHRONIZATION_H */
@@ -0,0 +1,311 @@
+/*
+ * Wayland Support
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ */
+
+#include "config.h"
+
+#include "wayland/meta-wayland-presentation-time.h"
+
+#include <glib.h>
+#include <time.h>
+
+#include "wayland/meta-wayland-outputs.h"
+#include "wayland/meta-wayland-private.h"
+#include "wayland/meta-wayland-surface.h"
+#include "wayland/meta-wayland-versions.h"
+
+#include "presentation-time-server-protocol.h"
+
+static void
+wp_presentation_feedback_destructor (struct wl_resource *resource)
+{
+  MetaWaylandPresentationFeedback *feedback =
+    wl_resource_get_user_data (resource);
+
+  wl_list_remove (&feedback->link);
+  if (feedback->view)
+    g_object_remove_weak_pointer (G_OBJECT (feedback->view),
+                                  (gpointer *) &feedback->view);
+  g_free (feedback);
+}
+
+static void
+discard_feedback (MetaWaylandPresentationFeedback *feedback)
+{
+  wp_presentation_feedback_send_discarded (feedback->resource);
+  wl_resource_destroy (feedback->resource);
+}
+
+void
+meta_wayland_presentation_feedback_discard_list (struct wl_list *feedbacks)
+{
+  MetaWaylandPresentationFeedback *feedback, *next;
+
+  wl_list_for_each_safe (feedback, next, feedbacks, link)
+    discard_feedback (feedback);
+}
+
+void
+meta_wayland_presentation_time_queue_surface_feedbacks (MetaWaylandSurface *surface,
+                                                        ClutterStageView   *view,
+                                                        gboolean            zero_copy)
+{
+  MetaWaylandCompositor *compositor = surface->compositor;
+  MetaWaylandPresentationFeedback *feedback;
+
+  wl_list_for_each (feedback, &surface->presentation_time.feedback_list, link)
+    {
+      feedback->zero_copy = zero_copy;
+
+      /* The feedback belongs to the frame of the view it was painted on */
+      if (view && !feedback->view)
+        {
+          feedback->view = view;
+          g_object_add_weak_pointer (G_OBJECT (view),
+                                     (gpointer *) &feedback->view);
+        }
+    }
+
+  wl_list_insert_list (&compositor->presentation_time.painted_feedbacks,
+                       &surface->presentation_time.feedback_list);
+  wl_list_init (&surface->presentation_time.feedback_list);
+}
+
+void
+meta_wayland_presentation_time_paint_finished (MetaWaylandCompositor *compositor)
+{
+  /* Whatever was painted will be shown by the next presented frame */
+  wl_list_insert_list (&compositor->presentation_time.frame_feedbacks,
+                       &compositor->presentation_time.painted_feedbacks);
+  wl_list_init (&compositor->presentation_time.painted_feedbacks);
+}
+
+void
+meta_wayland_presentation_time_forget_surface (MetaWaylandCompositor *compositor,
+                                               MetaWaylandSurface    *surface)
+{
+  MetaWaylandPresentationFeedback *feedback;
+
+  wl_list_for_each (feedback, &compositor->presentation_time.painted_feedbacks,
+                    link)
+    {
+      if (feedback->surface == surface)
+        feedback->surface = NULL;
+    }
+
+  wl_list_for_each (feedback, &compositor->presentation_time.frame_feedbacks,
+                    link)
+    {
+      if (feedback->surface == surface)
+        feedback->surface = NULL;
+    }
+}
+
+static void
+send_sync_outputs (MetaWaylandPresentationFeedback *feedback)
+{
+  struct wl_client *client = wl_resource_get_client (feedback->resource);
+  GHashTableIter iter;
+  MetaWaylandOutput *wayland_output;
+
+  if (!feedback->surface)
+    return;
+
+  g_hash_table_iter_init (&iter, feedback->surface->outputs);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &wayland_output, NULL))
+    {
+      GList *l;
+
+      for (l = wayland_output->resources; l; l = l->next)
+        {
+          struct wl_resource *output_resource = l->data;
+
+          if (wl_resource_get_client (output_resource) == client)
+            wp_presentation_feedback_send_sync_output (feedback->resource,
+                                                       output_resource);
+        }
+    }
+}
+
+static gboolean
+is_feedback_for_view (MetaWaylandPresentationFeedback *feedback,
+                      ClutterStageView                *view)
+{
+  CoglFramebuffer *onscreen;
+
+  if (view)
+    return feedback->view == view;
+
+  /*
+   * Views without an onscreen of their own don't present individually, so
+   * their feedbacks, and those not painted on any view, follow the stage.
+   */
+  if (!feedback->view)
+    return TRUE;
+
+  onscreen = clutter_stage_view_get_onscreen (feedback->view);
+  return !cogl_is_onscreen (onscreen);
+}
+
+void
+meta_wayland_presentation_time_presented (MetaWaylandCompositor *compositor,
+                                          ClutterStageView      *view,
+                                          ClutterFrameInfo      *frame_info,
+                                          int64_t                presentation_time)
+{
+  MetaWaylandPresentationFeedback *feedback, *next;
+  uint32_t flags = 0;
+  uint32_t refresh_ns = 0;
+  uint64_t time_ns;
+  uint64_t tv_sec;
+  uint32_t tv_nsec;
+
+  if (wl_list_empty (&compositor->presentation_time.frame_feedbacks))
+    return;
+
+  if (presentation_time != 0)
+    {
+      time_ns = presentation_time * 1000;
+
+      if (frame_info->flags & CLUTTER_FRAME_INFO_FLAG_HW_CLOCK)
+        flags |= (WP_PRESENTATION_FEEDBACK_KIND_HW_CLOCK |
+                  WP_PRESENTATION_FEEDBACK_KIND_HW_COMPLETION);
+    }
+  else
+    {
+      time_ns = g_get_monotonic_time () * 1000;
+    }
+
+  if (frame_info->flags & CLUTTER_FRAME_INFO_FLAG_VSYNC)
+    flags |= WP_PRESENTATION_FEEDBACK_KIND_VSYNC;
+
+  if (frame_info->refresh_rate > 0.0f)
+    refresh_ns = (uint32_t) (G_GINT64_CONSTANT (1000000000) /
+                             frame_info->refresh_rate);
+
+  tv_sec = time_ns / G_GINT64_CONSTANT (1000000000);
+  tv_nsec = time_ns % G_GINT64_CONSTANT (1000000000);
+
+  wl_list_for_each_safe (feedback, next,
+                         &compositor->presentation_time.frame_feedbacks, link)
+    {
+      uint32_t feedback_flags = flags;
+
+      if (!is_feedback_for_view (feedback, view))
+        continue;
+
+      if (frame_info->flags & CLUTTER_FRAME_INFO_FLAG_DISCARDED)
+        {
+          discard_feedback (feedback);
+          continue;
+        }
+
+      if (feedback->zero_copy)
+        feedback_flags |= WP_PRESENTATION_FEEDBACK_KIND_ZERO_COPY;
+
+      send_sync_outputs (feedback);
+      wp_presentation_feedback_send_presented (feedback->resource,
+                                               (uint32_t) (tv_sec >> 32),
+                                               (uint32_t) tv_sec,
+                                               tv_nsec,
+                                               refresh_ns,
+                                               0,
+                                               frame_info->sequence,
+                                               feedback_flags);
+      wl_resource_destroy (feedback->resource);
+    }
+}
+
+static void
+wp_presentation_destroy (struct wl_client   *client,
+                         struct wl_resource *resource)
+{
+  wl_resource_destroy (resource);
+}
+
+static void
+wp_presentation_feedback (struct wl_client   *client,
+                          struct wl_resource *resource,
+                          struct wl_resource *surface_resource,
+                          uint32_t            callback_id)
+{
+  MetaWaylandSurface *surface = wl_resource_get_user_data (surface_resource);
+  MetaWaylandSurfaceState *pending;
+  MetaWaylandPresentationFeedback *feedback;
+
+  feedback = g_new0 (MetaWaylandPresentationFeedback, 1);
+  wl_list_init (&feedback->link);
+  feedback->resource = wl_resource_create (client,
+                                           &wp_presentation_feedback_interface,
+                                           wl_resource_get_version (resource),
+                                           callback_id);
+  wl_resource_set_implementation (feedback->resource,
+                                  NULL,
+                                  feedback,
+                                  wp_presentation_feedback_destructor);
+
+  if (!surface)
+    {
+      discard_feedback (feedback);
+      return;
+    }
+
+  feedback->surface = surface;
+
+  pending = meta_wayland_surface_get_pending_state (surface);
+  wl_list_insert (&pending->presentation_feedback_list, &feedback->link);
+}
+
+static const struct wp_presentation_interface
+meta_wayland_presentation_interface = {
+  wp_presentation_destroy,
+  wp_presentation_feedback,
+};
+
+static void
+wp_presentation_bind (struct wl_client *client,
+                      void             *data,
+                      uint32_t          version,
+                      uint32_t          id)
+{
+  struct wl_resource *resource;
+
+  resource = wl_resource_create (client,
+                                 &wp_presentation_interface,
+                                 version,
+                                 id);
+  wl_resource_set_implementation (resource,
+                                  &meta_wayland_presentation_interface,
+                                  data,
+                                  NULL);
+
+  /* Presentation times are reported in terms of g_get_monotonic_time() */
+  wp_presentation_send_clock_id (resource, CLOCK_MONOTONIC);
+}
+
+void
+meta_wayland_init_presentation_time (MetaWaylandCompositor *compositor)
+{
+  if (wl_global_create (compositor->wayland_display,
+                        &wp_presentation_interface,
+                        META_WP_PRESENTATION_VERSION,
+                        compositor,
+                        wp_presentation_bind) == NULL)
+    g_error ("Failed to register a global wp_presentation object");
+}
@@ -0,0 +1,57 @@
+/*
+ * Wayland Support
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ */
+
+#ifndef META_WAYLAND_PRESENTATION_TIME_H
+#define META_WAYLAND_PRESENTATION_TIME_H
+
+#include <wayland-server.h>
+
+#include "clutter/clutter.h"
+#include "wayland/meta-wayland-types.h"
+
+typedef struct _MetaWaylandPresentationFeedback
+{
+  struct wl_list link;
+  struct wl_resource *resource;
+
+  MetaWaylandSurface *surface;
+  ClutterStageView *view;
+  gboolean zero_copy;
+} MetaWaylandPresentationFeedback;
+
+void meta_wayland_init_presentation_time (MetaWaylandCompositor *compositor);
+
+void meta_wayland_presentation_feedback_discard_list (struct wl_list *feedbacks);
+
+void meta_wayland_presentation_time_queue_surface_feedbacks (MetaWaylandSurface *surface,
+                                                             ClutterStageView   *view,
+                                                             gboolean            zero_copy);
+
+void meta_wayland_presentation_time_paint_finished (MetaWaylandCompositor *compositor);
+
+void meta_wayland_presentation_time_presented (MetaWaylandCompositor *compositor,
+                                               ClutterStageView      *view,
+                                               ClutterFrameInfo      *frame_info,
+                                               int64_t                presentation_time);
+
+void meta_wayland_presentation_time_forget_surface (MetaWaylandCompositor *compositor,
+                                                    MetaWaylandSurface    *surface);
+
+#endif /* META_WAYLAND_PRESENTATION_TIME_H */
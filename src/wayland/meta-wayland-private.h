@@ -24,6 +24,7 @@
 #include <wayland-server.h>
 
 #include "clutter/clutter.h"
+#include "core/meta-anonymous-file.h"
 #include "core/window-private.h"
 #include "meta/meta-cursor-tracker.h"
 #include "wayland/meta-wayland-pointer-gestures.h"
@@ -79,6 +80,29 @@ struct _MetaWaylandCompositor
   GHashTable *outputs;
   struct wl_list frame_callbacks;
 
+  struct {
+    /* wp_presentation_feedback of surfaces painted in the current frame */
+    struct wl_list painted_feedbacks;
+    /* ... and of the last painted frame, waiting for it to be presented */
+    struct wl_list frame_feedbacks;
+  } presentation_time;
+
+  struct {
+    /* Supported formats and modifiers, in the format table layout */
+    GArray *formats;
+    MetaAnonymousFile *format_table;
+    dev_t main_device;
+
+    /* Surface getting a scanout tranche, and the format it refers to */
+    MetaWaylandSurface *scanout_candidate;
+    int scanout_format_index;
+  } dma_buf;
+
+  struct {
+    /* /dev/udmabuf, for importing sealed pools; -1 if unavailable */
+    int udmabuf_fd;
+  } shm;
+
   MetaXWaylandManager xwayland_manager;
 
   MetaWaylandSeat *seat;
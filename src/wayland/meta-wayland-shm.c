@@ -0,0 +1,570 @@
+/*
+ * Wayland Support
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ */
+
+/*
+ * The wl_shm global, implemented here rather than with wl_display_init_shm()
+ * so that the file descriptors of sealed memfd pools can be kept around and
+ * wrapped as dma-bufs through udmabuf. The renderer then samples such
+ * buffers directly instead of copying them into a texture on every commit.
+ */
+
+#include "config.h"
+
+#include "wayland/meta-wayland-shm.h"
+
+#include <drm_fourcc.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_UDMABUF
+#include <linux/udmabuf.h>
+#include <sys/ioctl.h>
+#endif
+
+#include "wayland/meta-wayland-private.h"
+#include "wayland/meta-wayland-versions.h"
+
+typedef struct _MetaWaylandShmPool
+{
+  int ref_count;
+
+  char *data;
+  int32_t size;
+
+  /* The sealed memfd backing the pool, or -1 if it can't be imported */
+  int fd;
+
+  gboolean sigbus_data_replaced;
+} MetaWaylandShmPool;
+
+struct _MetaWaylandShmBuffer
+{
+  struct wl_resource *resource;
+  MetaWaylandShmPool *pool;
+
+  int32_t offset;
+  int32_t width;
+  int32_t height;
+  int32_t stride;
+  uint32_t format;
+};
+
+static struct sigaction old_sigbus_action;
+static gboolean sigbus_handler_installed;
+
+/* The pool being accessed, and how many times */
+static MetaWaylandShmPool *accessed_pool;
+static int access_count;
+
+static const struct wl_buffer_interface shm_buffer_implementation;
+
+static MetaWaylandShmPool *
+shm_pool_ref (MetaWaylandShmPool *pool)
+{
+  pool->ref_count++;
+  return pool;
+}
+
+static void
+shm_pool_unref (MetaWaylandShmPool *pool)
+{
+  pool->ref_count--;
+  if (pool->ref_count > 0)
+    return;
+
+  munmap (pool->data, pool->size);
+  if (pool->fd != -1)
+    close (pool->fd);
+  g_free (pool);
+}
+
+static void
+shm_buffer_destroy (struct wl_client   *client,
+                    struct wl_resource *resource)
+{
+  wl_resource_destroy (resource);
+}
+
+static const struct wl_buffer_interface shm_buffer_implementation = {
+  shm_buffer_destroy,
+};
+
+static void
+shm_buffer_destructor (struct wl_resource *resource)
+{
+  MetaWaylandShmBuffer *shm_buffer = wl_resource_get_user_data (resource);
+
+  shm_pool_unref (shm_buffer->pool);
+  g_free (shm_buffer);
+}
+
+static gboolean
+is_format_supported (uint32_t format)
+{
+  switch (format)
+    {
+    case WL_SHM_FORMAT_ARGB8888:
+    case WL_SHM_FORMAT_XRGB8888:
+      return TRUE;
+    default:
+      return FALSE;
+    }
+}
+
+static void
+shm_pool_create_buffer (struct wl_client   *client,
+                        struct wl_resource *resource,
+                        uint32_t            id,
+                        int32_t             offset,
+                        int32_t             width,
+                        int32_t             height,
+                        int32_t             stride,
+                        uint32_t            format)
+{
+  MetaWaylandShmPool *pool = wl_resource_get_user_data (resource);
+  MetaWaylandShmBuffer *shm_buffer;
+
+  if (!is_format_supported (format))
+    {
+      wl_resource_post_error (resource,
+                              WL_SHM_ERROR_INVALID_FORMAT,
+                              "invalid format 0x%x", format);
+      return;
+    }
+
+  if (offset < 0 || width <= 0 || height <= 0 || stride < width ||
+      INT32_MAX / stride <= height ||
+      offset > pool->size - stride * height)
+    {
+      wl_resource_post_error (resource,
+                              WL_SHM_ERROR_INVALID_STRIDE,
+                              "invalid width, height or stride (%dx%d, %u)",
+                              width, height, stride);
+      return;
+    }
+
+  shm_buffer = g_new0 (MetaWaylandShmBuffer, 1);
+  shm_buffer->offset = offset;
+  shm_buffer->width = width;
+  shm_buffer->height = height;
+  shm_buffer->stride = stride;
+  shm_buffer->format = format;
+
+  shm_buffer->resource = wl_resource_create (client, &wl_buffer_interface,
+                                             1, id);
+  if (!shm_buffer->resource)
+    {
+      wl_client_post_no_memory (client);
+      g_free (shm_buffer);
+      return;
+    }
+
+  shm_buffer->pool = shm_pool_ref (pool);
+  wl_resource_set_implementation (shm_buffer->resource,
+                                  &shm_buffer_implementation,
+                                  shm_buffer,
+                                  shm_buffer_destructor);
+}
+
+static void
+shm_pool_destroy (struct wl_client   *client,
+                  struct wl_resource *resource)
+{
+  wl_resource_destroy (resource);
+}
+
+static void
+shm_pool_resize (struct wl_client   *client,
+                 struct wl_resource *resource,
+                 int32_t             size)
+{
+  MetaWaylandShmPool *pool = wl_resource_get_user_data (resource);
+  void *data;
+
+  if (size < pool->size)
+    {
+      wl_resource_post_error (resource,
+                              WL_SHM_ERROR_INVALID_FD,
+                              "shrinking pool invalid");
+      return;
+    }
+
+  data = mremap (pool->data, pool->size, size, MREMAP_MAYMOVE);
+  if (data == MAP_FAILED)
+    {
+      wl_resource_post_error (resource,
+                              WL_SHM_ERROR_INVALID_FD,
+                              "failed mremap");
+      return;
+    }
+
+  pool->data = data;
+  pool->size = size;
+}
+
+static const struct wl_shm_pool_interface shm_pool_implementation = {
+  shm_pool_create_buffer,
+  shm_pool_destroy,
+  shm_pool_resize,
+};
+
+static void
+shm_pool_destructor (struct wl_resource *resource)
+{
+  MetaWaylandShmPool *pool = wl_resource_get_user_data (resource);
+
+  shm_pool_unref (pool);
+}
+
+static gboolean
+can_import_pool_fd (MetaWaylandCompositor *compositor,
+                    int                    fd)
+{
+#ifdef HAVE_UDMABUF
+  int seals;
+
+  if (compositor->shm.udmabuf_fd == -1)
+    return FALSE;
+
+  /* udmabuf only takes memfds that can't shrink under it, and that aren't
+   * sealed against writes; anything else isn't a memfd or is rejected */
+  seals = fcntl (fd, F_GET_SEALS);
+  if (seals == -1)
+    return FALSE;
+
+  return (seals & F_SEAL_SHRINK) && !(seals & F_SEAL_WRITE);
+#else
+  return FALSE;
+#endif
+}
+
+static void
+shm_create_pool (struct wl_client   *client,
+                 struct wl_resource *resource,
+                 uint32_t            id,
+                 int                 fd,
+                 int32_t             size)
+{
+  MetaWaylandCompositor *compositor = wl_resource_get_user_data (resource);
+  MetaWaylandShmPool *pool;
+  struct wl_resource *pool_resource;
+
+  if (size <= 0)
+    {
+      wl_resource_post_error (resource,
+                              WL_SHM_ERROR_INVALID_STRIDE,
+                              "invalid size (%d)", size);
+      close (fd);
+      return;
+    }
+
+  pool = g_new0 (MetaWaylandShmPool, 1);
+  pool->ref_count = 1;
+  pool->size = size;
+  pool->fd = -1;
+  pool->data = mmap (NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  if (pool->data == MAP_FAILED)
+    {
+      wl_resource_post_error (resource,
+                              WL_SHM_ERROR_INVALID_FD,
+                              "failed mmap fd %d: %s", fd, g_strerror (errno));
+      close (fd);
+      g_free (pool);
+      return;
+    }
+
+  if (can_import_pool_fd (compositor, fd))
+    pool->fd = fd;
+  else
+    close (fd);
+
+  pool_resource = wl_resource_create (client, &wl_shm_pool_interface,
+                                      wl_resource_get_version (resource), id);
+  if (!pool_resource)
+    {
+      wl_client_post_no_memory (client);
+      shm_pool_unref (pool);
+      return;
+    }
+
+  wl_resource_set_implementation (pool_resource,
+                                  &shm_pool_implementation,
+                                  pool,
+                                  shm_pool_destructor);
+}
+
+static const struct wl_shm_interface shm_implementation = {
+  shm_create_pool,
+};
+
+static void
+shm_bind (struct wl_client *client,
+          void             *data,
+          uint32_t          version,
+          uint32_t          id)
+{
+  MetaWaylandCompositor *compositor = data;
+  struct wl_resource *resource;
+
+  resource = wl_resource_create (client, &wl_shm_interface, version, id);
+  if (!resource)
+    {
+      wl_client_post_no_memory (client);
+      return;
+    }
+
+  wl_resource_set_implementation (resource, &shm_implementation,
+                                  compositor, NULL);
+
+  wl_shm_send_format (resource, WL_SHM_FORMAT_ARGB8888);
+  wl_shm_send_format (resource, WL_SHM_FORMAT_XRGB8888);
+}
+
+void
+meta_wayland_shm_init (MetaWaylandCompositor *compositor)
+{
+  compositor->shm.udmabuf_fd = -1;
+
+#ifdef HAVE_UDMABUF
+  compositor->shm.udmabuf_fd = open ("/dev/udmabuf", O_RDWR | O_CLOEXEC);
+  if (compositor->shm.udmabuf_fd == -1)
+    g_debug ("Not importing shared memory buffers: failed to open "
+             "/dev/udmabuf: %s", g_strerror (errno));
+#endif
+
+  if (!wl_global_create (compositor->wayland_display,
+                         &wl_shm_interface,
+                         META_WL_SHM_VERSION,
+                         compositor, shm_bind))
+    g_error ("Failed to register the global wl_shm");
+}
+
+MetaWaylandShmBuffer *
+meta_wayland_shm_buffer_from_resource (struct wl_resource *resource)
+{
+  if (!wl_resource_instance_of (resource, &wl_buffer_interface,
+                                &shm_buffer_implementation))
+    return NULL;
+
+  return wl_resource_get_user_data (resource);
+}
+
+int
+meta_wayland_shm_buffer_get_width (MetaWaylandShmBuffer *shm_buffer)
+{
+  return shm_buffer->width;
+}
+
+int
+meta_wayland_shm_buffer_get_height (MetaWaylandShmBuffer *shm_buffer)
+{
+  return shm_buffer->height;
+}
+
+int
+meta_wayland_shm_buffer_get_stride (MetaWaylandShmBuffer *shm_buffer)
+{
+  return shm_buffer->stride;
+}
+
+uint32_t
+meta_wayland_shm_buffer_get_format (MetaWaylandShmBuffer *shm_buffer)
+{
+  return shm_buffer->format;
+}
+
+void *
+meta_wayland_shm_buffer_get_data (MetaWaylandShmBuffer *shm_buffer)
+{
+  return shm_buffer->pool->data + shm_buffer->offset;
+}
+
+static void
+reraise_sigbus (void)
+{
+  /* Hand the fault back to the previous handler, or the default action */
+  sigaction (SIGBUS, &old_sigbus_action, NULL);
+  raise (SIGBUS);
+}
+
+static void
+sigbus_handler (int        signum,
+                siginfo_t *info,
+                void      *context)
+{
+  MetaWaylandShmPool *pool = accessed_pool;
+
+  if (!pool ||
+      (char *) info->si_addr < pool->data ||
+      (char *) info->si_addr >= pool->data + pool->size)
+    {
+      reraise_sigbus ();
+      return;
+    }
+
+  /* The client truncated the file backing the pool while it was read.
+   * Put anonymous memory in place of the mapping, so that the access can
+   * finish, and disconnect the client once it's done. */
+  pool->sigbus_data_replaced = TRUE;
+
+  if (mmap (pool->data, pool->size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS, -1, 0) == MAP_FAILED)
+    reraise_sigbus ();
+}
+
+static void
+ensure_sigbus_handler (void)
+{
+  struct sigaction new_action = {
+    .sa_sigaction = sigbus_handler,
+    .sa_flags = SA_SIGINFO | SA_NODEFER,
+  };
+
+  if (sigbus_handler_installed)
+    return;
+
+  sigemptyset (&new_action.sa_mask);
+  sigaction (SIGBUS, &new_action, &old_sigbus_action);
+
+  sigbus_handler_installed = TRUE;
+}
+
+/**
+ * meta_wayland_shm_buffer_begin_access:
+ * @shm_buffer: A #MetaWaylandShmBuffer
+ *
+ * Must be called before reading the data of @shm_buffer, so that a client
+ * truncating its pool meanwhile is disconnected instead of crashing the
+ * compositor. Only one pool may be accessed at a time.
+ */
+void
+meta_wayland_shm_buffer_begin_access (MetaWaylandShmBuffer *shm_buffer)
+{
+  g_return_if_fail (!accessed_pool || accessed_pool == shm_buffer->pool);
+
+  ensure_sigbus_handler ();
+
+  accessed_pool = shm_buffer->pool;
+  access_count++;
+}
+
+void
+meta_wayland_shm_buffer_end_access (MetaWaylandShmBuffer *shm_buffer)
+{
+  MetaWaylandShmPool *pool = shm_buffer->pool;
+
+  g_return_if_fail (access_count > 0 && accessed_pool == pool);
+
+  access_count--;
+  if (access_count == 0)
+    accessed_pool = NULL;
+
+  if (pool->sigbus_data_replaced)
+    {
+      wl_resource_post_error (shm_buffer->resource,
+                              WL_SHM_ERROR_INVALID_FD,
+                              "error accessing SHM buffer");
+      pool->sigbus_data_replaced = FALSE;
+    }
+}
+
+#ifdef HAVE_UDMABUF
+static uint32_t
+drm_format_from_shm_format (uint32_t shm_format)
+{
+  switch (shm_format)
+    {
+    case WL_SHM_FORMAT_ARGB8888:
+      return DRM_FORMAT_ARGB8888;
+    case WL_SHM_FORMAT_XRGB8888:
+      return DRM_FORMAT_XRGB8888;
+    default:
+      /* The other wl_shm formats are DRM fourcc codes */
+      return shm_format;
+    }
+}
+#endif
+
+/**
+ * meta_wayland_shm_buffer_create_dma_buf:
+ * @shm_buffer: A #MetaWaylandShmBuffer
+ *
+ * Wraps the memory of @shm_buffer in a dma-buf through udmabuf, so that it
+ * can be sampled without a copy. This only works for pools backed by a memfd
+ * sealed against shrinking, and when /dev/udmabuf can be opened.
+ *
+ * Returns: (transfer full) (nullable): A dma-buf sharing the memory of
+ * @shm_buffer, or %NULL if it can't be created
+ */
+MetaWaylandDmaBufBuffer *
+meta_wayland_shm_buffer_create_dma_buf (MetaWaylandShmBuffer *shm_buffer)
+{
+#ifdef HAVE_UDMABUF
+  MetaWaylandCompositor *compositor = meta_wayland_compositor_get_default ();
+  MetaWaylandShmPool *pool = shm_buffer->pool;
+  struct udmabuf_create create = { 0 };
+  struct stat stat_buf;
+  uint64_t page_size;
+  uint64_t start, end;
+  int fd;
+
+  if (compositor->shm.udmabuf_fd == -1 || pool->fd == -1)
+    return NULL;
+
+  /* udmabuf works on whole pages; the buffer starts within the first one */
+  page_size = sysconf (_SC_PAGESIZE);
+  start = shm_buffer->offset - shm_buffer->offset % page_size;
+  end = (uint64_t) shm_buffer->offset +
+        (uint64_t) shm_buffer->stride * shm_buffer->height;
+  end = (end + page_size - 1) / page_size * page_size;
+
+  if (fstat (pool->fd, &stat_buf) == -1 ||
+      end > (uint64_t) stat_buf.st_size)
+    return NULL;
+
+  create.memfd = pool->fd;
+  create.flags = UDMABUF_FLAGS_CLOEXEC;
+  create.offset = start;
+  create.size = end - start;
+
+  fd = ioctl (compositor->shm.udmabuf_fd, UDMABUF_CREATE, &create);
+  if (fd == -1)
+    {
+      g_debug ("Failed to create udmabuf for shared memory buffer: %s",
+               g_strerror (errno));
+      return NULL;
+    }
+
+  return meta_wayland_dma_buf_buffer_new_linear (compositor,
+                                                 fd,
+                                                 shm_buffer->width,
+                                                 shm_buffer->height,
+                                                 drm_format_from_shm_format (shm_buffer->format),
+                                                 shm_buffer->offset - start,
+                                                 shm_buffer->stride);
+#else
+  return NULL;
+#endif
+}
@@ -0,0 +1,51 @@
+/*
+ * Wayland Support
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ *
+ */
+
+#ifndef META_WAYLAND_SHM_H
+#define META_WAYLAND_SHM_H
+
+#include <wayland-server.h>
+
+#include "wayland/meta-wayland-dma-buf.h"
+#include "wayland/meta-wayland-types.h"
+
+typedef struct _MetaWaylandShmBuffer MetaWaylandShmBuffer;
+
+void meta_wayland_shm_init (MetaWaylandCompositor *compositor);
+
+MetaWaylandShmBuffer * meta_wayland_shm_buffer_from_resource (struct wl_resource *resource);
+
+int meta_wayland_shm_buffer_get_width (MetaWaylandShmBuffer *shm_buffer);
+
+int meta_wayland_shm_buffer_get_height (MetaWaylandShmBuffer *shm_buffer);
+
+int meta_wayland_shm_buffer_get_stride (MetaWaylandShmBuffer *shm_buffer);
+
+uint32_t meta_wayland_shm_buffer_get_format (MetaWaylandShmBuffer *shm_buffer);
+
+void meta_wayland_shm_buffer_begin_access (MetaWaylandShmBuffer *shm_buffer);
+
+void * meta_wayland_shm_buffer_get_data (MetaWaylandShmBuffer *shm_buffer);
+
+void meta_wayland_shm_buffer_end_access (MetaWaylandShmBuffer *shm_buffer);
+
+MetaWaylandDmaBufBuffer * meta_wayland_shm_buffer_create_dma_buf (MetaWaylandShmBuffer *shm_buffer);
+
+#endif /* META_WAYLAND_SHM_H */
@@ -119,7 +119,7 @@ is_surface_effectively_synchronized (MetaWaylandSurface *surface)
   return meta_wayland_surface_should_cache_state (surface);
 }
 
-void
+gboolean
 meta_wayland_subsurface_parent_state_applied (MetaWaylandSubsurface *subsurface)
 {
   MetaWaylandSurfaceRole *surface_role = META_WAYLAND_SURFACE_ROLE (subsurface);
@@ -127,6 +127,8 @@ meta_wayland_subsurface_parent_state_applied (MetaWaylandSubsurface *subsurface)
     META_WAYLAND_ACTOR_SURFACE (subsurface);
   MetaWaylandSurface *surface =
     meta_wayland_surface_role_get_surface (surface_role);
+  MetaWaylandSurface *subsurface_surface;
+  gboolean had_damage = FALSE;
 
   if (surface->sub.pending_pos)
     {
@@ -186,10 +188,32 @@ meta_wayland_subsurface_parent_state_applied (MetaWaylandSubsurface *subsurface)
       meta_wayland_surface_notify_subsurface_state_changed (parent);
     }
 
-  if (is_surface_effectively_synchronized (surface))
-    meta_wayland_surface_apply_cached_state (surface);
+  if (!is_surface_effectively_synchronized (surface))
+    {
+      meta_wayland_actor_surface_sync_actor_state (actor_surface);
+      return FALSE;
+    }
+
+  /* Applying the cached state syncs the actor state and handles the
+   * subsurfaces itself. */
+  if (surface->has_cached_commit)
+    return meta_wayland_surface_apply_cached_subsurface_state (surface);
 
+  /* Nothing was committed to this surface, but its actor still needs to
+   * follow any position change of its ancestors, and its own subsurfaces
+   * may have cached commits waiting for this parent state. */
   meta_wayland_actor_surface_sync_actor_state (actor_surface);
+
+  META_WAYLAND_SURFACE_FOREACH_SUBSURFACE (surface, subsurface_surface)
+    {
+      MetaWaylandSubsurface *child;
+
+      child = META_WAYLAND_SUBSURFACE (subsurface_surface->role);
+      if (meta_wayland_subsurface_parent_state_applied (child))
+        had_damage = TRUE;
+    }
+
+  return had_damage;
 }
 
 void
@@ -29,7 +29,7 @@ G_DECLARE_FINAL_TYPE (MetaWaylandSubsurface,
                       META, WAYLAND_SUBSURFACE,
                       MetaWaylandActorSurface)
 
-void meta_wayland_subsurface_parent_state_applied (MetaWaylandSubsurface *subsurface);
+gboolean meta_wayland_subsurface_parent_state_applied (MetaWaylandSubsurface *subsurface);
 
 void meta_wayland_subsurface_union_geometry (MetaWaylandSubsurface *subsurface,
                                              int                    parent_x,
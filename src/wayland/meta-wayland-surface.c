@@ -24,7 +24,9 @@
 
 #include "wayland/meta-wayland-surface.h"
 
+#include <glib-unix.h>
 #include <gobject/gvaluecollector.h>
+#include <unistd.h>
 #include <wayland-server.h>
 
 #include "backends/meta-cursor-tracker-private.h"
@@ -41,14 +43,17 @@
 #include "wayland/meta-wayland-actor-surface.h"
 #include "wayland/meta-wayland-buffer.h"
 #include "wayland/meta-wayland-data-device.h"
+#include "wayland/meta-wayland-explicit-synchronization.h"
 #include "wayland/meta-wayland-gtk-shell.h"
 #include "wayland/meta-wayland-keyboard.h"
 #include "wayland/meta-wayland-legacy-xdg-shell.h"
 #include "wayland/meta-wayland-outputs.h"
 #include "wayland/meta-wayland-pointer.h"
+#include "wayland/meta-wayland-presentation-time.h"
 #include "wayland/meta-wayland-private.h"
 #include "wayland/meta-wayland-region.h"
 #include "wayland/meta-wayland-seat.h"
+#include "wayland/meta-wayland-shm.h"
 #include "wayland/meta-wayland-subsurface.h"
 #include "wayland/meta-wayland-viewporter.h"
 #include "wayland/meta-wayland-wl-shell.h"
@@ -132,6 +137,7 @@ meta_wayland_buffer_ref_new (void)
 
   buffer_ref = g_new0 (MetaWaylandBufferRef, 1);
   g_ref_count_init (&buffer_ref->ref_count);
+  buffer_ref->acquire_fence_fd = -1;
 
   return buffer_ref;
 }
@@ -149,6 +155,9 @@ meta_wayland_buffer_ref_unref (MetaWaylandBufferRef *buffer_ref)
   if (g_ref_count_dec (&buffer_ref->ref_count))
     {
       g_warn_if_fail (buffer_ref->use_count == 0);
+      meta_wayland_buffer_release_send (&buffer_ref->release, NULL);
+      if (buffer_ref->acquire_fence_fd >= 0)
+        close (buffer_ref->acquire_fence_fd);
       g_clear_object (&buffer_ref->buffer);
       g_free (buffer_ref);
     }
@@ -173,7 +182,18 @@ meta_wayland_buffer_ref_dec_use_count (MetaWaylandBufferRef *buffer_ref)
 
   buffer_ref->use_count--;
 
-  if (buffer_ref->use_count == 0 && buffer->resource)
+  if (buffer_ref->use_count > 0)
+    return;
+
+  meta_wayland_buffer_release_send (&buffer_ref->release, buffer);
+
+  if (buffer_ref->acquire_fence_fd >= 0)
+    {
+      close (buffer_ref->acquire_fence_fd);
+      buffer_ref->acquire_fence_fd = -1;
+    }
+
+  if (buffer->resource)
     wl_buffer_send_release (buffer->resource);
 }
 
@@ -317,7 +337,8 @@ get_buffer_height (MetaWaylandSurface *surface)
 static void
 surface_process_damage (MetaWaylandSurface *surface,
                         cairo_region_t     *surface_region,
-                        cairo_region_t     *buffer_region)
+                        cairo_region_t     *buffer_region,
+                        gboolean            is_texture_up_to_date)
 {
   MetaWaylandBuffer *buffer = meta_wayland_surface_get_buffer (surface);
   cairo_rectangle_int_t surface_rect;
@@ -385,7 +406,8 @@ surface_process_damage (MetaWaylandSurface *surface,
 
   cairo_region_intersect_rectangle (buffer_region, &buffer_rect);
 
-  meta_wayland_buffer_process_damage (buffer, surface->texture, buffer_region);
+  if (!is_texture_up_to_date)
+    meta_wayland_buffer_process_damage (buffer, surface->texture, buffer_region);
 
   actor = meta_wayland_surface_get_actor (surface);
   if (actor)
@@ -462,6 +484,10 @@ meta_wayland_surface_state_set_default (MetaWaylandSurfaceState *state)
   state->surface_damage = cairo_region_create ();
   state->buffer_damage = cairo_region_create ();
   wl_list_init (&state->frame_callback_list);
+  wl_list_init (&state->presentation_feedback_list);
+
+  state->acquire_fence_fd = -1;
+  state->buffer_release = NULL;
 
   state->has_new_geometry = FALSE;
   state->has_acked_configure_serial = FALSE;
@@ -488,6 +514,12 @@ meta_wayland_surface_state_clear (MetaWaylandSurfaceState *state)
 
   wl_list_for_each_safe (cb, next, &state->frame_callback_list, link)
     wl_resource_destroy (cb->resource);
+
+  meta_wayland_presentation_feedback_discard_list (&state->presentation_feedback_list);
+
+  if (state->acquire_fence_fd >= 0)
+    close (state->acquire_fence_fd);
+  meta_wayland_buffer_release_send (&state->buffer_release, NULL);
 }
 
 static void
@@ -515,6 +547,21 @@ meta_wayland_surface_state_merge_into (MetaWaylandSurfaceState *from,
   wl_list_insert_list (&to->frame_callback_list, &from->frame_callback_list);
   wl_list_init (&from->frame_callback_list);
 
+  wl_list_insert_list (&to->presentation_feedback_list,
+                       &from->presentation_feedback_list);
+  wl_list_init (&from->presentation_feedback_list);
+
+  if (from->acquire_fence_fd >= 0)
+    {
+      if (to->acquire_fence_fd >= 0)
+        close (to->acquire_fence_fd);
+      to->acquire_fence_fd = from->acquire_fence_fd;
+      from->acquire_fence_fd = -1;
+    }
+
+  meta_wayland_buffer_release_move (&to->buffer_release,
+                                    &from->buffer_release);
+
   cairo_region_union (to->surface_damage, from->surface_damage);
   cairo_region_union (to->buffer_damage, from->buffer_damage);
 
@@ -641,12 +688,19 @@ meta_wayland_surface_cache_pending_frame_callbacks (MetaWaylandSurface      *sur
   wl_list_init (&pending->frame_callback_list);
 }
 
-static void
-meta_wayland_surface_apply_state (MetaWaylandSurface      *surface,
-                                  MetaWaylandSurfaceState *state)
+/*
+ * Applies the state of the surface and of its synchronized subsurfaces as
+ * one transaction. Subsurfaces that had nothing committed since the last
+ * time are left untouched, and the damage is only reported to the caller,
+ * so that the toplevel is notified once for the whole tree.
+ */
+static gboolean
+apply_state_tree (MetaWaylandSurface      *surface,
+                  MetaWaylandSurfaceState *state)
 {
   MetaWaylandSurface *subsurface_surface;
   gboolean had_damage = FALSE;
+  gboolean is_texture_up_to_date = FALSE;
 
   g_signal_emit (surface, surface_signals[SURFACE_PRE_STATE_APPLIED], 0);
 
@@ -687,6 +741,12 @@ meta_wayland_surface_apply_state (MetaWaylandSurface      *surface,
       if (state->buffer)
         {
           GError *error = NULL;
+          CoglTexture *old_texture;
+
+          /* Hold on to the old texture, so that a replacement can't end up
+           * with the same address. */
+          old_texture = surface->texture ? cogl_object_ref (surface->texture)
+                                         : NULL;
 
           if (!meta_wayland_buffer_attach (state->buffer,
                                            &surface->texture,
@@ -698,8 +758,17 @@ meta_wayland_surface_apply_state (MetaWaylandSurface      *surface,
                                       wl_resource_get_id (surface->resource),
                                       error->message);
               g_error_free (error);
+              cogl_clear_object (&old_texture);
               goto cleanup;
             }
+
+          /* A texture replaced while attaching was created from the whole
+           * buffer content, so the damage doesn't need to be copied into it
+           * once more. */
+          is_texture_up_to_date = surface->texture != old_texture;
+          cogl_clear_object (&old_texture);
+
+          meta_wayland_surface_synchronization_apply_state (surface, state);
         }
       else
         {
@@ -707,12 +776,15 @@ meta_wayland_surface_apply_state (MetaWaylandSurface      *surface,
         }
 
       /* If the newly attached buffer is going to be accessed directly without
-       * making a copy, such as an EGL buffer, mark it as in-use don't release
-       * it until is replaced by a subsequent wl_surface.commit or when the
-       * wl_surface is destroyed.
+       * making a copy, such as an EGL buffer or a shared memory buffer
+       * imported as a dma-buf, mark it as in-use don't release it until is
+       * replaced by a subsequent wl_surface.commit or when the wl_surface is
+       * destroyed.
        */
-      surface->buffer_held = (state->buffer &&
-                              !wl_shm_buffer_get (state->buffer->resource));
+      surface->buffer_held =
+        (state->buffer &&
+         (!meta_wayland_shm_buffer_from_resource (state->buffer->resource) ||
+          state->buffer->shm.texture));
     }
 
   if (state->scale > 0)
@@ -742,7 +814,8 @@ meta_wayland_surface_apply_state (MetaWaylandSurface      *surface,
     {
       surface_process_damage (surface,
                               state->surface_damage,
-                              state->buffer_damage);
+                              state->buffer_damage,
+                              is_texture_up_to_date);
       had_damage = TRUE;
     }
 
@@ -791,6 +864,14 @@ meta_wayland_surface_apply_state (MetaWaylandSurface      *surface,
         }
     }
 
+  /* Content replaced before it was painted will never be presented */
+  if (state->newly_attached)
+    meta_wayland_presentation_feedback_discard_list (&surface->presentation_time.feedback_list);
+
+  wl_list_insert_list (&surface->presentation_time.feedback_list,
+                       &state->presentation_feedback_list);
+  wl_list_init (&state->presentation_feedback_list);
+
 cleanup:
   /* If we have a buffer that we are not using, decrease the use count so it may
    * be released if no-one else has a use-reference to it.
@@ -810,33 +891,52 @@ cleanup:
       MetaWaylandSubsurface *subsurface;
 
       subsurface = META_WAYLAND_SUBSURFACE (subsurface_surface->role);
-      meta_wayland_subsurface_parent_state_applied (subsurface);
+      if (meta_wayland_subsurface_parent_state_applied (subsurface))
+        had_damage = TRUE;
     }
 
-  if (had_damage)
-    {
-      MetaWindow *toplevel_window;
+  return had_damage;
+}
 
-      toplevel_window = meta_wayland_surface_get_toplevel_window (surface);
-      if (toplevel_window)
-        {
-          MetaWindowActor *toplevel_window_actor;
+static void
+notify_toplevel_damaged (MetaWaylandSurface *surface)
+{
+  MetaWindow *toplevel_window;
+  MetaWindowActor *toplevel_window_actor;
 
-          toplevel_window_actor =
-            meta_window_actor_from_window (toplevel_window);
-          if (toplevel_window_actor)
-            meta_window_actor_notify_damaged (toplevel_window_actor);
-        }
-    }
+  toplevel_window = meta_wayland_surface_get_toplevel_window (surface);
+  if (!toplevel_window)
+    return;
+
+  toplevel_window_actor = meta_window_actor_from_window (toplevel_window);
+  if (toplevel_window_actor)
+    meta_window_actor_notify_damaged (toplevel_window_actor);
+}
+
+static void
+meta_wayland_surface_apply_state (MetaWaylandSurface      *surface,
+                                  MetaWaylandSurfaceState *state)
+{
+  if (apply_state_tree (surface, state))
+    notify_toplevel_damaged (surface);
+}
+
+gboolean
+meta_wayland_surface_apply_cached_subsurface_state (MetaWaylandSurface *surface)
+{
+  if (!surface->cached_state || !surface->has_cached_commit)
+    return FALSE;
+
+  surface->has_cached_commit = FALSE;
+
+  return apply_state_tree (surface, surface->cached_state);
 }
 
 void
 meta_wayland_surface_apply_cached_state (MetaWaylandSurface *surface)
 {
-  if (!surface->cached_state)
-    return;
-
-  meta_wayland_surface_apply_state (surface, surface->cached_state);
+  if (meta_wayland_surface_apply_cached_subsurface_state (surface))
+    notify_toplevel_damaged (surface);
 }
 
 MetaWaylandSurfaceState *
@@ -854,6 +954,93 @@ meta_wayland_surface_ensure_cached_state (MetaWaylandSurface *surface)
   return surface->cached_state;
 }
 
+/* Returns a file descriptor that becomes readable once the buffer of @state
+ * can be sampled without waiting for the client's GPU work, or -1 if it
+ * already can. */
+static int
+get_state_busy_fd (MetaWaylandSurfaceState *state)
+{
+  MetaWaylandDmaBufBuffer *dma_buf;
+
+  if (!state->newly_attached || !state->buffer)
+    return -1;
+
+  if (state->acquire_fence_fd >= 0)
+    {
+      if (meta_wayland_sync_file_is_signaled (state->acquire_fence_fd))
+        return -1;
+
+      return state->acquire_fence_fd;
+    }
+
+  if (state->buffer->type != META_WAYLAND_BUFFER_TYPE_DMA_BUF)
+    return -1;
+
+  dma_buf = meta_wayland_dma_buf_from_buffer (state->buffer);
+  if (!dma_buf)
+    return -1;
+
+  return meta_wayland_dma_buf_get_busy_fd (dma_buf);
+}
+
+/* Called once get_state_busy_fd() found the buffer ready, i.e. once any
+ * acquire fence has signaled, so that no GPU wait is issued for it. */
+static void
+clear_signaled_acquire_fence (MetaWaylandSurfaceState *state)
+{
+  if (state->acquire_fence_fd < 0)
+    return;
+
+  close (state->acquire_fence_fd);
+  state->acquire_fence_fd = -1;
+}
+
+static void process_commit_queue (MetaWaylandSurface *surface);
+
+static gboolean
+on_commit_buffer_ready (int          fd,
+                        GIOCondition condition,
+                        gpointer     user_data)
+{
+  MetaWaylandSurface *surface = user_data;
+
+  surface->commit_queue.source_id = 0;
+  process_commit_queue (surface);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+process_commit_queue (MetaWaylandSurface *surface)
+{
+  MetaWaylandSurfaceState *state;
+
+  while ((state = g_queue_peek_head (&surface->commit_queue.states)))
+    {
+      int busy_fd;
+
+      busy_fd = get_state_busy_fd (state);
+      if (busy_fd >= 0)
+        {
+          surface->commit_queue.source_id =
+            g_unix_fd_add (busy_fd, G_IO_IN, on_commit_buffer_ready, surface);
+          return;
+        }
+
+      g_queue_pop_head (&surface->commit_queue.states);
+      clear_signaled_acquire_fence (state);
+      meta_wayland_surface_apply_state (surface, state);
+      g_object_unref (state);
+    }
+}
+
+static void
+clear_commit_queue (MetaWaylandSurface *surface)
+{
+  g_clear_handle_id (&surface->commit_queue.source_id, g_source_remove);
+  g_queue_clear_full (&surface->commit_queue.states, g_object_unref);
+}
+
 static void
 meta_wayland_surface_commit (MetaWaylandSurface *surface)
 {
@@ -866,6 +1053,9 @@ meta_wayland_surface_commit (MetaWaylandSurface *surface)
       !meta_wayland_buffer_is_realized (pending->buffer))
     meta_wayland_buffer_realize (pending->buffer);
 
+  if (!meta_wayland_surface_synchronization_validate (surface, pending))
+    return;
+
   /*
    * If this is a sub-surface and it is in effective synchronous mode, only
    * cache the pending surface state until either one of the following two
@@ -880,9 +1070,26 @@ meta_wayland_surface_commit (MetaWaylandSurface *surface)
 
       cached_state = meta_wayland_surface_ensure_cached_state (surface);
       meta_wayland_surface_state_merge_into (pending, cached_state);
+      surface->has_cached_commit = TRUE;
+    }
+  else if (!g_queue_is_empty (&surface->commit_queue.states) ||
+           get_state_busy_fd (pending) >= 0)
+    {
+      MetaWaylandSurfaceState *queued_state;
+
+      /* Keep showing the current content rather than having the next frame
+       * of every other surface wait for this client's GPU work. Commits are
+       * applied in order, so later ones queue up behind it. */
+      queued_state = g_object_new (META_TYPE_WAYLAND_SURFACE_STATE, NULL);
+      meta_wayland_surface_state_merge_into (pending, queued_state);
+      g_queue_push_tail (&surface->commit_queue.states, queued_state);
+
+      if (!surface->commit_queue.source_id)
+        process_commit_queue (surface);
     }
   else
     {
+      clear_signaled_acquire_fence (pending);
       meta_wayland_surface_apply_state (surface, surface->pending_state);
     }
 }
@@ -1350,6 +1557,7 @@ wl_surface_destructor (struct wl_resource *resource)
   g_clear_pointer (&surface->texture, cogl_object_unref);
   g_clear_pointer (&surface->buffer_ref, meta_wayland_buffer_ref_unref);
 
+  clear_commit_queue (surface);
   g_clear_object (&surface->cached_state);
   g_clear_object (&surface->pending_state);
 
@@ -1360,6 +1568,10 @@ wl_surface_destructor (struct wl_resource *resource)
 
   meta_wayland_compositor_destroy_frame_callbacks (compositor, surface);
 
+  meta_wayland_presentation_feedback_discard_list (&surface->presentation_time.feedback_list);
+  meta_wayland_presentation_time_forget_surface (compositor, surface);
+  meta_wayland_dma_buf_forget_surface (compositor, surface);
+
   g_hash_table_foreach (surface->outputs,
                         surface_output_disconnect_signals,
                         surface);
@@ -1413,6 +1625,8 @@ meta_wayland_surface_create (MetaWaylandCompositor *compositor,
                                   wl_surface_destructor);
 
   wl_list_init (&surface->pending_frame_callback_list);
+  wl_list_init (&surface->presentation_time.feedback_list);
+  wl_list_init (&surface->dma_buf_feedback.resources);
 
   surface->outputs = g_hash_table_new (NULL, NULL);
   surface->shortcut_inhibited_seats = g_hash_table_new (NULL, NULL);
@@ -2019,6 +2233,11 @@ meta_wayland_surface_try_acquire_scanout (MetaWaylandSurface *surface,
   if (surface->buffer_ref->use_count == 0)
     return NULL;
 
+  /* Scanout would not wait for the client to finish rendering */
+  if (surface->buffer_ref->acquire_fence_fd >= 0 &&
+      !meta_wayland_sync_file_is_signaled (surface->buffer_ref->acquire_fence_fd))
+    return NULL;
+
   scanout = meta_wayland_buffer_try_acquire_scanout (surface->buffer_ref->buffer,
                                                      onscreen);
   if (!scanout)
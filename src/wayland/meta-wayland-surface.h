@@ -97,6 +97,13 @@ struct _MetaWaylandSurfaceState
   /* wl_surface.frame */
   struct wl_list frame_callback_list;
 
+  /* wp_presentation.feedback */
+  struct wl_list presentation_feedback_list;
+
+  /* zwp_linux_surface_synchronization_v1 */
+  int acquire_fence_fd;
+  struct wl_resource *buffer_release;
+
   MetaRectangle new_geometry;
   gboolean has_new_geometry;
 
@@ -141,6 +148,10 @@ typedef struct _MetaWaylandBufferRef
   grefcount ref_count;
   MetaWaylandBuffer *buffer;
   unsigned int use_count;
+
+  /* zwp_linux_surface_synchronization_v1 */
+  int acquire_fence_fd;
+  struct wl_resource *release;
 } MetaWaylandBufferRef;
 
 struct _MetaWaylandSurface
@@ -186,6 +197,15 @@ struct _MetaWaylandSurface
   MetaWaylandSurfaceState *pending_state;
   /* State cached due to inter-surface synchronization such. */
   MetaWaylandSurfaceState *cached_state;
+  /* Whether anything was committed into cached_state since it was applied. */
+  gboolean has_cached_commit;
+
+  /* Committed state waiting for the GPU to finish rendering its buffer,
+   * oldest first. */
+  struct {
+    GQueue states;
+    guint source_id;
+  } commit_queue;
 
   /* Extension resources. */
   struct wl_resource *wl_subsurface;
@@ -229,6 +249,23 @@ struct _MetaWaylandSurface
 
   /* table of seats for which shortcuts are inhibited */
   GHashTable *shortcut_inhibited_seats;
+
+  /* wp_presentation */
+  struct {
+    /* Feedback of the last committed content, until it is painted */
+    struct wl_list feedback_list;
+  } presentation_time;
+
+  /* zwp_linux_surface_synchronization_v1 */
+  struct {
+    struct wl_resource *resource;
+    gulong destroy_handler_id;
+  } synchronization;
+
+  /* zwp_linux_dmabuf_feedback_v1 */
+  struct {
+    struct wl_list resources;
+  } dma_buf_feedback;
 };
 
 void                meta_wayland_shell_init     (MetaWaylandCompositor *compositor);
@@ -246,6 +283,8 @@ MetaWaylandSurfaceState *
 
 void                meta_wayland_surface_apply_cached_state (MetaWaylandSurface *surface);
 
+gboolean            meta_wayland_surface_apply_cached_subsurface_state (MetaWaylandSurface *surface);
+
 gboolean            meta_wayland_surface_is_effectively_synchronized (MetaWaylandSurface *surface);
 
 gboolean            meta_wayland_surface_assign_role (MetaWaylandSurface *surface,
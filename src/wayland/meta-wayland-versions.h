@@ -29,13 +29,12 @@
 #define META_WL_CALLBACK_VERSION 1
 
 /* Not handled by mutter-wayland directly */
-/* #define META_WL_SHM_VERSION        1 */
-/* #define META_WL_SHM_POOL_VERSION   1 */
 /* #define META_WL_DRM_VERSION        1 */
 /* #define META_WL_BUFFER_VERSION     1 */
 
 /* Global/master objects (version exported by wl_registry and negotiated through bind) */
 #define META_WL_COMPOSITOR_VERSION          4
+#define META_WL_SHM_VERSION                 1
 #define META_WL_DATA_DEVICE_MANAGER_VERSION 3
 #define META_XDG_WM_BASE_VERSION            3
 #define META_ZXDG_SHELL_V6_VERSION          1
@@ -48,12 +47,14 @@
 #define META_ZWP_POINTER_GESTURES_V1_VERSION    1
 #define META_ZXDG_EXPORTER_V1_VERSION       1
 #define META_ZXDG_IMPORTER_V1_VERSION       1
-#define META_ZWP_LINUX_DMABUF_V1_VERSION    3
+#define META_ZWP_LINUX_DMABUF_V1_VERSION    4
 #define META_ZWP_KEYBOARD_SHORTCUTS_INHIBIT_V1_VERSION 1
 #define META_ZXDG_OUTPUT_V1_VERSION         3
 #define META_ZWP_XWAYLAND_KEYBOARD_GRAB_V1_VERSION 1
 #define META_GTK_TEXT_INPUT_VERSION         1
 #define META_ZWP_TEXT_INPUT_V3_VERSION      1
 #define META_WP_VIEWPORTER_VERSION          1
+#define META_WP_PRESENTATION_VERSION        1
+#define META_ZWP_LINUX_EXPLICIT_SYNCHRONIZATION_V1_VERSION 2
 
 #endif
@@ -45,6 +45,8 @@ struct _MetaWaylandWindowConfiguration
 
   MetaGravity gravity;
   MetaMoveResizeFlags flags;
+
+  int64_t sent_time_us;
 };
 
 MetaWaylandWindowConfiguration * meta_wayland_window_configuration_new (int                 x,
@@ -34,12 +34,15 @@
 #include "wayland/meta-wayland-data-device.h"
 #include "wayland/meta-wayland-dma-buf.h"
 #include "wayland/meta-wayland-egl-stream.h"
+#include "wayland/meta-wayland-explicit-synchronization.h"
 #include "wayland/meta-wayland-inhibit-shortcuts-dialog.h"
 #include "wayland/meta-wayland-inhibit-shortcuts.h"
 #include "wayland/meta-wayland-outputs.h"
+#include "wayland/meta-wayland-presentation-time.h"
 #include "wayland/meta-wayland-private.h"
 #include "wayland/meta-wayland-region.h"
 #include "wayland/meta-wayland-seat.h"
+#include "wayland/meta-wayland-shm.h"
 #include "wayland/meta-wayland-subsurface.h"
 #include "wayland/meta-wayland-tablet-manager.h"
 #include "wayland/meta-wayland-xdg-foreign.h"
@@ -203,6 +206,8 @@ meta_wayland_compositor_paint_finished (MetaWaylandCompositor *compositor)
       wl_callback_send_done (callback->resource, current_time / 1000);
       wl_resource_destroy (callback->resource);
     }
+
+  meta_wayland_presentation_time_paint_finished (compositor);
 }
 
 /**
@@ -310,6 +315,8 @@ static void
 meta_wayland_compositor_init (MetaWaylandCompositor *compositor)
 {
   wl_list_init (&compositor->frame_callbacks);
+  wl_list_init (&compositor->presentation_time.painted_feedbacks);
+  wl_list_init (&compositor->presentation_time.frame_feedbacks);
 
   compositor->scheduled_surface_associations = g_hash_table_new (NULL, NULL);
 
@@ -391,7 +398,7 @@ meta_wayland_init (void)
 			 compositor, compositor_bind))
     g_error ("Failed to register the global wl_compositor");
 
-  wl_display_init_shm (compositor->wayland_display);
+  meta_wayland_shm_init (compositor);
 
   meta_wayland_outputs_init (compositor);
   meta_wayland_data_device_manager_init (compositor);
@@ -406,10 +413,12 @@ meta_wayland_init (void)
   meta_wayland_pointer_constraints_init (compositor);
   meta_wayland_xdg_foreign_init (compositor);
   meta_wayland_dma_buf_init (compositor);
+  meta_wayland_init_explicit_synchronization (compositor);
   meta_wayland_keyboard_shortcuts_inhibit_init (compositor);
   meta_wayland_surface_inhibit_shortcuts_dialog_init ();
   meta_wayland_text_input_init (compositor);
   meta_wayland_gtk_text_input_init (compositor);
+  meta_wayland_init_presentation_time (compositor);
 
   /* Xwayland specific protocol, needs to be filtered out for all other clients */
   if (meta_xwayland_grab_keyboard_init (compositor))
@@ -44,6 +44,11 @@
 #include "wayland/meta-wayland-window-configuration.h"
 #include "wayland/meta-wayland-xdg-shell.h"
 
+/* Bounds of how long to wait for a client to ack and commit a configure
+ * during an interactive resize before sending it a newer size anyway. */
+#define MIN_RESIZE_CONFIGURE_INTERVAL_US (16 * G_TIME_SPAN_MILLISECOND)
+#define MAX_RESIZE_CONFIGURE_INTERVAL_US (200 * G_TIME_SPAN_MILLISECOND)
+
 struct _MetaWindowWayland
 {
   MetaWindow parent;
@@ -60,6 +65,13 @@ struct _MetaWindowWayland
   int last_sent_rel_x;
   int last_sent_rel_y;
 
+  struct {
+    MetaWaylandWindowConfiguration *deferred_configuration;
+    guint timeout_id;
+    /* Smoothed time between sending a configure and its acked commit */
+    int64_t latency_us;
+  } resize_pacing;
+
   gboolean has_been_shown;
 };
 
@@ -113,9 +125,19 @@ meta_window_wayland_manage (MetaWindow *window)
   meta_wayland_surface_window_managed (window->surface, window);
 }
 
+static void
+clear_deferred_configuration (MetaWindowWayland *wl_window)
+{
+  g_clear_handle_id (&wl_window->resize_pacing.timeout_id, g_source_remove);
+  g_clear_pointer (&wl_window->resize_pacing.deferred_configuration,
+                   meta_wayland_window_configuration_free);
+}
+
 static void
 meta_window_wayland_unmanage (MetaWindow *window)
 {
+  clear_deferred_configuration (META_WINDOW_WAYLAND (window));
+
   {
     meta_stack_tracker_record_remove (window->display->stack_tracker,
                                       window->stamp,
@@ -170,12 +192,110 @@ meta_window_wayland_configure (MetaWindowWayland              *wl_window,
 {
   MetaWindow *window = META_WINDOW (wl_window);
 
+  /* Anything still deferred is superseded by this configuration. */
+  clear_deferred_configuration (wl_window);
+
+  configuration->sent_time_us = g_get_monotonic_time ();
   meta_wayland_surface_configure_notify (window->surface, configuration);
 
   wl_window->pending_configurations =
     g_list_prepend (wl_window->pending_configurations, configuration);
 }
 
+static void
+flush_deferred_configuration (MetaWindowWayland *wl_window)
+{
+  MetaWaylandWindowConfiguration *configuration;
+
+  configuration = g_steal_pointer (&wl_window->resize_pacing.deferred_configuration);
+  if (configuration)
+    meta_window_wayland_configure (wl_window, configuration);
+}
+
+static gboolean
+deferred_configuration_timeout (gpointer user_data)
+{
+  MetaWindowWayland *wl_window = user_data;
+
+  wl_window->resize_pacing.timeout_id = 0;
+  flush_deferred_configuration (wl_window);
+
+  return G_SOURCE_REMOVE;
+}
+
+static int64_t
+get_resize_configure_interval (MetaWindowWayland *wl_window)
+{
+  return CLAMP (2 * wl_window->resize_pacing.latency_us,
+                MIN_RESIZE_CONFIGURE_INTERVAL_US,
+                MAX_RESIZE_CONFIGURE_INTERVAL_US);
+}
+
+/*
+ * During interactive resizes, only keep one configure in flight at a time,
+ * so that the configure rate follows how fast the client actually acks and
+ * commits. Sizes coming in meanwhile replace each other, and the newest one
+ * is sent as soon as the client catches up, or when it takes much longer
+ * than it usually does.
+ */
+static gboolean
+maybe_defer_resize_configuration (MetaWindowWayland              *wl_window,
+                                  MetaWaylandWindowConfiguration *configuration)
+{
+  MetaWindow *window = META_WINDOW (wl_window);
+  MetaDisplay *display = window->display;
+  MetaWaylandWindowConfiguration *last_configuration;
+  int64_t elapsed_us;
+  int64_t interval_us;
+
+  if (!meta_grab_op_is_resizing (display->grab_op) ||
+      display->grab_window != window)
+    return FALSE;
+
+  if (configuration->flags & META_MOVE_RESIZE_STATE_CHANGED)
+    return FALSE;
+
+  if (!wl_window->pending_configurations)
+    return FALSE;
+
+  last_configuration = wl_window->pending_configurations->data;
+  elapsed_us = g_get_monotonic_time () - last_configuration->sent_time_us;
+  interval_us = get_resize_configure_interval (wl_window);
+  if (elapsed_us >= interval_us)
+    return FALSE;
+
+  g_clear_pointer (&wl_window->resize_pacing.deferred_configuration,
+                   meta_wayland_window_configuration_free);
+  wl_window->resize_pacing.deferred_configuration = configuration;
+
+  if (!wl_window->resize_pacing.timeout_id)
+    {
+      wl_window->resize_pacing.timeout_id =
+        g_timeout_add ((interval_us - elapsed_us) / G_TIME_SPAN_MILLISECOND + 1,
+                       deferred_configuration_timeout,
+                       wl_window);
+      g_source_set_name_by_id (wl_window->resize_pacing.timeout_id,
+                               "[mutter] deferred_configuration_timeout");
+    }
+
+  return TRUE;
+}
+
+static void
+update_resize_latency (MetaWindowWayland              *wl_window,
+                       MetaWaylandWindowConfiguration *acked_configuration)
+{
+  int64_t latency_us;
+
+  latency_us = g_get_monotonic_time () - acked_configuration->sent_time_us;
+
+  if (wl_window->resize_pacing.latency_us)
+    wl_window->resize_pacing.latency_us =
+      (3 * wl_window->resize_pacing.latency_us + latency_us) / 4;
+  else
+    wl_window->resize_pacing.latency_us = latency_us;
+}
+
 static void
 surface_state_changed (MetaWindow *window)
 {
@@ -186,6 +306,8 @@ surface_state_changed (MetaWindow *window)
   if (window->unmanaging)
     return;
 
+  /* A deferred size is already in last_sent_*, and sending this
+   * configuration supersedes it. */
   configuration =
     meta_wayland_window_configuration_new (wl_window->last_sent_x,
                                            wl_window->last_sent_y,
@@ -387,7 +509,8 @@ meta_window_wayland_move_resize_internal (MetaWindow                *window,
                                                    configured_height,
                                                    flags,
                                                    gravity);
-          meta_window_wayland_configure (wl_window, configuration);
+          if (!maybe_defer_resize_configuration (wl_window, configuration))
+            meta_window_wayland_configure (wl_window, configuration);
           can_move_now = FALSE;
         }
       else
@@ -732,6 +855,7 @@ meta_window_wayland_finalize (GObject *object)
 {
   MetaWindowWayland *wl_window = META_WINDOW_WAYLAND (object);
 
+  clear_deferred_configuration (wl_window);
   g_list_free_full (wl_window->pending_configurations,
                     (GDestroyNotify) meta_wayland_window_configuration_free);
 
@@ -920,6 +1044,8 @@ meta_window_wayland_finish_move_resize (MetaWindow              *window,
   flags = META_MOVE_RESIZE_WAYLAND_FINISH_MOVE_RESIZE;
 
   acked_configuration = acquire_acked_configuration (wl_window, pending);
+  if (acked_configuration)
+    update_resize_latency (wl_window, acked_configuration);
 
   /* x/y are ignored when we're doing interactive resizing */
   is_window_being_resized = (meta_grab_op_is_resizing (display->grab_op) &&
@@ -982,6 +1108,11 @@ meta_window_wayland_finish_move_resize (MetaWindow              *window,
     gravity = META_GRAVITY_STATIC;
   meta_window_move_resize_internal (window, flags, gravity, rect);
 
+  /* The client caught up with everything sent so far; give it the newest
+   * size right away. */
+  if (acked_configuration && !wl_window->pending_configurations)
+    flush_deferred_configuration (wl_window);
+
   g_clear_pointer (&acked_configuration, meta_wayland_window_configuration_free);
 }
 
@@ -45,6 +45,7 @@
 #include "x11/meta-x11-selection-private.h"
 #include "x11/meta-x11-selection-input-stream-private.h"
 #include "x11/meta-x11-selection-output-stream-private.h"
+#include "x11/window-props.h"
 #include "x11/window-x11.h"
 #include "x11/xprops.h"
 
@@ -1784,6 +1785,12 @@ meta_x11_display_handle_xevent (MetaX11Display *x11_display,
   meta_spew_event_print (x11_display, event);
 #endif
 
+  /* Runs of PropertyNotify events are coalesced, but anything else may
+   * depend on the properties being up to date.
+   */
+  if (event->type != PropertyNotify)
+    meta_x11_display_flush_window_prop_reloads (x11_display);
+
   if (meta_x11_startup_notification_handle_xevent (x11_display, event))
     {
       bypass_gtk = bypass_compositor = TRUE;
@@ -160,33 +160,196 @@ find_best_size (gulong  *data,
     return FALSE;
 }
 
-static cairo_surface_t *
-argbdata_to_surface (gulong *argb_data, int w, int h)
+/* Icons converted from _NET_WM_ICON data, shared between all windows
+ * whose icons have the same contents. Entries are owned by the surface
+ * they describe and go away with it.
+ */
+typedef struct
 {
+  GHashTable *table;
+  guint hash;
+  int width;
+  int height;
   cairo_surface_t *surface;
+} IconSurfaceEntry;
+
+static const cairo_user_data_key_t icon_surface_entry_key;
+
+static inline uint32_t
+premultiply_argb (uint32_t argb)
+{
+  uint32_t alpha = argb >> 24;
+  uint32_t rb, g;
+
+  /* Scale red and blue with a single multiplication, rounding the same
+   * way as (c * alpha + 127) / 255. Without branches, so that compilers
+   * can vectorize the loops using this.
+   */
+  rb = (argb & 0x00ff00ff) * alpha + 0x00800080;
+  rb = ((rb + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+  g = (argb & 0x0000ff00) * alpha + 0x00008000;
+  g = ((g + ((g >> 8) & 0x0000ff00)) >> 8) & 0x0000ff00;
+
+  return (argb & 0xff000000) | rb | g;
+}
+
+static void
+premultiply_argb_row (uint32_t     *dest,
+                      const gulong *src,
+                      int           n_pixels)
+{
+  int i;
+
+  /* The property data comes as longs; only the low 32 bits are used */
+  for (i = 0; i < n_pixels; i++)
+    dest[i] = premultiply_argb ((uint32_t) src[i]);
+}
+
+static guint
+hash_argb_data (const gulong *argb_data,
+                int           w,
+                int           h)
+{
+  guint hash = 2166136261u;
+  int i;
+
+  hash = (hash ^ w) * 16777619u;
+  hash = (hash ^ h) * 16777619u;
+
+  for (i = 0; i < w * h; i++)
+    hash = (hash ^ (uint32_t) argb_data[i]) * 16777619u;
+
+  return hash;
+}
+
+static gboolean
+surface_matches_argb_data (cairo_surface_t *surface,
+                           const gulong    *argb_data,
+                           int              w,
+                           int              h)
+{
   int y, x, stride;
   uint32_t *data;
 
-  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, w, h);
   stride = cairo_image_surface_get_stride (surface) / sizeof (uint32_t);
   data = (uint32_t *) cairo_image_surface_get_data (surface);
 
-  /* One could speed this up a lot. */
   for (y = 0; y < h; y++)
     {
+      const gulong *src = &argb_data[y * w];
+      const uint32_t *dest = &data[y * stride];
+
       for (x = 0; x < w; x++)
         {
-          uint32_t *p = &data[y * stride + x];
-          gulong *d = &argb_data[y * w + x];
-          *p = *d;
+          if (dest[x] != premultiply_argb ((uint32_t) src[x]))
+            return FALSE;
         }
     }
 
+  return TRUE;
+}
+
+static cairo_surface_t *
+argbdata_to_surface (gulong *argb_data, int w, int h)
+{
+  cairo_surface_t *surface;
+  int y, stride;
+  uint32_t *data;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, w, h);
+  stride = cairo_image_surface_get_stride (surface) / sizeof (uint32_t);
+  data = (uint32_t *) cairo_image_surface_get_data (surface);
+
+  for (y = 0; y < h; y++)
+    premultiply_argb_row (&data[y * stride], &argb_data[y * w], w);
+
   cairo_surface_mark_dirty (surface);
 
   return surface;
 }
 
+static void
+icon_surface_entry_free (gpointer data)
+{
+  IconSurfaceEntry *entry = data;
+
+  if (entry->table &&
+      g_hash_table_lookup (entry->table,
+                           GUINT_TO_POINTER (entry->hash)) == entry)
+    g_hash_table_remove (entry->table, GUINT_TO_POINTER (entry->hash));
+
+  g_free (entry);
+}
+
+static cairo_surface_t *
+get_icon_surface (MetaX11Display *x11_display,
+                  gulong         *argb_data,
+                  int             w,
+                  int             h)
+{
+  IconSurfaceEntry *entry;
+  cairo_surface_t *surface;
+  guint hash;
+
+  if (!x11_display->icon_surfaces)
+    x11_display->icon_surfaces = g_hash_table_new (NULL, NULL);
+
+  hash = hash_argb_data (argb_data, w, h);
+  entry = g_hash_table_lookup (x11_display->icon_surfaces,
+                               GUINT_TO_POINTER (hash));
+
+  if (entry)
+    {
+      if (entry->width == w && entry->height == h &&
+          surface_matches_argb_data (entry->surface, argb_data, w, h))
+        return cairo_surface_reference (entry->surface);
+
+      /* Hash collision; keep the icon that is already shared */
+      return argbdata_to_surface (argb_data, w, h);
+    }
+
+  surface = argbdata_to_surface (argb_data, w, h);
+
+  entry = g_new0 (IconSurfaceEntry, 1);
+  entry->table = x11_display->icon_surfaces;
+  entry->hash = hash;
+  entry->width = w;
+  entry->height = h;
+  entry->surface = surface;
+
+  if (cairo_surface_set_user_data (surface, &icon_surface_entry_key,
+                                   entry, icon_surface_entry_free) !=
+      CAIRO_STATUS_SUCCESS)
+    {
+      g_free (entry);
+      return surface;
+    }
+
+  g_hash_table_insert (x11_display->icon_surfaces,
+                       GUINT_TO_POINTER (hash), entry);
+
+  return surface;
+}
+
+void
+meta_x11_display_free_icon_surfaces (MetaX11Display *x11_display)
+{
+  GHashTableIter iter;
+  IconSurfaceEntry *entry;
+
+  if (!x11_display->icon_surfaces)
+    return;
+
+  /* The surfaces may still be in use by others, and will free their
+   * entries once they are gone.
+   */
+  g_hash_table_iter_init (&iter, x11_display->icon_surfaces);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    entry->table = NULL;
+
+  g_clear_pointer (&x11_display->icon_surfaces, g_hash_table_destroy);
+}
+
 static gboolean
 read_rgb_icon (MetaX11Display   *x11_display,
                Window            xwindow,
@@ -248,8 +411,11 @@ read_rgb_icon (MetaX11Display   *x11_display,
       return FALSE;
     }
 
-  *icon = argbdata_to_surface (best, w, h);
-  *mini_icon = argbdata_to_surface (best_mini, mini_w, mini_h);
+  *icon = get_icon_surface (x11_display, best, w, h);
+  if (best_mini == best)
+    *mini_icon = cairo_surface_reference (*icon);
+  else
+    *mini_icon = get_icon_surface (x11_display, best_mini, mini_w, mini_h);
 
   XFree (data);
 
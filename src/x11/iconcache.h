@@ -56,6 +56,8 @@ void           meta_icon_cache_property_changed     (MetaIconCache  *icon_cache,
                                                      Atom            atom);
 gboolean       meta_icon_cache_get_icon_invalidated (MetaIconCache  *icon_cache);
 
+void meta_x11_display_free_icon_surfaces (MetaX11Display *x11_display);
+
 gboolean meta_read_icons         (MetaX11Display   *x11_display,
                                   Window            xwindow,
                                   MetaIconCache    *icon_cache,
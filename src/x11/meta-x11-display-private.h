@@ -113,10 +113,16 @@ struct _MetaX11Display
   MetaWindowPropHooks *prop_hooks_table;
   GHashTable *prop_hooks;
   int n_prop_hooks;
+  GArray *pending_prop_reloads;
+  guint pending_prop_reloads_id;
+  GHashTable *prefetched_initial_props;
 
   /* Managed by group-props.c */
   MetaGroupPropHooks *group_prop_hooks;
 
+  /* Managed by iconcache.c */
+  GHashTable *icon_surfaces;
+
   int xkb_base_event_type;
   guint32 last_bell_time;
 
@@ -63,6 +63,7 @@
 
 #include "x11/events.h"
 #include "x11/group-props.h"
+#include "x11/iconcache.h"
 #include "x11/meta-x11-selection-private.h"
 #include "x11/window-props.h"
 #include "x11/xprops.h"
@@ -209,6 +210,8 @@ meta_x11_display_dispose (GObject *object)
       x11_display->group_prop_hooks = NULL;
     }
 
+  meta_x11_display_free_icon_surfaces (x11_display);
+
   if (x11_display->xids)
     {
       /* Must be after all calls to meta_window_unmanage() since they
@@ -8,7 +8,9 @@
  * and take appropriate action given their values.
  *
  * Note that all the meta_window_reload_propert* functions require a
- * round trip to the server.
+ * round trip to the server. Property changes notified by the server are
+ * queued with meta_window_queue_property_reload() instead, so that a
+ * whole batch of them shares a single round trip.
  *
  * The guts of this system are in meta_display_init_window_prop_hooks().
  * Reading this function will give you insight into how this all fits
@@ -80,6 +82,9 @@ struct _MetaWindowPropHooks
   MetaPropHookFlags flags;
 };
 
+static void init_prop_value_for_hooks  (MetaWindowPropHooks *hooks,
+                                        gboolean             override_redirect,
+                                        MetaPropValue       *value);
 static void init_prop_value            (MetaWindow          *window,
                                         MetaWindowPropHooks *hooks,
                                         MetaPropValue       *value);
@@ -118,6 +123,133 @@ meta_window_reload_property_from_xwindow (MetaWindow      *window,
   meta_prop_free_values (&value, 1);
 }
 
+typedef struct
+{
+  MetaWindow *window;
+  Window xwindow;
+  Atom property;
+} PendingPropReload;
+
+static void
+clear_pending_prop_reload (gpointer data)
+{
+  PendingPropReload *reload = data;
+
+  g_object_unref (reload->window);
+}
+
+static gboolean
+flush_pending_prop_reloads_idle (gpointer user_data)
+{
+  MetaX11Display *x11_display = user_data;
+
+  x11_display->pending_prop_reloads_id = 0;
+  meta_x11_display_flush_window_prop_reloads (x11_display);
+
+  return G_SOURCE_REMOVE;
+}
+
+void
+meta_window_queue_property_reload (MetaWindow *window,
+                                   Window      xwindow,
+                                   Atom        property)
+{
+  MetaX11Display *x11_display = window->display->x11_display;
+  MetaWindowPropHooks *hooks;
+  PendingPropReload reload;
+  guint i;
+
+  hooks = find_hooks (x11_display, property);
+  if (!hooks || (hooks->flags & INIT_ONLY))
+    return;
+
+  if (!x11_display->pending_prop_reloads)
+    {
+      x11_display->pending_prop_reloads =
+        g_array_new (FALSE, FALSE, sizeof (PendingPropReload));
+      g_array_set_clear_func (x11_display->pending_prop_reloads,
+                              clear_pending_prop_reload);
+    }
+
+  /* A property changing several times only needs to be read once */
+  for (i = 0; i < x11_display->pending_prop_reloads->len; i++)
+    {
+      PendingPropReload *pending =
+        &g_array_index (x11_display->pending_prop_reloads,
+                        PendingPropReload, i);
+
+      if (pending->window == window &&
+          pending->xwindow == xwindow &&
+          pending->property == property)
+        return;
+    }
+
+  reload.window = g_object_ref (window);
+  reload.xwindow = xwindow;
+  reload.property = property;
+  g_array_append_val (x11_display->pending_prop_reloads, reload);
+
+  /* Run before the next batch of events is dispatched */
+  if (!x11_display->pending_prop_reloads_id)
+    x11_display->pending_prop_reloads_id =
+      g_idle_add_full (G_PRIORITY_HIGH,
+                       flush_pending_prop_reloads_idle,
+                       x11_display, NULL);
+}
+
+void
+meta_x11_display_flush_window_prop_reloads (MetaX11Display *x11_display)
+{
+  GArray *pending = x11_display->pending_prop_reloads;
+  MetaPropValue *values;
+  Window *xwindows;
+  guint i;
+
+  if (!pending || pending->len == 0)
+    return;
+
+  /* The hooks may queue more reloads */
+  x11_display->pending_prop_reloads = NULL;
+  g_clear_handle_id (&x11_display->pending_prop_reloads_id, g_source_remove);
+
+  values = g_new0 (MetaPropValue, pending->len);
+  xwindows = g_new0 (Window, pending->len);
+
+  for (i = 0; i < pending->len; i++)
+    {
+      PendingPropReload *reload =
+        &g_array_index (pending, PendingPropReload, i);
+
+      init_prop_value (reload->window,
+                       find_hooks (x11_display, reload->property),
+                       &values[i]);
+      xwindows[i] = reload->xwindow;
+    }
+
+  meta_prop_get_values_for_windows (x11_display, xwindows,
+                                    values, pending->len);
+
+  for (i = 0; i < pending->len; i++)
+    {
+      PendingPropReload *reload =
+        &g_array_index (pending, PendingPropReload, i);
+
+      /* Earlier hooks might have caused the window to go away */
+      if (reload->window->unmanaging)
+        continue;
+
+      reload_prop_value (reload->window,
+                         find_hooks (x11_display, reload->property),
+                         &values[i], FALSE);
+    }
+
+  meta_prop_free_values (values, pending->len);
+
+  g_free (values);
+  g_free (xwindows);
+  g_array_free (pending, TRUE);
+}
+
 static void
 meta_window_reload_property (MetaWindow      *window,
                              Atom             property,
@@ -129,6 +261,111 @@ meta_window_reload_property (MetaWindow      *window,
                                             initial);
 }
 
+typedef struct
+{
+  int n_values;
+  MetaPropValue values[];
+} PrefetchedProps;
+
+static void
+prefetched_props_free (PrefetchedProps *prefetched)
+{
+  meta_prop_free_values (prefetched->values, prefetched->n_values);
+  g_free (prefetched);
+}
+
+static int
+count_initial_properties (MetaX11Display *x11_display)
+{
+  int i, n_properties = 0;
+
+  for (i = 0; i < x11_display->n_prop_hooks; i++)
+    {
+      if (x11_display->prop_hooks_table[i].flags & LOAD_INIT)
+        n_properties++;
+    }
+
+  return n_properties;
+}
+
+void
+meta_x11_display_prefetch_initial_properties (MetaX11Display *x11_display,
+                                              const Window   *xwindows,
+                                              const gboolean *override_redirect,
+                                              int             n_xwindows)
+{
+  MetaPropValue *values;
+  Window *value_xwindows;
+  int n_properties;
+  int i, j, k;
+
+  if (n_xwindows == 0)
+    return;
+
+  if (!x11_display->prefetched_initial_props)
+    x11_display->prefetched_initial_props =
+      g_hash_table_new_full (NULL, NULL, NULL,
+                             (GDestroyNotify) prefetched_props_free);
+
+  n_properties = count_initial_properties (x11_display);
+
+  values = g_new0 (MetaPropValue, n_xwindows * n_properties);
+  value_xwindows = g_new (Window, n_xwindows * n_properties);
+
+  k = 0;
+  for (i = 0; i < n_xwindows; i++)
+    {
+      for (j = 0; j < x11_display->n_prop_hooks; j++)
+        {
+          MetaWindowPropHooks *hooks = &x11_display->prop_hooks_table[j];
+
+          if (!(hooks->flags & LOAD_INIT))
+            continue;
+
+          init_prop_value_for_hooks (hooks, override_redirect[i], &values[k]);
+          value_xwindows[k] = xwindows[i];
+          ++k;
+        }
+    }
+
+  meta_prop_get_values_for_windows (x11_display, value_xwindows,
+                                    values, n_xwindows * n_properties);
+
+  for (i = 0; i < n_xwindows; i++)
+    {
+      PrefetchedProps *prefetched;
+
+      prefetched = g_malloc (sizeof (PrefetchedProps) +
+                             n_properties * sizeof (MetaPropValue));
+      prefetched->n_values = n_properties;
+      memcpy (prefetched->values, &values[i * n_properties],
+              n_properties * sizeof (MetaPropValue));
+
+      g_hash_table_replace (x11_display->prefetched_initial_props,
+                            GUINT_TO_POINTER (xwindows[i]),
+                            prefetched);
+    }
+
+  g_free (value_xwindows);
+  g_free (values);
+}
+
+void
+meta_x11_display_clear_prefetched_properties (MetaX11Display *x11_display)
+{
+  g_clear_pointer (&x11_display->prefetched_initial_props,
+                   g_hash_table_destroy);
+}
+
+void
+meta_x11_display_drop_prefetched_properties (MetaX11Display *x11_display,
+                                             Window          xwindow)
+{
+  if (x11_display->prefetched_initial_props)
+    g_hash_table_remove (x11_display->prefetched_initial_props,
+                         GUINT_TO_POINTER (xwindow));
+}
+
 void
 meta_window_load_initial_properties (MetaWindow *window)
 {
@@ -136,23 +373,42 @@ meta_window_load_initial_properties (MetaWindow *window)
   MetaPropValue *values;
   int n_properties = 0;
   MetaX11Display *x11_display = window->display->x11_display;
+  PrefetchedProps *prefetched = NULL;
 
-  values = g_new0 (MetaPropValue, x11_display->n_prop_hooks);
+  if (x11_display->prefetched_initial_props)
+    {
+      gpointer key = GUINT_TO_POINTER (window->xwindow);
 
-  j = 0;
-  for (i = 0; i < x11_display->n_prop_hooks; i++)
+      prefetched = g_hash_table_lookup (x11_display->prefetched_initial_props,
+                                        key);
+      if (prefetched)
+        g_hash_table_steal (x11_display->prefetched_initial_props, key);
+    }
+
+  if (prefetched)
     {
-      MetaWindowPropHooks *hooks = &x11_display->prop_hooks_table[i];
-      if (hooks->flags & LOAD_INIT)
+      values = prefetched->values;
+      n_properties = prefetched->n_values;
+    }
+  else
+    {
+      values = g_new0 (MetaPropValue, x11_display->n_prop_hooks);
+
+      j = 0;
+      for (i = 0; i < x11_display->n_prop_hooks; i++)
         {
-          init_prop_value (window, hooks, &values[j]);
-          ++j;
+          MetaWindowPropHooks *hooks = &x11_display->prop_hooks_table[i];
+          if (hooks->flags & LOAD_INIT)
+            {
+              init_prop_value (window, hooks, &values[j]);
+              ++j;
+            }
         }
-    }
-  n_properties = j;
+      n_properties = j;
 
-  meta_prop_get_values (window->display->x11_display, window->xwindow,
-                        values, n_properties);
+      meta_prop_get_values (window->display->x11_display, window->xwindow,
+                            values, n_properties);
+    }
 
   j = 0;
   for (i = 0; i < x11_display->n_prop_hooks; i++)
@@ -171,19 +427,24 @@ meta_window_load_initial_properties (MetaWindow *window)
         }
     }
 
-  meta_prop_free_values (values, n_properties);
-
-  g_free (values);
+  if (prefetched)
+    {
+      prefetched_props_free (prefetched);
+    }
+  else
+    {
+      meta_prop_free_values (values, n_properties);
+      g_free (values);
+    }
 }
 
-/* Fill in the MetaPropValue used to get the value of "property" */
 static void
-init_prop_value (MetaWindow          *window,
-                 MetaWindowPropHooks *hooks,
-                 MetaPropValue       *value)
+init_prop_value_for_hooks (MetaWindowPropHooks *hooks,
+                           gboolean             override_redirect,
+                           MetaPropValue       *value)
 {
   if (!hooks || hooks->type == META_PROP_VALUE_INVALID ||
-      (window->override_redirect && !(hooks->flags & INCLUDE_OR)))
+      (override_redirect && !(hooks->flags & INCLUDE_OR)))
     {
       value->type = META_PROP_VALUE_INVALID;
       value->atom = None;
@@ -195,6 +456,15 @@ init_prop_value (MetaWindow          *window,
     }
 }
 
+/* Fill in the MetaPropValue used to get the value of "property" */
+static void
+init_prop_value (MetaWindow          *window,
+                 MetaWindowPropHooks *hooks,
+                 MetaPropValue       *value)
+{
+  init_prop_value_for_hooks (hooks, window->override_redirect, value);
+}
+
 static void
 reload_prop_value (MetaWindow          *window,
                    MetaWindowPropHooks *hooks,
@@ -1923,6 +2193,15 @@ meta_x11_display_init_window_prop_hooks (MetaX11Display *x11_display)
 void
 meta_x11_display_free_window_prop_hooks (MetaX11Display *x11_display)
 {
+  g_clear_handle_id (&x11_display->pending_prop_reloads_id, g_source_remove);
+  if (x11_display->pending_prop_reloads)
+    {
+      g_array_free (x11_display->pending_prop_reloads, TRUE);
+      x11_display->pending_prop_reloads = NULL;
+    }
+
+  meta_x11_display_clear_prefetched_properties (x11_display);
+
   g_hash_table_unref (x11_display->prop_hooks);
   x11_display->prop_hooks = NULL;
 
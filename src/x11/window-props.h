@@ -49,6 +49,30 @@ void meta_window_reload_property_from_xwindow (MetaWindow      *window,
                                                Atom             property,
                                                gboolean         initial);
 
+/**
+ * meta_window_queue_property_reload:
+ * @window:     The window the property belongs to.
+ * @xwindow:    The X handle for the window holding the property.
+ * @property:   A single X atom.
+ *
+ * Like meta_window_reload_property_from_xwindow(), but only marks the
+ * property as changed. Changed properties of all windows are requested
+ * from the server together, and dealt with, the next time
+ * meta_x11_display_flush_window_prop_reloads() is called, at the latest
+ * before the next batch of events is dispatched.
+ */
+void meta_window_queue_property_reload (MetaWindow *window,
+                                        Window      xwindow,
+                                        Atom        property);
+
+/**
+ * meta_x11_display_flush_window_prop_reloads:
+ * @x11_display:  The X11 display.
+ *
+ * Deals with all properties queued by meta_window_queue_property_reload().
+ */
+void meta_x11_display_flush_window_prop_reloads (MetaX11Display *x11_display);
+
 /**
  * meta_window_load_initial_properties:
  * @window:      The window.
@@ -59,6 +83,41 @@ void meta_window_reload_property_from_xwindow (MetaWindow      *window,
  */
 void meta_window_load_initial_properties (MetaWindow *window);
 
+/**
+ * meta_x11_display_prefetch_initial_properties:
+ * @x11_display:        The X11 display.
+ * @xwindows:           The windows about to be managed.
+ * @override_redirect:  Whether each of @xwindows is override-redirect.
+ * @n_xwindows:         The number of windows.
+ *
+ * Requests the properties meta_window_load_initial_properties() loads for
+ * all of @xwindows at once. They are then used instead of being requested
+ * again when each window is managed, until
+ * meta_x11_display_clear_prefetched_properties() is called.
+ */
+void meta_x11_display_prefetch_initial_properties (MetaX11Display *x11_display,
+                                                   const Window   *xwindows,
+                                                   const gboolean *override_redirect,
+                                                   int             n_xwindows);
+
+/**
+ * meta_x11_display_drop_prefetched_properties:
+ * @x11_display:  The X11 display.
+ * @xwindow:      A window that won't be managed after all.
+ *
+ * Frees the properties prefetched for @xwindow.
+ */
+void meta_x11_display_drop_prefetched_properties (MetaX11Display *x11_display,
+                                                  Window          xwindow);
+
+/**
+ * meta_x11_display_clear_prefetched_properties:
+ * @x11_display:  The X11 display.
+ *
+ * Frees any properties prefetched but not used.
+ */
+void meta_x11_display_clear_prefetched_properties (MetaX11Display *x11_display);
+
 /**
  * meta_x11_display_init_window_prop_hooks:
  * @x11_display:  The X11 display.
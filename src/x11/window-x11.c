@@ -2758,7 +2758,7 @@ process_property_notify (MetaWindow     *window,
         xid = window->user_time_window;
     }
 
-  meta_window_reload_property_from_xwindow (window, xid, event->atom, FALSE);
+  meta_window_queue_property_reload (window, xid, event->atom);
 
   return TRUE;
 }
@@ -3495,109 +3495,95 @@ wm_state_to_string (int state)
 }
 #endif
 
-MetaWindow *
-meta_window_x11_new (MetaDisplay       *display,
-                     Window             xwindow,
-                     gboolean           must_be_viewable,
-                     MetaCompEffect     effect)
+/*
+ * Decides whether @xwindow should be managed given its window attributes.
+ * If @wm_state is not %NULL, it contains the already fetched WM_STATE of
+ * the window, or WithdrawnState if it has none. The state the window
+ * should be managed in is returned in @existing_wm_state.
+ */
+static gboolean
+should_manage_xwindow (MetaDisplay       *display,
+                       Window             xwindow,
+                       gboolean           must_be_viewable,
+                       XWindowAttributes *attrs,
+                       const uint32_t    *wm_state,
+                       gulong            *existing_wm_state)
 {
   MetaX11Display *x11_display = display->x11_display;
-  XWindowAttributes attrs;
-  gulong existing_wm_state;
-  MetaWindow *window = NULL;
-  gulong event_mask;
-
-  meta_verbose ("Attempting to manage 0x%lx\n", xwindow);
-
-  if (meta_x11_display_xwindow_is_a_no_focus_window (x11_display, xwindow))
-    {
-      meta_verbose ("Not managing no_focus_window 0x%lx\n",
-                    xwindow);
-      return NULL;
-    }
-
-  meta_x11_error_trap_push (x11_display); /* Push a trap over all of window
-                                       * creation, to reduce XSync() calls
-                                       */
-  /*
-   * This function executes without any server grabs held. This means that
-   * the window could have already gone away, or could go away at any point,
-   * so we must be careful with X error handling.
-   */
 
-  if (!XGetWindowAttributes (x11_display->xdisplay, xwindow, &attrs))
-    {
-      meta_verbose ("Failed to get attributes for window 0x%lx\n",
-                    xwindow);
-      goto error;
-    }
-
-  if (attrs.root != x11_display->xroot)
+  if (attrs->root != x11_display->xroot)
     {
       meta_verbose ("Not on our screen\n");
-      goto error;
+      return FALSE;
     }
 
-  if (attrs.class == InputOnly)
+  if (attrs->class == InputOnly)
     {
       meta_verbose ("Not managing InputOnly windows\n");
-      goto error;
+      return FALSE;
     }
 
-  if (is_our_xwindow (x11_display, xwindow, &attrs))
+  if (is_our_xwindow (x11_display, xwindow, attrs))
     {
       meta_verbose ("Not managing our own windows\n");
-      goto error;
+      return FALSE;
     }
 
-  if (maybe_filter_xwindow (display, xwindow, must_be_viewable, &attrs))
+  if (maybe_filter_xwindow (display, xwindow, must_be_viewable, attrs))
     {
       meta_verbose ("Not managing filtered window\n");
-      goto error;
+      return FALSE;
     }
 
-  existing_wm_state = WithdrawnState;
-  if (must_be_viewable && attrs.map_state != IsViewable)
+  *existing_wm_state = WithdrawnState;
+  if (must_be_viewable && attrs->map_state != IsViewable)
     {
       /* Only manage if WM_STATE is IconicState or NormalState */
       uint32_t state;
 
       /* WM_STATE isn't a cardinal, it's type WM_STATE, but is an int */
-      if (!(meta_prop_get_cardinal_with_atom_type (x11_display, xwindow,
-                                                   x11_display->atom_WM_STATE,
-                                                   x11_display->atom_WM_STATE,
-                                                   &state) &&
-            (state == IconicState || state == NormalState)))
+      if (wm_state != NULL)
+        state = *wm_state;
+      else if (!meta_prop_get_cardinal_with_atom_type (x11_display, xwindow,
+                                                       x11_display->atom_WM_STATE,
+                                                       x11_display->atom_WM_STATE,
+                                                       &state))
+        state = WithdrawnState;
+
+      if (!(state == IconicState || state == NormalState))
         {
           meta_verbose ("Deciding not to manage unmapped or unviewable window 0x%lx\n", xwindow);
-          goto error;
+          return FALSE;
         }
 
-      existing_wm_state = state;
+      *existing_wm_state = state;
       meta_verbose ("WM_STATE of %lx = %s\n", xwindow,
-                    wm_state_to_string (existing_wm_state));
+                    wm_state_to_string (*existing_wm_state));
     }
 
-  /*
-   * XAddToSaveSet can only be called on windows created by a different
-   * client.  with Mutter we want to be able to create manageable windows
-   * from within the process (such as a dummy desktop window). As we do not
-   * want this call failing to prevent the window from being managed, we
-   * call this before creating the return-checked error trap.
-   */
-  XAddToSaveSet (x11_display->xdisplay, xwindow);
+  return TRUE;
+}
 
-  meta_x11_error_trap_push (x11_display);
+/*
+ * Selects the events we need on @xwindow and resets its border and
+ * gravity. Errors are left to the error trap held by the caller.
+ */
+static void
+select_xwindow_events (MetaX11Display    *x11_display,
+                       Window             xwindow,
+                       XWindowAttributes *attrs)
+{
+  gulong event_mask;
 
   event_mask = PropertyChangeMask;
-  if (attrs.override_redirect)
+  if (attrs->override_redirect)
     event_mask |= StructureNotifyMask;
 
   /* If the window is from this client (a menu, say) we need to augment
    * the event mask, not replace it. For windows from other clients,
-   * attrs.your_event_mask will be empty at this point.
+   * attrs->your_event_mask will be empty at this point.
    */
-  XSelectInput (x11_display->xdisplay, xwindow, attrs.your_event_mask | event_mask);
+  XSelectInput (x11_display->xdisplay, xwindow, attrs->your_event_mask | event_mask);
 
   {
     unsigned char mask_bits[XIMaskLen (XI_LASTEVENT)] = { 0 };
@@ -3615,11 +3601,11 @@ meta_window_x11_new (MetaDisplay       *display,
     XShapeSelectInput (x11_display->xdisplay, xwindow, ShapeNotifyMask);
 
   /* Get rid of any borders */
-  if (attrs.border_width != 0)
+  if (attrs->border_width != 0)
     XSetWindowBorderWidth (x11_display->xdisplay, xwindow, 0);
 
   /* Get rid of weird gravities */
-  if (attrs.win_gravity != NorthWestGravity)
+  if (attrs->win_gravity != NorthWestGravity)
     {
       XSetWindowAttributes set_attrs;
 
@@ -3630,13 +3616,16 @@ meta_window_x11_new (MetaDisplay       *display,
                                CWWinGravity,
                                &set_attrs);
     }
+}
 
-  if (meta_x11_error_trap_pop_with_return (x11_display) != Success)
-    {
-      meta_verbose ("Window 0x%lx disappeared just as we tried to manage it\n",
-                    xwindow);
-      goto error;
-    }
+static MetaWindow *
+create_window_with_attrs (MetaDisplay       *display,
+                          Window             xwindow,
+                          MetaCompEffect     effect,
+                          XWindowAttributes *attrs,
+                          gulong             existing_wm_state)
+{
+  MetaWindow *window;
 
   window = _meta_window_shared_new (display,
                                     META_WINDOW_CLIENT_TYPE_X11,
@@ -3644,12 +3633,12 @@ meta_window_x11_new (MetaDisplay       *display,
                                     xwindow,
                                     existing_wm_state,
                                     effect,
-                                    &attrs);
+                                    attrs);
 
   MetaWindowX11 *window_x11 = META_WINDOW_X11 (window);
   MetaWindowX11Private *priv = meta_window_x11_get_instance_private (window_x11);
 
-  priv->border_width = attrs.border_width;
+  priv->border_width = attrs->border_width;
 
   meta_window_grab_keys (window);
   if (window->type != META_WINDOW_DOCK && !window->override_redirect)
@@ -3658,12 +3647,335 @@ meta_window_x11_new (MetaDisplay       *display,
       meta_display_grab_focus_window_button (window->display, window);
     }
 
+  return window;
+}
+
+/*
+ * Manages @xwindow given its window attributes.
+ *
+ * The caller is expected to hold an error trap over the whole call.
+ */
+static MetaWindow *
+meta_window_x11_new_with_attrs (MetaDisplay       *display,
+                                Window             xwindow,
+                                gboolean           must_be_viewable,
+                                MetaCompEffect     effect,
+                                XWindowAttributes *attrs)
+{
+  MetaX11Display *x11_display = display->x11_display;
+  gulong existing_wm_state;
+
+  if (!should_manage_xwindow (display, xwindow, must_be_viewable, attrs,
+                              NULL, &existing_wm_state))
+    return NULL;
+
+  /*
+   * XAddToSaveSet can only be called on windows created by a different
+   * client.  with Mutter we want to be able to create manageable windows
+   * from within the process (such as a dummy desktop window). As we do not
+   * want this call failing to prevent the window from being managed, we
+   * call this before creating the return-checked error trap.
+   */
+  XAddToSaveSet (x11_display->xdisplay, xwindow);
+
+  meta_x11_error_trap_push (x11_display);
+
+  select_xwindow_events (x11_display, xwindow, attrs);
+
+  if (meta_x11_error_trap_pop_with_return (x11_display) != Success)
+    {
+      meta_verbose ("Window 0x%lx disappeared just as we tried to manage it\n",
+                    xwindow);
+      return NULL;
+    }
+
+  return create_window_with_attrs (display, xwindow, effect,
+                                   attrs, existing_wm_state);
+}
+
+MetaWindow *
+meta_window_x11_new (MetaDisplay       *display,
+                     Window             xwindow,
+                     gboolean           must_be_viewable,
+                     MetaCompEffect     effect)
+{
+  MetaX11Display *x11_display = display->x11_display;
+  XWindowAttributes attrs;
+  MetaWindow *window = NULL;
+
+  meta_verbose ("Attempting to manage 0x%lx\n", xwindow);
+
+  if (meta_x11_display_xwindow_is_a_no_focus_window (x11_display, xwindow))
+    {
+      meta_verbose ("Not managing no_focus_window 0x%lx\n",
+                    xwindow);
+      return NULL;
+    }
+
+  meta_x11_error_trap_push (x11_display); /* Push a trap over all of window
+                                       * creation, to reduce XSync() calls
+                                       */
+  /*
+   * This function executes without any server grabs held. This means that
+   * the window could have already gone away, or could go away at any point,
+   * so we must be careful with X error handling.
+   */
+
+  if (XGetWindowAttributes (x11_display->xdisplay, xwindow, &attrs))
+    window = meta_window_x11_new_with_attrs (display, xwindow,
+                                             must_be_viewable, effect,
+                                             &attrs);
+  else
+    meta_verbose ("Failed to get attributes for window 0x%lx\n",
+                  xwindow);
+
   meta_x11_error_trap_pop (x11_display); /* pop the XSync()-reducing trap */
   return window;
+}
 
-error:
-  meta_x11_error_trap_pop (x11_display);
-  return NULL;
+typedef struct
+{
+  Window xwindow;
+  xcb_get_window_attributes_cookie_t attributes_cookie;
+  xcb_get_geometry_cookie_t geometry_cookie;
+  xcb_get_property_cookie_t wm_state_cookie;
+  xcb_get_geometry_cookie_t alive_cookie;
+  XWindowAttributes attrs;
+  gulong existing_wm_state;
+} ExistingXWindow;
+
+static Visual *
+visual_from_id (MetaX11Display *x11_display,
+                xcb_visualid_t  visual_id)
+{
+  XVisualInfo template, *info;
+  Visual *visual = NULL;
+  int n_infos;
+
+  /* This is resolved on the client side, no round trip involved */
+  template.visualid = visual_id;
+  info = XGetVisualInfo (x11_display->xdisplay, VisualIDMask,
+                         &template, &n_infos);
+  if (info != NULL)
+    {
+      visual = info->visual;
+      XFree (info);
+    }
+
+  return visual;
+}
+
+static gboolean
+fetch_existing_xwindow (MetaX11Display    *x11_display,
+                        ExistingXWindow   *existing,
+                        XWindowAttributes *attrs,
+                        uint32_t          *wm_state)
+{
+  xcb_connection_t *xcb_conn = XGetXCBConnection (x11_display->xdisplay);
+  xcb_get_window_attributes_reply_t *attributes_reply;
+  xcb_get_geometry_reply_t *geometry_reply;
+  xcb_get_property_reply_t *wm_state_reply;
+  xcb_generic_error_t *error = NULL;
+  gboolean success = FALSE;
+
+  /* Errors are dealt with here, so that they don't end up in the event
+   * queue; they just mean the window went away in the meantime.
+   */
+  attributes_reply = xcb_get_window_attributes_reply (xcb_conn,
+                                                      existing->attributes_cookie,
+                                                      &error);
+  g_clear_pointer (&error, free);
+  geometry_reply = xcb_get_geometry_reply (xcb_conn,
+                                           existing->geometry_cookie,
+                                           &error);
+  g_clear_pointer (&error, free);
+  wm_state_reply = xcb_get_property_reply (xcb_conn,
+                                           existing->wm_state_cookie,
+                                           &error);
+  g_clear_pointer (&error, free);
+
+  if (attributes_reply == NULL || geometry_reply == NULL)
+    goto out;
+
+  /* Fill in what XGetWindowAttributes() would have returned */
+  memset (attrs, 0, sizeof (XWindowAttributes));
+  attrs->x = geometry_reply->x;
+  attrs->y = geometry_reply->y;
+  attrs->width = geometry_reply->width;
+  attrs->height = geometry_reply->height;
+  attrs->border_width = geometry_reply->border_width;
+  attrs->depth = geometry_reply->depth;
+  attrs->root = geometry_reply->root;
+  attrs->visual = visual_from_id (x11_display, attributes_reply->visual);
+  attrs->class = attributes_reply->_class;
+  attrs->bit_gravity = attributes_reply->bit_gravity;
+  attrs->win_gravity = attributes_reply->win_gravity;
+  attrs->backing_store = attributes_reply->backing_store;
+  attrs->backing_planes = attributes_reply->backing_planes;
+  attrs->backing_pixel = attributes_reply->backing_pixel;
+  attrs->save_under = attributes_reply->save_under;
+  attrs->colormap = attributes_reply->colormap;
+  attrs->map_installed = attributes_reply->map_is_installed;
+  attrs->map_state = attributes_reply->map_state;
+  attrs->all_event_masks = attributes_reply->all_event_masks;
+  attrs->your_event_mask = attributes_reply->your_event_mask;
+  attrs->do_not_propagate_mask = attributes_reply->do_not_propagate_mask;
+  attrs->override_redirect = attributes_reply->override_redirect;
+  attrs->screen = DefaultScreenOfDisplay (x11_display->xdisplay);
+
+  *wm_state = WithdrawnState;
+  if (wm_state_reply != NULL &&
+      wm_state_reply->type == x11_display->atom_WM_STATE &&
+      wm_state_reply->format == 32 &&
+      xcb_get_property_value_length (wm_state_reply) >= (int) sizeof (uint32_t))
+    *wm_state = *(uint32_t *) xcb_get_property_value (wm_state_reply);
+
+  success = TRUE;
+
+out:
+  free (attributes_reply);
+  free (geometry_reply);
+  free (wm_state_reply);
+
+  return success;
+}
+
+/**
+ * meta_window_x11_manage_existing:
+ * @display: a #MetaDisplay
+ * @xwindows: (array length=n_xwindows): the windows to manage, bottom to top
+ * @n_xwindows: the number of windows in @xwindows
+ *
+ * Manages windows that already exist when the X11 display is opened, e.g.
+ * when restarting. This is equivalent to calling meta_window_x11_new() on
+ * each window, but it is done in stages that each cover all windows: the
+ * window attributes and WM_STATE are requested up front, events are
+ * selected on every window to be managed, and the initial properties of
+ * all of them are requested in one go. Windows that went away in the
+ * meantime are found through a reply checked per window, so that only a
+ * single error trap is needed.
+ */
+void
+meta_window_x11_manage_existing (MetaDisplay  *display,
+                                 const Window *xwindows,
+                                 int           n_xwindows)
+{
+  MetaX11Display *x11_display = display->x11_display;
+  xcb_connection_t *xcb_conn = XGetXCBConnection (x11_display->xdisplay);
+  ExistingXWindow *existing;
+  Window *managed_xwindows;
+  gboolean *override_redirect;
+  int i, n_existing = 0, n_managed = 0;
+
+  existing = g_new (ExistingXWindow, n_xwindows);
+
+  for (i = 0; i < n_xwindows; i++)
+    {
+      ExistingXWindow *e;
+
+      if (meta_x11_display_xwindow_is_a_no_focus_window (x11_display,
+                                                         xwindows[i]))
+        {
+          meta_verbose ("Not managing no_focus_window 0x%lx\n",
+                        xwindows[i]);
+          continue;
+        }
+
+      e = &existing[n_existing++];
+      e->xwindow = xwindows[i];
+      e->attributes_cookie = xcb_get_window_attributes (xcb_conn, e->xwindow);
+      e->geometry_cookie = xcb_get_geometry (xcb_conn, e->xwindow);
+      e->wm_state_cookie = xcb_get_property (xcb_conn, FALSE, e->xwindow,
+                                             x11_display->atom_WM_STATE,
+                                             x11_display->atom_WM_STATE,
+                                             0, 1);
+    }
+
+  meta_x11_error_trap_push (x11_display); /* Push a trap over all of window
+                                       * creation, to reduce XSync() calls
+                                       */
+
+  /* Select events on every window before any of their properties are
+   * requested, so that changes made after the request are not missed.
+   */
+  for (i = 0; i < n_existing; i++)
+    {
+      uint32_t wm_state;
+
+      meta_verbose ("Attempting to manage 0x%lx\n", existing[i].xwindow);
+
+      if (!fetch_existing_xwindow (x11_display, &existing[i],
+                                   &existing[i].attrs, &wm_state))
+        {
+          meta_verbose ("Failed to get attributes for window 0x%lx\n",
+                        existing[i].xwindow);
+          continue;
+        }
+
+      if (!should_manage_xwindow (display, existing[i].xwindow, TRUE,
+                                  &existing[i].attrs, &wm_state,
+                                  &existing[i].existing_wm_state))
+        continue;
+
+      XAddToSaveSet (x11_display->xdisplay, existing[i].xwindow);
+      select_xwindow_events (x11_display, existing[i].xwindow,
+                             &existing[i].attrs);
+
+      /* Xlib and xcb share the request stream, so this is answered after
+       * the requests above; it fails if the window went away before them.
+       */
+      existing[i].alive_cookie = xcb_get_geometry (xcb_conn,
+                                                   existing[i].xwindow);
+
+      existing[n_managed++] = existing[i];
+    }
+
+  managed_xwindows = g_new (Window, n_managed);
+  override_redirect = g_new (gboolean, n_managed);
+  for (i = 0; i < n_managed; i++)
+    {
+      managed_xwindows[i] = existing[i].xwindow;
+      override_redirect[i] = existing[i].attrs.override_redirect;
+    }
+
+  meta_x11_display_prefetch_initial_properties (x11_display,
+                                                managed_xwindows,
+                                                override_redirect,
+                                                n_managed);
+
+  for (i = 0; i < n_managed; i++)
+    {
+      xcb_get_geometry_reply_t *alive_reply;
+      xcb_generic_error_t *error = NULL;
+
+      alive_reply = xcb_get_geometry_reply (xcb_conn,
+                                            existing[i].alive_cookie,
+                                            &error);
+      free (alive_reply);
+
+      if (error)
+        {
+          free (error);
+          meta_verbose ("Window 0x%lx disappeared just as we tried to manage it\n",
+                        existing[i].xwindow);
+          meta_x11_display_drop_prefetched_properties (x11_display,
+                                                       existing[i].xwindow);
+          continue;
+        }
+
+      create_window_with_attrs (display, existing[i].xwindow,
+                                META_COMP_EFFECT_NONE,
+                                &existing[i].attrs,
+                                existing[i].existing_wm_state);
+    }
+
+  meta_x11_display_clear_prefetched_properties (x11_display);
+
+  meta_x11_error_trap_pop (x11_display); /* pop the XSync()-reducing trap */
+
+  g_free (override_redirect);
+  g_free (managed_xwindows);
+  g_free (existing);
 }
 
 void
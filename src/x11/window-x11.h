@@ -49,6 +49,10 @@ MetaWindow * meta_window_x11_new           (MetaDisplay        *display,
                                             gboolean            must_be_viewable,
                                             MetaCompEffect      effect);
 
+void meta_window_x11_manage_existing (MetaDisplay  *display,
+                                      const Window *xwindows,
+                                      int           n_xwindows);
+
 void meta_window_x11_set_net_wm_state            (MetaWindow *window);
 void meta_window_x11_set_wm_state                (MetaWindow *window);
 void meta_window_x11_set_wm_take_focus           (MetaWindow *window,
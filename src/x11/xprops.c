@@ -827,19 +827,18 @@ latin1_to_utf8 (const char *text)
   return g_string_free (str, FALSE);
 }
 
-void
-meta_prop_get_values (MetaX11Display *x11_display,
-                      Window          xwindow,
-                      MetaPropValue  *values,
-                      int             n_values)
+/* Either all values are on xwindow, or xwindows has one entry per value */
+static void
+get_values (MetaX11Display *x11_display,
+            Window          xwindow,
+            const Window   *xwindows,
+            MetaPropValue  *values,
+            int             n_values)
 {
   int i;
   xcb_get_property_cookie_t *tasks;
   xcb_connection_t *xcb_conn = XGetXCBConnection (x11_display->xdisplay);
 
-  meta_verbose ("Requesting %d properties of 0x%lx at once\n",
-                n_values, xwindow);
-
   if (n_values == 0)
     return;
 
@@ -903,7 +902,10 @@ meta_prop_get_values (MetaX11Display *x11_display,
         }
 
       if (values[i].atom != None)
-        tasks[i] = async_get_property (xcb_conn, xwindow, values[i].atom, values[i].required_type);
+        tasks[i] = async_get_property (xcb_conn,
+                                       xwindows ? xwindows[i] : xwindow,
+                                       values[i].atom,
+                                       values[i].required_type);
       ++i;
     }
 
@@ -930,7 +932,7 @@ meta_prop_get_values (MetaX11Display *x11_display,
         }
 
       results.x11_display = x11_display;
-      results.xwindow = xwindow;
+      results.xwindow = xwindows ? xwindows[i] : xwindow;
       results.xatom = values[i].atom;
       results.prop = NULL;
       results.n_items = 0;
@@ -1043,6 +1045,30 @@ meta_prop_get_values (MetaX11Display *x11_display,
   g_free (tasks);
 }
 
+void
+meta_prop_get_values (MetaX11Display *x11_display,
+                      Window          xwindow,
+                      MetaPropValue  *values,
+                      int             n_values)
+{
+  meta_verbose ("Requesting %d properties of 0x%lx at once\n",
+                n_values, xwindow);
+
+  get_values (x11_display, xwindow, NULL, values, n_values);
+}
+
+void
+meta_prop_get_values_for_windows (MetaX11Display *x11_display,
+                                  const Window   *xwindows,
+                                  MetaPropValue  *values,
+                                  int             n_values)
+{
+  meta_verbose ("Requesting %d properties of several windows at once\n",
+                n_values);
+
+  get_values (x11_display, None, xwindows, values, n_values);
+}
+
 static void
 free_value (MetaPropValue *value)
 {
@@ -186,6 +186,12 @@ void meta_prop_get_values (MetaX11Display *x11_display,
                            MetaPropValue  *values,
                            int             n_values);
 
+/* Like meta_prop_get_values(), but values[i] is read from xwindows[i] */
+void meta_prop_get_values_for_windows (MetaX11Display *x11_display,
+                                       const Window   *xwindows,
+                                       MetaPropValue  *values,
+                                       int             n_values);
+
 void meta_prop_free_values (MetaPropValue *values,
                             int            n_values);
 